@@ -11,7 +11,7 @@
  * @param threadName This is the name of the thread that is to be used to run the image capture.
  */
 Camera::Camera(int width, int height, std::string threadName, uint32_t period) :
-		PeriodicTask(threadName, period) {
+		PeriodicTask(threadName, period), mtx(threadName + " frame") {
 
 	/**
 	 * 1.0 Start by instantiating a VideoCapture object which will grab the images from the camera.
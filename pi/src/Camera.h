@@ -9,7 +9,7 @@
 
 #include "PeriodicTask.h"
 #include <opencv2/opencv.hpp>
-#include <mutex>
+#include "PIMutex.h"
 
 using namespace std;
 using namespace cv;
@@ -29,7 +29,7 @@ private:
 	/**
 	 * This is a mutex within the camera class that prevents race conditions as the images are manipulated.
 	 */
-	std::mutex mtx;
+	PIMutex mtx;
 public:
 	/**
 	 * Construct a new instance of the camera class.
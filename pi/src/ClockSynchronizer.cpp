@@ -0,0 +1,177 @@
+/**
+ * @file ClockSynchronizer.cpp
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ *      This file implements the clock synchronizer.
+ */
+
+#include "ClockSynchronizer.h"
+#include "time_util.h"
+#include <stdio.h>
+
+ClockSynchronizer::Sample ClockSynchronizer::samples[CLOCK_SYNC_WINDOW];
+uint32_t ClockSynchronizer::sampleCount = 0;
+uint32_t ClockSynchronizer::nextSample = 0;
+ClockSynchronizer::Sample ClockSynchronizer::driftAnchor;
+std::atomic<uint32_t> ClockSynchronizer::sequence(0);
+std::atomic<int64_t> ClockSynchronizer::referenceTime(0);
+std::atomic<int64_t> ClockSynchronizer::offset(0);
+std::atomic<int64_t> ClockSynchronizer::driftPpb(0);
+std::atomic<int64_t> ClockSynchronizer::roundTrip(0);
+std::atomic<bool> ClockSynchronizer::synchronized(false);
+std::atomic<uint32_t> ClockSynchronizer::totalSamples(0);
+
+/**
+ * This method will record one exchange of a probe and its reply.  It must only be called from one thread.
+ * @param probeSentAt This is when the probe was sent on the monotonic clock of the robot, in microseconds.
+ * @param stationTime This is the time the station put in its reply, in ms since the start of the Epoch.
+ * @param replyReceivedAt This is when the reply arrived on the monotonic clock of the robot, in microseconds.
+ */
+void ClockSynchronizer::recordSample(int64_t probeSentAt, int64_t stationTime, int64_t replyReceivedAt) {
+	if (replyReceivedAt < probeSentAt) {
+		return;
+	}
+
+	/**
+	 * 1.0 The station is assumed to have replied halfway through the round trip.  Any asymmetry in the two directions is an error
+	 * of at most half the round trip, which is why the shortest round trip is preferred.
+	 */
+	Sample sample;
+	sample.roundTrip = replyReceivedAt - probeSentAt;
+	sample.midpoint = probeSentAt + sample.roundTrip / 2;
+	sample.offset = stationTime * 1000 + 500 - sample.midpoint;
+	samples[nextSample] = sample;
+	nextSample = (nextSample + 1) % CLOCK_SYNC_WINDOW;
+	if (sampleCount < CLOCK_SYNC_WINDOW) {
+		sampleCount++;
+	}
+	totalSamples++;
+
+	/**
+	 * 2.0 Choose the sample with the shortest round trip from the window.
+	 */
+	Sample best = samples[0];
+	for (uint32_t index = 1; index < sampleCount; index++) {
+		if (samples[index].roundTrip < best.roundTrip) {
+			best = samples[index];
+		}
+	}
+
+	/**
+	 * 3.0 Measure the drift between the chosen sample and the one it was last measured from, once they are far enough apart, and
+	 * move the estimate halfway towards it.
+	 */
+	int64_t drift = driftPpb.load(std::memory_order_relaxed);
+	if (!synchronized.load(std::memory_order_relaxed)) {
+		driftAnchor = best;
+	} else if (best.midpoint - driftAnchor.midpoint >= CLOCK_SYNC_DRIFT_BASELINE_US) {
+		int64_t measured = (best.offset - driftAnchor.offset) * 1000000000LL / (best.midpoint - driftAnchor.midpoint);
+		drift += (measured - drift) / 2;
+		if (drift > CLOCK_SYNC_MAX_DRIFT_PPM * 1000LL) {
+			drift = CLOCK_SYNC_MAX_DRIFT_PPM * 1000LL;
+		} else if (drift < -CLOCK_SYNC_MAX_DRIFT_PPM * 1000LL) {
+			drift = -CLOCK_SYNC_MAX_DRIFT_PPM * 1000LL;
+		}
+		driftAnchor = best;
+	}
+
+	/**
+	 * 4.0 Publish the new estimate.
+	 */
+	sequence.fetch_add(1, std::memory_order_acq_rel);
+	referenceTime.store(best.midpoint, std::memory_order_relaxed);
+	offset.store(best.offset, std::memory_order_relaxed);
+	driftPpb.store(drift, std::memory_order_relaxed);
+	roundTrip.store(best.roundTrip, std::memory_order_relaxed);
+	synchronized.store(true, std::memory_order_relaxed);
+	sequence.fetch_add(1, std::memory_order_release);
+}
+
+/**
+ * This method will convert an instant on the monotonic clock of the robot to synchronized time.
+ * @param monotonicTime This is the instant on CLOCK_MONOTONIC, in microseconds.
+ * @return The synchronized time at that instant will be returned, in microseconds since the start of the Epoch on the clock
+ * of the station.
+ */
+int64_t ClockSynchronizer::toSynchronizedTime(int64_t monotonicTime) {
+	uint32_t before;
+	int64_t reference;
+	int64_t currentOffset;
+	int64_t drift;
+	bool isSynced;
+
+	/**
+	 * 1.0 Read a consistent copy of the estimate.
+	 */
+	do {
+		before = sequence.load(std::memory_order_acquire);
+		reference = referenceTime.load(std::memory_order_relaxed);
+		currentOffset = offset.load(std::memory_order_relaxed);
+		drift = driftPpb.load(std::memory_order_relaxed);
+		isSynced = synchronized.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+	} while ((before & 1) != 0 || before != sequence.load(std::memory_order_relaxed));
+
+	/**
+	 * 2.0 Until there is an estimate, use the wall clock of the robot.
+	 */
+	if (!isSynced) {
+		return monotonicTime + (realtime_timestamp_ms() * 1000 - monotonic_timestamp_us());
+	}
+	return monotonicTime + currentOffset + (monotonicTime - reference) * drift / 1000000000LL;
+}
+
+/**
+ * This method will indicate whether or not the clock has been synchronized with a station.
+ * @return true if at least one sample has been recorded since the synchronizer was last reset.  False otherwise.
+ */
+bool ClockSynchronizer::isSynchronized() {
+	return synchronized.load();
+}
+
+/**
+ * This method will print the current estimate to the console.
+ */
+void ClockSynchronizer::printStatus() {
+	if (!synchronized.load()) {
+		printf("The clock is not synchronized.  %u samples.\n", (unsigned int) totalSamples.load());
+		return;
+	}
+	int64_t wallClockDifference = toSynchronizedTime(monotonic_timestamp_us()) / 1000 - realtime_timestamp_ms();
+	printf("Clock offset from the robot wall clock %lld ms, drift %.3f ppm, best round trip %lld us, %u samples.\n",
+			(long long) wallClockDifference, driftPpb.load() / 1000.0, (long long) roundTrip.load(),
+			(unsigned int) totalSamples.load());
+}
+
+/**
+ * This method will discard the samples and the estimate, so that the synchronized time is the wall clock of the robot again
+ * until the next sample arrives.  It must be called from the thread which records samples.
+ */
+void ClockSynchronizer::reset() {
+	sampleCount = 0;
+	nextSample = 0;
+	totalSamples = 0;
+	sequence.fetch_add(1, std::memory_order_acq_rel);
+	synchronized.store(false, std::memory_order_relaxed);
+	driftPpb.store(0, std::memory_order_relaxed);
+	sequence.fetch_add(1, std::memory_order_release);
+}
@@ -0,0 +1,142 @@
+/**
+ * @file ClockSynchronizer.h
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ *      This file defines the clock synchronizer.  It estimates the offset and drift between the monotonic clock of the robot and
+ *      the clock of the operator station, in the manner of NTP.  The network manager sends a probe stamped on the robot clock,
+ *      the station replies with its own time, and the reply is stamped again when it arrives.  The sample with the shortest round
+ *      trip among the most recent ones is the most accurate, since the least queueing delay can hide in it, so it is the one used.
+ *
+ *      Any thread can then read the synchronized time, which is the monotonic clock of the robot plus the estimated offset.  It
+ *      never steps backwards when the wall clock of the robot is changed, and it is directly comparable with the timestamps which
+ *      the station puts on its messages.  Until the first sample arrives, the synchronized time is the wall clock of the robot.
+ */
+
+#ifndef CLOCKSYNCHRONIZER_H_
+#define CLOCKSYNCHRONIZER_H_
+
+#include <atomic>
+#include <stdint.h>
+
+/**
+ * This is the number of the most recent samples which the one with the shortest round trip is chosen from.
+ */
+#define CLOCK_SYNC_WINDOW (8)
+
+/**
+ * This is the least time between the two samples which the drift is measured across, in microseconds.  The station reports its
+ * time to the nearest ms, so a shorter baseline would mostly measure that rounding.
+ */
+#define CLOCK_SYNC_DRIFT_BASELINE_US (30000000LL)
+
+/**
+ * This is the largest drift which is believed, in parts per million.  Real oscillators are well inside it.
+ */
+#define CLOCK_SYNC_MAX_DRIFT_PPM (500)
+
+class ClockSynchronizer {
+private:
+	/**
+	 * This structure is one exchange of a probe and its reply.
+	 */
+	struct Sample {
+		/**
+		 * This is the midpoint of the exchange on the monotonic clock of the robot, in microseconds.
+		 */
+		int64_t midpoint;
+
+		/**
+		 * This is the time of the station less the time of the robot at the midpoint, in microseconds.
+		 */
+		int64_t offset;
+
+		/**
+		 * This is the round trip time of the exchange, in microseconds.
+		 */
+		int64_t roundTrip;
+	};
+
+	/**
+	 * These are the most recent samples, in a ring.  They are only used by the thread which records samples.
+	 */
+	static Sample samples[CLOCK_SYNC_WINDOW];
+	static uint32_t sampleCount;
+	static uint32_t nextSample;
+
+	/**
+	 * This is the sample which the drift was last measured from.
+	 */
+	static Sample driftAnchor;
+
+	/**
+	 * These are the published estimate.  The synchronized time at a monotonic time t is t + offset + drift * (t - reference).
+	 * They are guarded by a sequence lock: the sequence is odd while they are being written, so that a reader which sees it
+	 * change retries rather than reading half of an update.
+	 */
+	static std::atomic<uint32_t> sequence;
+	static std::atomic<int64_t> referenceTime;
+	static std::atomic<int64_t> offset;
+	static std::atomic<int64_t> driftPpb;
+	static std::atomic<int64_t> roundTrip;
+	static std::atomic<bool> synchronized;
+
+	/**
+	 * This is the number of samples which have been recorded since the synchronizer was last reset.
+	 */
+	static std::atomic<uint32_t> totalSamples;
+
+public:
+	/**
+	 * This method will record one exchange of a probe and its reply.  It must only be called from one thread.
+	 * @param probeSentAt This is when the probe was sent on the monotonic clock of the robot, in microseconds.
+	 * @param stationTime This is the time the station put in its reply, in ms since the start of the Epoch.
+	 * @param replyReceivedAt This is when the reply arrived on the monotonic clock of the robot, in microseconds.
+	 */
+	static void recordSample(int64_t probeSentAt, int64_t stationTime, int64_t replyReceivedAt);
+
+	/**
+	 * This method will convert an instant on the monotonic clock of the robot to synchronized time.
+	 * @param monotonicTime This is the instant on CLOCK_MONOTONIC, in microseconds.
+	 * @return The synchronized time at that instant will be returned, in microseconds since the start of the Epoch on the clock
+	 * of the station.
+	 */
+	static int64_t toSynchronizedTime(int64_t monotonicTime);
+
+	/**
+	 * This method will indicate whether or not the clock has been synchronized with a station.
+	 * @return true if at least one sample has been recorded since the synchronizer was last reset.  False otherwise.
+	 */
+	static bool isSynchronized();
+
+	/**
+	 * This method will print the current estimate to the console.
+	 */
+	static void printStatus();
+
+	/**
+	 * This method will discard the samples and the estimate, so that the synchronized time is the wall clock of the robot again
+	 * until the next sample arrives.  It must be called from the thread which records samples.
+	 */
+	static void reset();
+};
+
+#endif /* CLOCKSYNCHRONIZER_H_ */
@@ -51,11 +51,6 @@ public:
 	 * @param value This is the command that was received.  It is expected to be a value between 0 and 1000 (inclusive).
 	 */
 	virtual void processSpeedControlCommand(int value);
-
-	/**
-	 * This is the run method for the class.  It contains the code that is to run periodically on the given thread.
-	 */
-	void run();
 };
 
 #endif
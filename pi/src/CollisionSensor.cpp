@@ -46,7 +46,7 @@ void CollisionSensor::taskMethod() {
     }
     if (madViolationCount == 2) {
     	hq->enqueue(HORN_SOUND_COMMAND);
-        mcq->enqueue(MOTORDIRECTIONBITMAP|STOP);
+        mcq->enqueue(MOTORDIRECTIONBITMAP|STOP, CommandQueue::URGENT_LANE, SOURCE_COLLISION_SENSOR);
     } else if (madViolationCount == 3) {
         hq->enqueue(HORN_SOUND_COMMAND);
         isAlerting = 1;
@@ -0,0 +1,144 @@
+/**
+ * @file CommandEnvelope.h
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ *      This file defines the command envelope, which is what moves through the command queues.  A command is still the
+ *      32 bit word defined in NetworkCommands.h, but it is split once, where it enters the robot, into its opcode (the top
+ *      nibble) and its payload (the rest).  The envelope also carries where the command came from, its sequence number and the
+ *      time it originated, so that the latency from the origin of a command to its effect can be measured by whoever acts on it.
+ *
+ *      The envelope is a fixed size plain structure, so it is copied by value into and out of the queues without allocating.
+ */
+
+#ifndef COMMANDENVELOPE_H_
+#define COMMANDENVELOPE_H_
+
+#include <stdint.h>
+#include <time.h>
+#include <type_traits>
+
+/**
+ * This is the mask which selects the opcode of a command word.
+ */
+#define COMMAND_OPCODE_MASK (0xF0000000)
+
+/**
+ * This enumeration gives the sources which commands come from.
+ */
+enum CommandSource {
+	SOURCE_LOCAL, SOURCE_NETWORK, SOURCE_CONSOLE, SOURCE_ROBOT_CONTROLLER, SOURCE_COLLISION_SENSOR, SOURCE_LINE_SENSOR
+};
+
+/**
+ * This structure is one command, with where it came from and when.
+ */
+struct CommandEnvelope {
+	/**
+	 * This is the opcode of the command, which is the top nibble of the command word, such as SPEEDDIRECTIONBITMAP.
+	 */
+	uint32_t opcode;
+
+	/**
+	 * This is the rest of the command word.
+	 */
+	int32_t payload;
+
+	/**
+	 * This is the sequence number of the command.  For a command from the network it is the id of the message.  For a local
+	 * command it counts the local commands.
+	 */
+	uint32_t sequenceNumber;
+
+	/**
+	 * This is the CommandSource of the command.
+	 */
+	uint16_t source;
+
+	/**
+	 * This is unused.  It keeps the timestamps aligned.
+	 */
+	uint16_t reserved;
+
+	/**
+	 * This is the time the command was sent, in ms since the start of the Epoch on the clock of the sender.  It is 0 for a local
+	 * command.
+	 */
+	int64_t senderTimestamp;
+
+	/**
+	 * This is the time the command entered the robot on CLOCK_MONOTONIC, in nanoseconds.  For a command from the network it is
+	 * the time the message was received.
+	 */
+	uint64_t originTimestamp;
+
+	/**
+	 * This method will rebuild the command word of the command.
+	 * @return The command word will be returned.
+	 */
+	int getCommandWord() const {
+		return (int) (opcode | ((uint32_t) payload & ~COMMAND_OPCODE_MASK));
+	}
+
+	/**
+	 * This method will return the low 12 bits of the payload, which hold the value of motor commands and the period of a horn pulse.
+	 * @return The value will be returned.
+	 */
+	int getValue() const {
+		return payload & 0xFFF;
+	}
+
+	/**
+	 * This method will return the next 12 bits of the payload, which hold the on time of a horn pulse.
+	 * @return The argument will be returned.
+	 */
+	int getArgument() const {
+		return (payload >> 12) & 0xFFF;
+	}
+
+	/**
+	 * This method will build an envelope for a command word which originates now.
+	 * @param command This is the command word.
+	 * @param source This is the CommandSource of the command.
+	 * @param sequenceNumber This is the sequence number of the command.
+	 * @param senderTimestamp This is the time the command was sent on the clock of the sender, in ms, or 0 for a local command.
+	 * @return The envelope will be returned.
+	 */
+	static CommandEnvelope fromCommandWord(int command, CommandSource source, uint32_t sequenceNumber,
+			int64_t senderTimestamp = 0) {
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+
+		CommandEnvelope envelope;
+		envelope.opcode = (uint32_t) command & COMMAND_OPCODE_MASK;
+		envelope.payload = (int32_t) ((uint32_t) command & ~COMMAND_OPCODE_MASK);
+		envelope.sequenceNumber = sequenceNumber;
+		envelope.source = (uint16_t) source;
+		envelope.reserved = 0;
+		envelope.senderTimestamp = senderTimestamp;
+		envelope.originTimestamp = (uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec;
+		return envelope;
+	}
+};
+
+static_assert(std::is_trivial<CommandEnvelope>::value, "A command envelope must be copyable as plain memory.");
+
+#endif /* COMMANDENVELOPE_H_ */
@@ -1,37 +1,590 @@
 # include "CommandQueue.h"
-#include <queue>
-#include <mutex>
-#include <semaphore.h>
+#include <stdint.h>
+#include <time.h>
+#include <iostream>
+#include <iomanip>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <climits>
+#include "Trace.h"
 
 using namespace std;
 
-CommandQueue::CommandQueue(){
-	this->commandQueueContents = queue<int>();
-	sem_init(&queueCountSemaphore, 0, 0);
+std::atomic<uint32_t> CommandQueue::nextQueueID(1);
+std::atomic<uint32_t> CommandQueue::nextLocalSequenceNumber(1);
+std::list<CommandQueue*> CommandQueue::allQueues;
+
+/**
+ * This method will obtain the current time on CLOCK_MONOTONIC, if the statistics are being collected.
+ * @return The time will be returned in nanoseconds, or 0 if the statistics are not being collected.
+ */
+static uint64_t statisticsNow() {
+#if COMMAND_QUEUE_COLLECT_STATISTICS
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec;
+#else
+	return 0;
+#endif
 }
 
-int CommandQueue::dequeue(){
-	sem_wait(&queueCountSemaphore);
-	lock_guard<mutex> lock(queueMutex);
-	int val = commandQueueContents.front();
-	commandQueueContents.pop();
-	return val;
+/**
+ * This method will sleep until a futex word is woken, if it still holds the value the caller last saw.
+ * @param word This is the futex word.
+ * @param expected This is the value the caller saw.  If the word no longer holds it, the method returns at once.
+ * @param deadline This is the time on CLOCK_MONOTONIC at which to stop sleeping, or NULL to sleep until woken.  FUTEX_WAIT_BITSET
+ * takes an absolute time, so a wait which is interrupted and repeated does not stretch the timeout.
+ */
+static void futexWait(std::atomic<uint32_t> *word, uint32_t expected, const struct timespec *deadline = NULL) {
+	syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT_BITSET_PRIVATE, expected, deadline, NULL,
+			FUTEX_BITSET_MATCH_ANY);
 }
 
-void CommandQueue::enqueue(int value){
-	lock_guard<mutex> lock(queueMutex);
-	commandQueueContents.push(value);
-	sem_post(&queueCountSemaphore);
+/**
+ * This method will determine whether a deadline has passed.
+ * @param deadline This is the time on CLOCK_MONOTONIC, or NULL for a deadline which never passes.
+ * @return true if the deadline has passed.  False otherwise.
+ */
+static bool deadlinePassed(const struct timespec *deadline) {
+	if (deadline == NULL) {
+		return false;
+	}
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec > deadline->tv_sec) || ((now.tv_sec == deadline->tv_sec) && (now.tv_nsec >= deadline->tv_nsec));
 }
 
-bool CommandQueue::hasItem(){
-	lock_guard<mutex> lock(queueMutex);
-	if(commandQueueContents.size() == 0){
+/**
+ * This method will wake threads sleeping on a futex word.
+ * @param word This is the futex word.
+ * @param count This is the most threads that are to be woken.
+ */
+static void futexWake(std::atomic<uint32_t> *word, uint32_t count = 1) {
+	syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+}
+
+CommandQueue::CommandQueue(std::string queueName, uint32_t capacity, FullPolicy policy) :
+		name(queueName) {
+	/**
+	 * 1.0 Round the capacity up to a power of 2, and mark each slot free for the first enqueue which lands on it.
+	 */
+	uint32_t slotCount = 2;
+	while (slotCount < capacity && slotCount < (1U << 30)) {
+		slotCount <<= 1;
+	}
+	for (int lane = 0; lane < COMMAND_QUEUE_LANES; lane++) {
+		lanes[lane].slots = new Slot[slotCount];
+		for (uint32_t index = 0; index < slotCount; index++) {
+			lanes[lane].slots[index].sequence.store(index, memory_order_relaxed);
+			lanes[lane].slots[index].ticket = 0;
+			lanes[lane].slots[index].command = CommandEnvelope();
+			lanes[lane].slots[index].timestamp = 0;
+		}
+		lanes[lane].enqueuePosition.store(0);
+		lanes[lane].dequeuePosition.store(0);
+	}
+	capacityMask = slotCount - 1;
+	this->policy = policy;
+
+	for (int index = 0; index < COMMAND_QUEUE_COALESCING_BUFFERS; index++) {
+		coalescingBuffers[index].inUse.store(0);
+	}
+	for (int type = 0; type < COMMAND_QUEUE_TYPES; type++) {
+		coalescedCommands[type].store(0);
+		urgentTickets[type].store(0);
+	}
+	pendingTypes.store(0);
+	coalescedTypes = 0;
+	coalescedCount.store(0);
+
+	nextTicket.store(1);
+	itemFutex.store(0);
+	spaceFutex.store(0);
+	itemWaiters.store(0);
+	spaceWaiters.store(0);
+	droppedCount.store(0);
+
+	enqueuedCount.store(0);
+	dequeuedCount.store(0);
+	highWaterMark.store(0);
+	statisticsStart = statisticsNow();
+
+	eventFD = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	eventFDInUse.store(false);
+	closed.store(false);
+	queueID = nextQueueID++;
+	allQueues.push_back(this);
+}
+
+bool CommandQueue::push(Ring &ring, const CommandEnvelope &command, uint64_t ticket, uint64_t timestamp) {
+	uint32_t position = ring.enqueuePosition.load(memory_order_relaxed);
+	while (true) {
+		Slot &slot = ring.slots[position & capacityMask];
+		int32_t difference = (int32_t) (slot.sequence.load(memory_order_acquire) - position);
+		if (difference == 0) {
+			// The slot is free.  Claim the position, or find out which position is now next.
+			if (ring.enqueuePosition.compare_exchange_weak(position, position + 1, memory_order_relaxed)) {
+				break;
+			}
+		} else if (difference < 0) {
+			// The slot still holds the command from one lap ago, so the lane is full.
+			return false;
+		} else {
+			position = ring.enqueuePosition.load(memory_order_relaxed);
+		}
+	}
+
+	Slot &slot = ring.slots[position & capacityMask];
+	slot.command = command;
+	slot.ticket = ticket;
+	slot.timestamp = timestamp;
+	slot.sequence.store(position + 1, memory_order_release);
+	return true;
+}
+
+bool CommandQueue::pop(Ring &ring, CommandEnvelope &command, uint64_t &ticket, uint64_t &timestamp) {
+	uint32_t position = ring.dequeuePosition.load(memory_order_relaxed);
+	while (true) {
+		Slot &slot = ring.slots[position & capacityMask];
+		int32_t difference = (int32_t) (slot.sequence.load(memory_order_acquire) - (position + 1));
+		if (difference == 0) {
+			// The slot holds a command.  Claim the position, or find out which position is now next.
+			if (ring.dequeuePosition.compare_exchange_weak(position, position + 1, memory_order_relaxed)) {
+				break;
+			}
+		} else if (difference < 0) {
+			// The command for this position has not been stored yet, so the lane is empty.
+			return false;
+		} else {
+			position = ring.dequeuePosition.load(memory_order_relaxed);
+		}
+	}
+
+	Slot &slot = ring.slots[position & capacityMask];
+	command = slot.command;
+	ticket = slot.ticket;
+	timestamp = slot.timestamp;
+	slot.sequence.store(position + capacityMask + 1, memory_order_release);
+	return true;
+}
+
+bool CommandQueue::coalesce(const CommandEnvelope &command, uint32_t type, uint64_t ticket, uint64_t timestamp) {
+	/**
+	 * 1.0 Claim a free buffer and fill it in.
+	 */
+	int index = 0;
+	uint32_t free = 0;
+	while (!coalescingBuffers[index].inUse.compare_exchange_strong(free, 1)) {
+		free = 0;
+		if (++index == COMMAND_QUEUE_COALESCING_BUFFERS) {
+			return false;
+		}
+	}
+	CoalescingBuffer &buffer = coalescingBuffers[index];
+	buffer.ticket = ticket;
+	buffer.timestamp = timestamp;
+	buffer.command = command;
+
+	/**
+	 * 2.0 Publish it as the pending command of its type.  The command it replaces now belongs to this thread, so free its buffer.
+	 */
+	uint64_t replaced = coalescedCommands[type].exchange(((uint64_t) (uint32_t) ticket << 32) | (uint32_t) (index + 1));
+	if (replaced != 0) {
+		coalescingBuffers[(uint32_t) replaced - 1].inUse.store(0);
+		coalescedCount++;
+	}
+	pendingTypes.fetch_or(1U << type);
+	return true;
+}
+
+bool CommandQueue::popNormal(CommandEnvelope &command, uint64_t &ticket, uint64_t &timestamp) {
+	Ring &ring = lanes[NORMAL_LANE];
+	while (true) {
+		/**
+		 * 1.0 Find the oldest pending coalesced command.  A type whose command has already been taken has its bit cleared, and set
+		 * again if a new command arrived in the meantime.
+		 */
+		int oldestType = -1;
+		uint64_t oldest = 0;
+		uint32_t pending = pendingTypes.load();
+		while (pending != 0) {
+			int type = __builtin_ctz(pending);
+			pending &= pending - 1;
+			uint64_t entry = coalescedCommands[type].load();
+			if (entry == 0) {
+				pendingTypes.fetch_and(~(1U << type));
+				if (coalescedCommands[type].load() != 0) {
+					pendingTypes.fetch_or(1U << type);
+				}
+			} else if (oldestType < 0 || (int32_t) ((uint32_t) (entry >> 32) - (uint32_t) (oldest >> 32)) < 0) {
+				oldestType = type;
+				oldest = entry;
+			}
+		}
+		if (oldestType < 0) {
+			return pop(ring, command, ticket, timestamp);
+		}
+
+		/**
+		 * 2.0 If the command at the head of the ring buffer is older, take it instead.
+		 */
+		uint32_t position = ring.dequeuePosition.load(memory_order_relaxed);
+		Slot &slot = ring.slots[position & capacityMask];
+		if (slot.sequence.load(memory_order_acquire) == position + 1
+				&& (int32_t) ((uint32_t) slot.ticket - (uint32_t) (oldest >> 32)) < 0 && pop(ring, command, ticket, timestamp)) {
+			return true;
+		}
+
+		/**
+		 * 3.0 Take the coalesced command, unless a newer one replaced it since it was read.  In that case, look again.  Once it is
+		 * taken, its buffer belongs to this thread, so copy the command out and free it.
+		 */
+		pendingTypes.fetch_and(~(1U << oldestType));
+		if (coalescedCommands[oldestType].compare_exchange_strong(oldest, 0)) {
+			CoalescingBuffer &buffer = coalescingBuffers[(uint32_t) oldest - 1];
+			command = buffer.command;
+			ticket = buffer.ticket;
+			timestamp = buffer.timestamp;
+			buffer.inUse.store(0);
+			return true;
+		}
+		pendingTypes.fetch_or(1U << oldestType);
+	}
+}
+
+bool CommandQueue::take(CommandEnvelope &command, uint64_t now, uint32_t &discarded) {
+	/**
+	 * 1.0 Take the command from the highest lane which has one.  A command in a lower lane which is older than the latest urgent
+	 * command of its type has been superseded by it, so discard it and keep looking.
+	 */
+	bool found = false;
+	uint64_t ticket;
+	uint64_t timestamp;
+	for (int lane = 0; lane < COMMAND_QUEUE_LANES && !found; lane++) {
+		while ((lane == NORMAL_LANE) ? popNormal(command, ticket, timestamp) : pop(lanes[lane], command, ticket, timestamp)) {
+			uint32_t type = command.opcode >> COMMAND_QUEUE_TYPE_SHIFT;
+			if (lane != URGENT_LANE && ticket < urgentTickets[type].load()) {
+				droppedCount++;
+				discarded++;
+				continue;
+			}
+			if (lane == URGENT_LANE) {
+				// The enqueuing thread may not have published the ticket yet, so publish it here, before any lower lane is read.
+				supersede(type, ticket);
+			}
+			found = true;
+			break;
+		}
+	}
+	if (!found) {
 		return false;
 	}
+	TRACE_FLOW_EVENT(TRACE_DEQUEUE, "dequeue", command.getCommandWord(), ((uint64_t) queueID << 32) | (uint32_t) ticket);
+
+	/**
+	 * 2.0 Record how long the command waited.
+	 */
+#if COMMAND_QUEUE_COLLECT_STATISTICS
+	dequeuedCount.fetch_add(1, memory_order_relaxed);
+	delayHistogram.recordValue((int64_t) (now - timestamp) / 1000);
+#endif
 	return true;
 }
 
-CommandQueue::~CommandQueue(){
+void CommandQueue::supersede(uint32_t type, uint64_t ticket) {
+	uint64_t latest = urgentTickets[type].load();
+	while (ticket > latest && !urgentTickets[type].compare_exchange_weak(latest, ticket)) {
+	}
+}
+
+void CommandQueue::signalSpace(uint32_t count) {
+	if (policy == BLOCK) {
+		spaceFutex.fetch_add(1);
+		if (spaceWaiters.load() > 0) {
+			futexWake(&spaceFutex, count);
+		}
+	}
+}
+
+CommandEnvelope CommandQueue::dequeue(){
+	CommandEnvelope command = CommandEnvelope();
+	dequeueUpTo(&command, 1);
+	return command;
+}
+
+bool CommandQueue::dequeueFor(CommandEnvelope &command, uint32_t timeoutInUs){
+	struct timespec deadline;
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	deadline.tv_sec += timeoutInUs / 1000000;
+	deadline.tv_nsec += (timeoutInUs % 1000000) * 1000;
+	if (deadline.tv_nsec >= 1000000000) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000;
+	}
+	return dequeueUntil(command, deadline);
+}
+
+bool CommandQueue::dequeueUntil(CommandEnvelope &command, const struct timespec &deadline){
+	return waitAndDequeueUpTo(&command, 1, &deadline) == 1;
+}
+
+bool CommandQueue::tryDequeue(CommandEnvelope &command){
+	return tryDequeueUpTo(&command, 1) == 1;
+}
 
+uint32_t CommandQueue::dequeueUpTo(CommandEnvelope *commands, uint32_t maximum){
+	return waitAndDequeueUpTo(commands, maximum, NULL);
+}
+
+uint32_t CommandQueue::waitAndDequeueUpTo(CommandEnvelope *commands, uint32_t maximum, const struct timespec *deadline){
+	uint32_t count;
+	while ((count = tryDequeueUpTo(commands, maximum)) == 0) {
+		if (deadlinePassed(deadline)) {
+			break;
+		}
+
+		/**
+		 * The queue is empty.  Register as a waiter before reading the futex word and checking again, so that an enqueue either
+		 * sees the waiter and wakes it, or changes the word before the wait and the wait returns at once.  Closing the queue
+		 * changes the word too, so it is only checked once the word has been read.
+		 */
+		itemWaiters.fetch_add(1);
+		uint32_t seen = itemFutex.load();
+		if ((count = tryDequeueUpTo(commands, maximum)) > 0 || closed.load()) {
+			itemWaiters.fetch_sub(1);
+			break;
+		}
+		futexWait(&itemFutex, seen, deadline);
+		itemWaiters.fetch_sub(1);
+	}
+	return count;
+}
+
+uint32_t CommandQueue::tryDequeueUpTo(CommandEnvelope *commands, uint32_t maximum){
+	uint32_t count = 0;
+	uint32_t discarded = 0;
+	uint64_t now = statisticsNow();
+	while (count < maximum && take(commands[count], now, discarded)) {
+		count++;
+	}
+	// A producer waiting for room can use the slots of the discarded commands as well.
+	if (count + discarded > 0) {
+		signalSpace(count + discarded);
+	}
+	return count;
+}
+
+bool CommandQueue::enqueue(int value, Lane lane, CommandSource source){
+	return enqueue(CommandEnvelope::fromCommandWord(value, source, nextLocalSequenceNumber++), lane);
+}
+
+bool CommandQueue::enqueue(const CommandEnvelope &command, Lane lane){
+	if (closed.load()) {
+		return false;
+	}
+	Ring &ring = lanes[lane];
+	uint64_t ticket = nextTicket.fetch_add(1);
+	uint64_t timestamp = statisticsNow();
+	uint32_t type = command.opcode >> COMMAND_QUEUE_TYPE_SHIFT;
+
+	// A coalesced command replaces any pending command of the same type, so it never waits for room.
+	if (!(lane == NORMAL_LANE && (coalescedTypes & (1U << type)) != 0 && coalesce(command, type, ticket, timestamp))) {
+		while (!push(ring, command, ticket, timestamp)) {
+			/**
+			 * The lane is full, so apply the policy of the queue.
+			 */
+			if (policy == REJECT) {
+				droppedCount++;
+				return false;
+			} else if (policy == OVERWRITE_OLDEST) {
+				CommandEnvelope oldest;
+				uint64_t oldestTicket;
+				uint64_t oldestTimestamp;
+				if (pop(ring, oldest, oldestTicket, oldestTimestamp)) {
+					droppedCount++;
+				}
+			} else {
+				spaceWaiters.fetch_add(1);
+				uint32_t seen = spaceFutex.load();
+				if (push(ring, command, ticket, timestamp)) {
+					spaceWaiters.fetch_sub(1);
+					break;
+				}
+				if (closed.load()) {
+					// The queue was closed while this thread waited for room.
+					spaceWaiters.fetch_sub(1);
+					return false;
+				}
+				futexWait(&spaceFutex, seen);
+				spaceWaiters.fetch_sub(1);
+			}
+		}
+	}
+
+	// An urgent command supersedes every command of its type which was enqueued in the lower lanes before it.
+	if (lane == URGENT_LANE) {
+		supersede(type, ticket);
+	}
+	TRACE_FLOW_EVENT(TRACE_ENQUEUE, "enqueue", command.getCommandWord(), ((uint64_t) queueID << 32) | (uint32_t) ticket);
+
+#if COMMAND_QUEUE_COLLECT_STATISTICS
+	// Record how deep the queue is now that the command is on it.
+	enqueuedCount.fetch_add(1, memory_order_relaxed);
+	uint32_t depth = getDepth();
+	depthHistogram.recordValue(depth);
+	uint32_t deepest = highWaterMark.load(memory_order_relaxed);
+	while (depth > deepest && !highWaterMark.compare_exchange_weak(deepest, depth, memory_order_relaxed)) {
+	}
+#endif
+
+	// Wake a thread blocked in dequeue, if there is one.
+	itemFutex.fetch_add(1);
+	if (itemWaiters.load() > 0) {
+		futexWake(&itemFutex);
+	}
+
+	// Wake any event loop waiting on this queue.
+	if (eventFDInUse.load()) {
+		uint64_t one = 1;
+		ssize_t written = write(eventFD, &one, sizeof(one));
+		(void) written;
+	}
+	return true;
+}
+
+int CommandQueue::getEventFD(){
+	// From now on every enqueue signals the eventfd.  Signal it once now for any commands which were enqueued before.
+	eventFDInUse.store(true);
+	if (hasItem()) {
+		uint64_t one = 1;
+		ssize_t written = write(eventFD, &one, sizeof(one));
+		(void) written;
+	}
+	return eventFD;
+}
+
+bool CommandQueue::hasItem(){
+	if (pendingTypes.load() != 0) {
+		return true;
+	}
+	for (int lane = 0; lane < COMMAND_QUEUE_LANES; lane++) {
+		uint32_t position = lanes[lane].dequeuePosition.load(memory_order_relaxed);
+		if (lanes[lane].slots[position & capacityMask].sequence.load(memory_order_acquire) == position + 1) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void CommandQueue::close(){
+	/**
+	 * 1.0 Mark the queue closed, then change both futex words, so that a thread which is about to sleep sees either the flag or
+	 * the new word.
+	 */
+	closed.store(true);
+	itemFutex.fetch_add(1);
+	spaceFutex.fetch_add(1);
+
+	/**
+	 * 2.0 Wake every thread which is asleep, and any event loop which is waiting on the queue.
+	 */
+	futexWake(&itemFutex, INT_MAX);
+	futexWake(&spaceFutex, INT_MAX);
+	if (eventFDInUse.load()) {
+		uint64_t one = 1;
+		ssize_t written = write(eventFD, &one, sizeof(one));
+		(void) written;
+	}
+}
+
+bool CommandQueue::isClosed(){
+	return closed.load();
+}
+
+void CommandQueue::enableCoalescing(int commandType){
+	uint32_t type = (uint32_t) commandType >> COMMAND_QUEUE_TYPE_SHIFT;
+	if (type != 0) {
+		coalescedTypes |= 1U << type;
+	}
+}
+
+uint32_t CommandQueue::getCoalescedCount(){
+	return coalescedCount.load();
+}
+
+uint32_t CommandQueue::getDepth(){
+	uint32_t depth = __builtin_popcount(pendingTypes.load(memory_order_relaxed));
+	for (int lane = 0; lane < COMMAND_QUEUE_LANES; lane++) {
+		int32_t laneDepth = (int32_t) (lanes[lane].enqueuePosition.load(memory_order_relaxed)
+				- lanes[lane].dequeuePosition.load(memory_order_relaxed));
+		if (laneDepth > 0) {
+			depth += laneDepth;
+		}
+	}
+	return depth;
+}
+
+uint32_t CommandQueue::getDroppedCount(){
+	return droppedCount.load();
+}
+
+void CommandQueue::printStatistics(){
+	double elapsed = (double) (statisticsNow() - statisticsStart) / 1000000000.0;
+	if (elapsed <= 0.0) {
+		elapsed = 1.0;
+	}
+	std::cout << std::setw(18) << name << "\t" << std::setw(10) << enqueuedCount.load() << "\t" << std::setw(10)
+			<< dequeuedCount.load() << "\t" << std::setw(8) << droppedCount.load() << "\t" << std::setw(9)
+			<< coalescedCount.load() << "\t" << std::fixed << std::setprecision(1) << std::setw(10)
+			<< enqueuedCount.load() / elapsed << "\t" << std::setw(10) << dequeuedCount.load() / elapsed << "\t"
+			<< std::setw(8) << getDepth() << "\t" << std::setw(8) << highWaterMark.load() << "\n";
+}
+
+std::string CommandQueue::getName(){
+	return name;
+}
+
+void CommandQueue::resetStatistics(){
+	enqueuedCount.store(0);
+	dequeuedCount.store(0);
+	droppedCount.store(0);
+	coalescedCount.store(0);
+	highWaterMark.store(0);
+	delayHistogram.reset();
+	depthHistogram.reset();
+	statisticsStart = statisticsNow();
+}
+
+void CommandQueue::printAllQueueStatistics(){
+	std::cout << "===============================================================================================\nCommand Queues:\n";
+	std::cout << "Queue             \t  Enqueued\t  Dequeued\t Dropped\tCoalesced\t  Enqueue/s\t  Dequeue/s\t   Depth\t     HWM\n";
+	for (std::list<CommandQueue*>::iterator it = allQueues.begin(); it != allQueues.end(); it++) {
+		(*it)->printStatistics();
+	}
+	std::cout << "-----------------------------------------------------------------------------------------------\nQueue Delay (us) and Depth:\n";
+	std::cout << "Queue             \tMeasurement \t     Count\t      p50\t      p90\t      p99\t    p99.9\t      Max\n";
+	for (std::list<CommandQueue*>::iterator it = allQueues.begin(); it != allQueues.end(); it++) {
+		CommandQueue *queue = *it;
+		std::cout << std::setw(18) << queue->name << "\t Delay      \t";
+		queue->delayHistogram.printPercentiles();
+		std::cout << std::setw(18) << queue->name << "\t Depth      \t";
+		queue->depthHistogram.printPercentiles();
+	}
+	std::cout << "===============================================================================================\n";
+}
+
+void CommandQueue::resetAllQueueStatistics(){
+	for (std::list<CommandQueue*>::iterator it = allQueues.begin(); it != allQueues.end(); it++) {
+		(*it)->resetStatistics();
+	}
+}
+
+CommandQueue::~CommandQueue(){
+	allQueues.remove(this);
+	::close(eventFD);
+	for (int lane = 0; lane < COMMAND_QUEUE_LANES; lane++) {
+		delete[] lanes[lane].slots;
+	}
 }
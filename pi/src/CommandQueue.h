@@ -21,8 +21,30 @@
  *
  * @section DESCRIPTION
  * Function prototypes and class definitions for the command queue class.
- * This class, the CommandQueue, allows a user to enque a set of commands for a device. The commands must be sinple integers,
- * but they can have bitmapped representations.  The queue can hold as many items as is necessary.
+ * This class, the CommandQueue, allows a user to enque a set of commands for a device. Each command is a CommandEnvelope, which
+ * carries a bitmapped command word along with its source and origin time, and is copied by value.  The queue is a fixed size
+ * ring buffer which is allocated when the queue is created, so enqueueing and dequeueing never allocate memory or take a lock.
+ * Any number of threads may enqueue and dequeue at once.  A thread which has to wait for the queue sleeps on a futex, and the
+ * kernel is only entered when a thread is waiting.
+ * What happens when a command is enqueued on a full queue is set by the policy of the queue.
+ *
+ * The queue has several priority lanes, each its own ring buffer.  A dequeue always takes from the highest lane which has a
+ * command, so a command in the urgent lane is never held up by a backlog in the lower lanes.  An urgent command also
+ * supersedes every command of the same type in the lower lanes which was enqueued before it.  Those commands are discarded
+ * rather than run after it, so that a stop is not undone by a motion command which was already waiting.  Commands of other
+ * types, such as a speed setting, are still run, since the urgent command does not replace them.
+ *
+ * Commands in the normal lane can also be coalesced by their type, which is the top nibble of the command.  Only the newest
+ * pending command of a coalesced type is kept.  A newer command of that type replaces the pending one, and is dequeued in
+ * its place among the other commands.  This suits commands such as a speed setting, where only the latest value matters.
+ *
+ * Each queue has a name and keeps statistics: how long each command waited on the queue, how deep the queue was when each
+ * command was enqueued, the enqueue and dequeue rates and the deepest the queue has been.  The statistics of every queue can
+ * be printed together, so the time a command spends between the network and the motors can be broken down by queue.
+ *
+ * A thread can wait for a command with a timeout, measured on CLOCK_MONOTONIC, so that it can do other work or notice that it
+ * has been stopped.  Closing the queue wakes every waiting thread at once.  Commands already on a closed queue can still be
+ * dequeued, but no new ones are accepted.
  *
  * @author Walter Schilling (schilling@msoe.edu)
  * @bug No known bugs.
@@ -30,30 +52,369 @@
 
 #ifndef COMMANDQUEUE_H_
 #define COMMANDQUEUE_H_
-#include <queue>        /* Required for the queue data structure.*/
-#include <mutex>        /* Required for locking critical sections. */
-#include <semaphore.h>  /* required for semaphores */
+#include <atomic>
+#include <list>
+#include <string>
+#include <stdint.h>
+#include <time.h>
+#include "CommandEnvelope.h"
+#include "LatencyHistogram.h"
+
+/**
+ * This is the number of commands a queue holds by default.  It must be a power of 2.
+ */
+#define COMMAND_QUEUE_CAPACITY (64)
+
+/**
+ * This is the number of commands a consumer takes from a queue at once, when it drains the queue in batches.
+ */
+#define COMMAND_QUEUE_BATCH (16)
+
+/**
+ * This is the number of priority lanes in each queue.
+ */
+#define COMMAND_QUEUE_LANES (3)
+
+/**
+ * This is the number of command types that can be coalesced, and the shift which gives the type of a command.
+ */
+#define COMMAND_QUEUE_TYPES (16)
+#define COMMAND_QUEUE_TYPE_SHIFT (28)
+
+/**
+ * This is the number of buffers each queue has for coalesced commands.  It must be more than the number of coalesced types plus
+ * the number of threads which may enqueue a coalesced command at the same time.
+ */
+#define COMMAND_QUEUE_COALESCING_BUFFERS (8)
+
+/**
+ * If this is 1, each queue timestamps its commands and records its statistics.  This costs one read of the clock for each
+ * enqueue and one for each batch dequeued.  If it is 0, only the counts of dropped and coalesced commands are kept.
+ */
+#define COMMAND_QUEUE_COLLECT_STATISTICS (1)
+
+/**
+ * This is the policy a queue uses by default when it is full.  Dropping the oldest command keeps the newest commands, such as a
+ * stop, from being lost behind stale ones.
+ */
+#define COMMAND_QUEUE_FULL_POLICY (CommandQueue::OVERWRITE_OLDEST)
 
 class CommandQueue {
+public:
+	/**
+	 * This enumeration gives what happens when a command is enqueued on a full queue.  REJECT drops the new command,
+	 * OVERWRITE_OLDEST drops the oldest command on the queue to make room for it, and BLOCK waits until there is room.
+	 */
+	enum FullPolicy {
+		REJECT, OVERWRITE_OLDEST, BLOCK
+	};
+
+	/**
+	 * This enumeration gives the priority lanes of the queue, from the highest to the lowest.  URGENT_LANE is for commands which
+	 * must take effect at once, such as a safety stop.  NORMAL_LANE is for ordinary commands.  BULK_LANE is for commands which
+	 * can wait until nothing else is pending.
+	 */
+	enum Lane {
+		URGENT_LANE, NORMAL_LANE, BULK_LANE
+	};
+
 private:
 	/**
-	 * This attribute holds the contents of the queue.  Items are processed in FIFO order.
+	 * This structure is one slot of the ring buffer.
+	 */
+	struct Slot {
+		/**
+		 * This is the sequence number of the slot.  It tells whether the slot is free for the enqueue at a given position, or
+		 * holds the command for the dequeue at a given position.
+		 */
+		std::atomic<uint32_t> sequence;
+
+		/**
+		 * This is the ticket of the command held by the slot.  Tickets count every command enqueued on the queue, in any lane.  They
+		 * are 64 bits, so that they never wrap around and an old urgent ticket never appears to be newer than a new command.
+		 */
+		uint64_t ticket;
+
+		/**
+		 * This is the command held by the slot.
+		 */
+		CommandEnvelope command;
+
+		/**
+		 * This is the time the command was enqueued on CLOCK_MONOTONIC, in nanoseconds.
+		 */
+		uint64_t timestamp;
+	};
+
+	/**
+	 * This structure is the ring buffer of one lane.
+	 */
+	struct Ring {
+		/**
+		 * These are the slots of the ring buffer.
+		 */
+		Slot *slots;
+
+		/**
+		 * These are the positions of the next enqueue and the next dequeue.  They count up forever, and wrap around the slots.
+		 */
+		std::atomic<uint32_t> enqueuePosition;
+		std::atomic<uint32_t> dequeuePosition;
+	};
+
+	/**
+	 * These are the lanes of the queue, from the highest priority to the lowest.
+	 */
+	Ring lanes[COMMAND_QUEUE_LANES];
+
+	/**
+	 * This is the number of slots in each lane, less one.  It is used to turn a position into a slot index.
+	 */
+	uint32_t capacityMask;
+
+	/**
+	 * This is what happens when a command is enqueued on a full queue.
+	 */
+	FullPolicy policy;
+
+	/**
+	 * This structure is a buffer which holds a coalesced command.  A buffer belongs to the thread which claimed it while it is
+	 * written, to the pending slot of its type once it is published, and to whichever thread takes it out of that slot.
+	 */
+	struct CoalescingBuffer {
+		/**
+		 * This is 1 while the buffer is in use, and 0 when it is free.
+		 */
+		std::atomic<uint32_t> inUse;
+
+		/**
+		 * This is the ticket of the command.
+		 */
+		uint64_t ticket;
+
+		/**
+		 * This is the time the command was enqueued on CLOCK_MONOTONIC, in nanoseconds.
+		 */
+		uint64_t timestamp;
+
+		/**
+		 * This is the command.
+		 */
+		CommandEnvelope command;
+	};
+
+	/**
+	 * These are the buffers which hold the coalesced commands.  There are enough that an enqueue practically always finds a free
+	 * one, and one that does not enqueues its command without coalescing it.
+	 */
+	CoalescingBuffer coalescingBuffers[COMMAND_QUEUE_COALESCING_BUFFERS];
+
+	/**
+	 * These are the pending coalesced commands, one for each command type.  Each holds the low 32 bits of the ticket of the
+	 * command in the upper 32 bits, which is enough to order the pending commands, and the index of its buffer plus 1 in the
+	 * lower 32 bits, or 0 if no command of that type is pending.
+	 */
+	std::atomic<uint64_t> coalescedCommands[COMMAND_QUEUE_TYPES];
+
+	/**
+	 * This has a bit set for each command type which may have a pending coalesced command, so that a dequeue only looks at those.
+	 */
+	std::atomic<uint32_t> pendingTypes;
+
+	/**
+	 * This has a bit set for each command type which is coalesced.
+	 */
+	uint32_t coalescedTypes;
+
+	/**
+	 * This is the number of commands which were replaced by a newer command of the same type before they were dequeued.
+	 */
+	std::atomic<uint32_t> coalescedCount;
+
+	/**
+	 * This is the ticket of the next command which is enqueued.
+	 */
+	std::atomic<uint64_t> nextTicket;
+
+	/**
+	 * This is the ticket of the latest urgent command of each type.  A command of that type in a lower lane with an earlier
+	 * ticket is discarded.
+	 */
+	std::atomic<uint64_t> urgentTickets[COMMAND_QUEUE_TYPES];
+
+	/**
+	 * These are the futex words which threads sleep on while the queue is empty or full.  Each is incremented when a command is
+	 * enqueued or dequeued, respectively.
+	 */
+	std::atomic<uint32_t> itemFutex;
+	std::atomic<uint32_t> spaceFutex;
+
+	/**
+	 * These count the threads which are sleeping on the futex words, so that the futexes are only woken when there is a waiter.
+	 */
+	std::atomic<uint32_t> itemWaiters;
+	std::atomic<uint32_t> spaceWaiters;
+
+	/**
+	 * This is the number of commands which were dropped because the queue was full, or discarded because an urgent command
+	 * superseded them.
+	 */
+	std::atomic<uint32_t> droppedCount;
+
+	/**
+	 * This is the name of the queue, as it is printed in the statistics.
+	 */
+	std::string name;
+
+	/**
+	 * These count the commands which have been enqueued and dequeued since the statistics were last reset.
+	 */
+	std::atomic<uint32_t> enqueuedCount;
+	std::atomic<uint32_t> dequeuedCount;
+
+	/**
+	 * This is the most commands that have been on the queue at once since the statistics were last reset.
+	 */
+	std::atomic<uint32_t> highWaterMark;
+
+	/**
+	 * This is the time the statistics were last reset on CLOCK_MONOTONIC, in nanoseconds.  The rates are measured from it.
+	 */
+	uint64_t statisticsStart;
+
+	/**
+	 * This is the distribution of the time from the enqueue of each command to its dequeue, in microseconds.
+	 */
+	LatencyHistogram delayHistogram;
+
+	/**
+	 * This is the distribution of the number of commands on the queue, sampled as each command is enqueued.
+	 */
+	LatencyHistogram depthHistogram;
+
+	/**
+	 * This is the list of every queue, so that their statistics can be printed together.
+	 */
+	static std::list<CommandQueue*> allQueues;
+
+	/**
+	 * This is an eventfd which is signalled each time a command is enqueued.  It lets an event loop block on several queues at once.
+	 */
+	int eventFD;
+
+	/**
+	 * This is true once the eventfd has been handed out.  Until then, enqueueing does not signal it.
+	 */
+	std::atomic<bool> eventFDInUse;
+
+	/**
+	 * This is true once the queue has been closed.
+	 */
+	std::atomic<bool> closed;
+
+	/**
+	 * This is a number which is unique to this queue.  With the ticket of a command, it links the two ends of the command in a trace.
+	 */
+	uint32_t queueID;
+
+	/**
+	 * This is the id of the next queue that is created.
+	 */
+	static std::atomic<uint32_t> nextQueueID;
+
+	/**
+	 * This is the sequence number of the next command which is enqueued as a local command word.
+	 */
+	static std::atomic<uint32_t> nextLocalSequenceNumber;
+
+	/**
+	 * This method will put a command in the ring buffer of a lane if there is room.
+	 * @param ring This is the ring buffer of the lane.
+	 * @param command This is the command that is to be stored.
+	 * @param ticket This is the ticket of the command.
+	 * @param timestamp This is the time the command was enqueued, in nanoseconds.
+	 * @return true if the command was stored.  False if the lane was full.
 	 */
-	std::queue<int> commandQueueContents;
+	bool push(Ring &ring, const CommandEnvelope &command, uint64_t ticket, uint64_t timestamp);
+
 	/**
-	 * This is a counting semaphore which keeps track of how many items are on the queue.
+	 * This method will take the oldest command out of the ring buffer of a lane if there is one.
+	 * @param ring This is the ring buffer of the lane.
+	 * @param command This will be set to the command that was taken.
+	 * @param ticket This will be set to the ticket of the command that was taken.
+	 * @param timestamp This will be set to the time the command was enqueued, in nanoseconds.
+	 * @return true if a command was taken.  False if the lane was empty.
 	 */
-	sem_t queueCountSemaphore;
+	bool pop(Ring &ring, CommandEnvelope &command, uint64_t &ticket, uint64_t &timestamp);
+
 	/**
-	 * This is a mutex for the class which is used to lock critical sections in different methods.
+	 * This method will take the oldest command out of the normal lane if there is one, whether it is in the ring buffer or is a
+	 * pending coalesced command.
+	 * @param command This will be set to the command that was taken.
+	 * @param ticket This will be set to the ticket of the command that was taken.
+	 * @param timestamp This will be set to the time the command was enqueued, in nanoseconds.
+	 * @return true if a command was taken.  False if the lane was empty.
 	 */
-	std::mutex queueMutex;
+	bool popNormal(CommandEnvelope &command, uint64_t &ticket, uint64_t &timestamp);
+
+	/**
+	 * This method will try to make a command the pending command of its type, replacing any command of that type which is pending.
+	 * @param command This is the command that is to be coalesced.
+	 * @param type This is the type of the command.
+	 * @param ticket This is the ticket of the command.
+	 * @param timestamp This is the time the command was enqueued, in nanoseconds.
+	 * @return true if the command was coalesced.  False if there was no free buffer for it.
+	 */
+	bool coalesce(const CommandEnvelope &command, uint32_t type, uint64_t ticket, uint64_t timestamp);
+
+	/**
+	 * This method will take the next command out of the queue if there is one, from the highest lane which has one.  Commands
+	 * which an urgent command superseded are discarded on the way.
+	 * @param command This will be set to the command that was dequeued.
+	 * @param now This is the current time in nanoseconds, which is used to measure how long the command waited.
+	 * @param discarded This is increased by the number of superseded commands which were discarded, since they free space too.
+	 * @return true if a command was dequeued.  False if the queue was empty.
+	 */
+	bool take(CommandEnvelope &command, uint64_t now, uint32_t &discarded);
+
+	/**
+	 * This method will move the ticket of the latest urgent command of a type forward to the given ticket, unless it is already
+	 * later.
+	 * @param type This is the type of the urgent command.
+	 * @param ticket This is the ticket of the urgent command.
+	 */
+	void supersede(uint32_t type, uint64_t ticket);
+
+	/**
+	 * This method will wake the threads which are waiting for room, after commands have been taken out of the queue.
+	 * @param count This is the number of commands which were taken.
+	 */
+	void signalSpace(uint32_t count);
+
+	/**
+	 * This method will return the number of commands on the queue.  It is approximate while other threads use the queue.
+	 * @return The number of commands on the queue will be returned.
+	 */
+	uint32_t getDepth();
+
+	/**
+	 * This method will dequeue every pending command, up to a maximum, waiting for one until a deadline if the queue is empty.
+	 * @param commands This is the array which receives the commands.
+	 * @param maximum This is the number of commands the array can hold.
+	 * @param deadline This is the time on CLOCK_MONOTONIC at which to give up, or NULL to wait as long as it takes.
+	 * @return The number of commands which were dequeued will be returned.  It is 0 if the deadline passed or the queue was closed.
+	 */
+	uint32_t waitAndDequeueUpTo(CommandEnvelope *commands, uint32_t maximum, const struct timespec *deadline);
 
 public:
 	/**
 	 * This is the default constructor, which creates an instance of the queue.
+	 * @param queueName This is the name of the queue, as it is printed in the statistics.
+	 * @param capacity This is the number of commands each lane of the queue can hold.  It is rounded up to a power of 2.
+	 * @param policy This is what happens when a command is enqueued on a full queue.
 	 */
-	CommandQueue();
+	CommandQueue(std::string queueName = "Command Queue", uint32_t capacity = COMMAND_QUEUE_CAPACITY, FullPolicy policy =
+			COMMAND_QUEUE_FULL_POLICY);
 
 	/**
 	 * The virtual destructor, which deallocates any allocated resources.
@@ -61,23 +422,151 @@ public:
 	virtual ~CommandQueue();
 
 	/**
-	 * This method will indicate whether or not the queue has an item that is ready to be dequeued.
+	 * A queue can not be copied.
+	 */
+	CommandQueue(const CommandQueue&) = delete;
+	CommandQueue& operator=(const CommandQueue&) = delete;
+
+	/**
+	 * This method will indicate whether or not the queue has an item that is ready to be dequeued.  The item may be one which an
+	 * urgent command superseded, so a caller which must not block should use tryDequeue instead.
 	 * @return true if there is an item on the queue.  False otherwise.
 	 */
 	bool hasItem();
 
 	/**
 	 * This method will dequeue the next command from the queue.  This method will block if there are no items on the queue.
-	 * @return The return will be the next command that is to be processed.
+	 * @return The return will be the next command that is to be processed.  If the queue was closed while it was empty, an
+	 * envelope with an opcode and payload of 0 is returned.
+	 */
+	CommandEnvelope dequeue();
+
+	/**
+	 * This method will dequeue the next command from the queue, waiting at most a given time for one to arrive.
+	 * @param command This will be set to the command that was dequeued.
+	 * @param timeoutInUs This is the longest time to wait, in microseconds.
+	 * @return true if a command was dequeued.  False if the time passed or the queue was closed while it was empty.
+	 */
+	bool dequeueFor(CommandEnvelope &command, uint32_t timeoutInUs);
+
+	/**
+	 * This method will dequeue the next command from the queue, waiting until a deadline for one to arrive.
+	 * @param command This will be set to the command that was dequeued.
+	 * @param deadline This is the time on CLOCK_MONOTONIC at which to give up.
+	 * @return true if a command was dequeued.  False if the deadline passed or the queue was closed while it was empty.
+	 */
+	bool dequeueUntil(CommandEnvelope &command, const struct timespec &deadline);
+
+	/**
+	 * This method will dequeue the next command from the queue if there is one.  It never blocks.
+	 * @param command This will be set to the command that was dequeued.
+	 * @return true if a command was dequeued.  False if the queue was empty.
+	 */
+	bool tryDequeue(CommandEnvelope &command);
+
+	/**
+	 * This method will dequeue every pending command, up to a maximum, in the order they would be dequeued one at a time.  It blocks
+	 * until there is at least one command.  Threads waiting for room are woken once for the whole batch.
+	 * @param commands This is the array which receives the commands.
+	 * @param maximum This is the number of commands the array can hold.
+	 * @return The number of commands which were dequeued will be returned.  It is at least 1, unless the queue was closed while
+	 * it was empty.
+	 */
+	uint32_t dequeueUpTo(CommandEnvelope *commands, uint32_t maximum);
+
+	/**
+	 * This method will dequeue every pending command, up to a maximum, in the order they would be dequeued one at a time.  It never
+	 * blocks.
+	 * @param commands This is the array which receives the commands.
+	 * @param maximum This is the number of commands the array can hold.
+	 * @return The number of commands which were dequeued will be returned.  It is 0 if the queue was empty.
+	 */
+	uint32_t tryDequeueUpTo(CommandEnvelope *commands, uint32_t maximum);
+
+	/**
+	 * This method will obtain the eventfd which is signalled each time a command is enqueued.  The descriptor becomes readable when
+	 * there may be commands on the queue, and reading it clears it.  The descriptor belongs to the queue and must not be closed.
+	 * @return The file descriptor will be returned.
+	 */
+	int getEventFD();
+
+	/**
+	 * This method will enqueue a command on the queue.
+	 * Enqueueing a command will cause a thread blocked waiting for a command to be unblocked.  If the queue is full, the policy
+	 * of the queue decides what happens.
+	 * @param command This is the command that is to be enqueued.
+	 * @param lane This is the priority lane of the command.  A command in the urgent lane discards every command in the lower
+	 * lanes which was enqueued before it.
+	 * @return true if the command was enqueued.  False if it was rejected because the lane was full or the queue is closed.
+	 */
+	bool enqueue(const CommandEnvelope &command, Lane lane = NORMAL_LANE);
+
+	/**
+	 * This method will enqueue a command word which originates here and now.  Any number can be enqueued as a command.
+	 * @param value This is the command word that is to be enqueued.
+	 * @param lane This is the priority lane of the command.
+	 * @param source This is the CommandSource of the command.
+	 * @return true if the command was enqueued.  False if it was rejected because the lane was full or the queue is closed.
+	 */
+	bool enqueue(int value, Lane lane = NORMAL_LANE, CommandSource source = SOURCE_LOCAL);
+
+	/**
+	 * This method will make commands of a given type in the normal lane coalesce, so that only the newest one is kept.  It must be
+	 * called before the queue is used.
+	 * @param commandType This is the type of the command, such as SPEEDDIRECTIONBITMAP.  Only the top nibble is used, and it must
+	 * not be 0.
+	 */
+	void enableCoalescing(int commandType);
+
+	/**
+	 * This method will close the queue.  Every thread waiting to enqueue or dequeue is woken, any event loop waiting on the queue
+	 * is signalled, and later enqueues are rejected.  Commands already on the queue can still be dequeued.
+	 */
+	void close();
+
+	/**
+	 * This method will indicate whether or not the queue has been closed.
+	 * @return true if the queue has been closed.  False otherwise.
+	 */
+	bool isClosed();
+
+	/**
+	 * This method will return the number of commands which were replaced by a newer command of the same type.
+	 * @return The number of coalesced commands since the statistics were last reset will be returned.
+	 */
+	uint32_t getCoalescedCount();
+
+	/**
+	 * This method will return the number of commands which were dropped because the queue was full or superseded.
+	 * @return The number of dropped commands since the statistics were last reset will be returned.
+	 */
+	uint32_t getDroppedCount();
+
+	/**
+	 * This method will print the counts, rates, current depth and high water mark of this queue on one line.
+	 */
+	void printStatistics();
+
+	/**
+	 * This method will return the name of the queue.
+	 * @return The name of the queue will be returned.
+	 */
+	std::string getName();
+
+	/**
+	 * This method will reset the statistics of this queue.
+	 */
+	void resetStatistics();
+
+	/**
+	 * This method will print the statistics of every queue to the console.
 	 */
-	int dequeue();
+	static void printAllQueueStatistics();
 
 	/**
-	 * This method will enqueue a command on the queue.  Any number can be enqueued as a command.
-	 * Enqueueing a command will cause a thread blocked waiting for a command to be unblocked.
-	 * @param value This is the value that is to be enqueued.
+	 * This method will reset the statistics of every queue.
 	 */
-	void enqueue(int value);
+	static void resetAllQueueStatistics();
 };
 
 #endif /* COMMANDQUEUE_H_ */
@@ -0,0 +1,306 @@
+/**
+ * @file CyclicExecutive.cpp
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ *      This file implements a cyclic executive, which runs several periodic tasks from a single thread using a static
+ *      frame table.
+ */
+
+#include "CyclicExecutive.h"
+#include "time_util.h"
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <algorithm>
+#include <errno.h>
+
+/**
+ * This function will compute the greatest common divisor of two numbers.
+ * @param a This is the first number.
+ * @param b This is the second number.
+ * @return The greatest common divisor will be returned.
+ */
+static uint64_t greatestCommonDivisor(uint64_t a, uint64_t b) {
+	while (b != 0) {
+		uint64_t remainder = a % b;
+		a = b;
+		b = remainder;
+	}
+	return a;
+}
+
+/**
+ * This function is used to order the tasks within a frame so that the highest priority task runs first.
+ * @param lhs This is the first task.
+ * @param rhs This is the second task.
+ * @return true if lhs is to run before rhs.
+ */
+static bool runsBefore(PeriodicTask *lhs, PeriodicTask *rhs) {
+	return lhs->getPriority() > rhs->getPriority();
+}
+
+/**
+ * This is the default constructor for the class.
+ * @param threadName This is the name of the executive thread in a human readable format.
+ */
+CyclicExecutive::CyclicExecutive(std::string threadName) :
+		RunnableClass(threadName) {
+}
+
+/**
+ * This is the destructor for the class.  The tasks that were added are not deleted.
+ */
+CyclicExecutive::~CyclicExecutive() {
+	// The tasks are owned by whoever created them, so there is nothing to clean up here.
+}
+
+/**
+ * This method will add a periodic task to the executive.  It must be called before the executive is started, and the
+ * task must not be started on its own.
+ * @param task This is the task that is to be run by the executive.
+ * @return true if the task was added.  False if adding it would make the frame table larger than CYCLIC_EXECUTIVE_MAX_FRAMES.
+ */
+bool CyclicExecutive::addTask(PeriodicTask *task) {
+	tasks.push_back(task);
+	if (!buildFrameTable()) {
+		/**
+		 * The task does not fit with the others.  Remove it and put the table back the way it was.
+		 */
+		tasks.pop_back();
+		buildFrameTable();
+		std::cout << "Cyclic executive " << myName << " cannot run " << task->myName
+				<< ": its period of " << task->getTaskPeriod()
+				<< "us makes the hyperperiod too long.\n";
+		return false;
+	}
+	return true;
+}
+
+/**
+ * This method will build the frame table from the periods of the tasks.
+ * @return true if the table was built.  False if the task set is empty or the hyperperiod would require too many frames.
+ */
+bool CyclicExecutive::buildFrameTable() {
+	frameTable.clear();
+	hyperperiod = 0;
+	minorFrame = 0;
+
+	if (tasks.empty()) {
+		return false;
+	}
+
+	/**
+	 * 1.0 The hyperperiod is the least common multiple of the periods and the minor frame is their greatest common divisor.
+	 * Count the total number of releases in the hyperperiod as we go so that we can stop before the table grows too large.
+	 */
+	uint64_t lcm = 1;
+	uint64_t gcd = 0;
+	for (std::vector<PeriodicTask*>::iterator it = tasks.begin(); it != tasks.end(); it++) {
+		uint64_t period = (*it)->getTaskPeriod();
+		lcm = (lcm / greatestCommonDivisor(lcm, period)) * period;
+		gcd = greatestCommonDivisor(gcd, period);
+	}
+
+	uint64_t releases = 0;
+	for (std::vector<PeriodicTask*>::iterator it = tasks.begin(); it != tasks.end(); it++) {
+		releases += lcm / (*it)->getTaskPeriod();
+	}
+	if (releases > CYCLIC_EXECUTIVE_MAX_FRAMES) {
+		return false;
+	}
+
+	/**
+	 * 2.0 Place every release of every task into the frame that starts at the release instant.
+	 */
+	std::map<uint64_t, std::vector<PeriodicTask*> > releasesByOffset;
+	for (std::vector<PeriodicTask*>::iterator it = tasks.begin(); it != tasks.end(); it++) {
+		uint64_t period = (*it)->getTaskPeriod();
+		for (uint64_t offset = 0; offset < lcm; offset += period) {
+			releasesByOffset[offset].push_back(*it);
+		}
+	}
+
+	/**
+	 * 3.0 Convert the map into the frame table, ordering the tasks in each frame by priority.
+	 */
+	for (std::map<uint64_t, std::vector<PeriodicTask*> >::iterator it = releasesByOffset.begin();
+			it != releasesByOffset.end(); it++) {
+		Frame frame;
+		frame.offset = it->first;
+		frame.releasedTasks = it->second;
+		std::stable_sort(frame.releasedTasks.begin(), frame.releasedTasks.end(), runsBefore);
+		frameTable.push_back(frame);
+	}
+
+	hyperperiod = lcm;
+	minorFrame = gcd;
+	return true;
+}
+
+/**
+ * This method will obtain the hyperperiod of the task set.
+ * @return The hyperperiod in microseconds will be returned.
+ */
+uint64_t CyclicExecutive::getHyperperiod() {
+	return hyperperiod;
+}
+
+/**
+ * This method will obtain the minor frame of the task set.
+ * @return The minor frame in microseconds will be returned.
+ */
+uint64_t CyclicExecutive::getMinorFrame() {
+	return minorFrame;
+}
+
+/**
+ * This method is called as the executive starts.  The tasks run on the thread of the executive, so they take on its CPU affinity.
+ */
+void CyclicExecutive::startChildRunnables() {
+	for (std::vector<PeriodicTask*>::iterator it = tasks.begin(); it != tasks.end(); it++) {
+		(*it)->setCPUAffinity(coreMask);
+	}
+}
+
+/**
+ * This is the run method for the class.  It walks the frame table, releasing each task at its frame.
+ */
+void CyclicExecutive::run() {
+	keepGoing = true;
+
+	/**
+	 * 1.0 Rebuild the frame table, in case a task period was changed after the task was added.
+	 */
+	if (!buildFrameTable()) {
+		std::cout << "Cyclic executive " << myName << " has no schedulable tasks.\n";
+		return;
+	}
+
+	/**
+	 * 2.0 All of the tasks now run on this thread, so report this thread's ID for each of them.
+	 */
+	for (std::vector<PeriodicTask*>::iterator it = tasks.begin(); it != tasks.end(); it++) {
+		(*it)->myOSThreadID = myOSThreadID;
+	}
+
+	/**
+	 * 3.0 The first hyperperiod starts now.
+	 */
+	struct timespec hyperperiodStart;
+	clock_gettime(CLOCK_MONOTONIC, &hyperperiodStart);
+	size_t frameIndex = 0;
+
+	/**
+	 * 4.0 Loop so long as the thread is to continue running.
+	 */
+	while (keepGoing) {
+		/**
+		 * 4.1 Sleep until the start of the current frame on the absolute time line.
+		 */
+		Frame &frame = frameTable[frameIndex];
+		struct timespec releaseTime = hyperperiodStart;
+		timespec_add_us(releaseTime, frame.offset);
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &releaseTime, NULL) == EINTR) {
+		}
+
+		/**
+		 * 4.2 Run each task released in this frame, highest priority first.  Each task keeps its own timing statistics,
+		 * measured against the frame start, which is its release instant.
+		 */
+		struct timespec completionTime = releaseTime;
+		for (std::vector<PeriodicTask*>::iterator it = frame.releasedTasks.begin();
+				it != frame.releasedTasks.end(); it++) {
+			PeriodicTask *task = *it;
+			task->executeRelease(releaseTime, completionTime);
+			if (timespec_delta_us(releaseTime, completionTime) >= task->getTaskPeriod()) {
+				task->overrunCount++;
+				if (task->overrunPolicy == PeriodicTask::DEGRADE) {
+					task->handleOverrun(1);
+				}
+			}
+		}
+
+		/**
+		 * 4.3 Move to the next frame, wrapping around into the next hyperperiod.  If we are already past the start of the
+		 * frame after that one, the work overran badly; skip frames until we are back on the time line.
+		 */
+		bool overran = false;
+		do {
+			frameIndex++;
+			if (frameIndex == frameTable.size()) {
+				frameIndex = 0;
+				timespec_add_us(hyperperiodStart, hyperperiod);
+			}
+
+			struct timespec nextRelease = hyperperiodStart;
+			timespec_add_us(nextRelease, frameTable[frameIndex].offset);
+			if (timespec_delta_us(nextRelease, completionTime) < 0) {
+				break;
+			}
+
+			/**
+			 * 4.3.1 The next frame is already due.  Count the overrun once, and skip the frame only if the one after it is
+			 * also due, so that the late frame still runs.
+			 */
+			if (!overran) {
+				frameOverrunCount++;
+				overran = true;
+			}
+			size_t followingIndex = frameIndex + 1;
+			struct timespec followingRelease = hyperperiodStart;
+			if (followingIndex == frameTable.size()) {
+				followingIndex = 0;
+				timespec_add_us(followingRelease, hyperperiod);
+			}
+			timespec_add_us(followingRelease, frameTable[followingIndex].offset);
+			if (timespec_delta_us(followingRelease, completionTime) < 0) {
+				break;
+			}
+
+			skippedFrameCount++;
+			Frame &skipped = frameTable[frameIndex];
+			for (std::vector<PeriodicTask*>::iterator it = skipped.releasedTasks.begin();
+					it != skipped.releasedTasks.end(); it++) {
+				(*it)->skippedReleaseCount++;
+			}
+		} while (keepGoing);
+	}
+}
+
+/**
+ * This method will print out information about the executive and its frame table.
+ */
+void CyclicExecutive::printInformation() {
+	std::cout << myOSThreadID << "\t" << std::setw(18) << myName << "\t "
+			<< std::setw(5) << getPriority() << "\t minor frame(us) " << minorFrame
+			<< "\t hyperperiod(us) " << hyperperiod << "\t frames " << frameTable.size()
+			<< "\t tasks " << tasks.size() << "\t frame overruns " << frameOverrunCount
+			<< "\t skipped frames " << skippedFrameCount << "\n";
+}
+
+/**
+ * This method will reset the frame overrun diagnostics back to their default values.
+ */
+void CyclicExecutive::resetThreadDiagnostics() {
+	frameOverrunCount = 0;
+	skippedFrameCount = 0;
+}
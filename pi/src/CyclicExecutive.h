@@ -0,0 +1,150 @@
+/**
+ * @file CyclicExecutive.h
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ *      This file defines a cyclic executive.  A cyclic executive runs the task methods of a set of periodic tasks from a single
+ *      thread, following a static frame table that is computed from the task periods.  The frame table covers one hyperperiod
+ *      (the least common multiple of the periods) and holds one entry for every instant at which at least one task is released.
+ *      Tasks which are added to the executive must not also be started on their own threads.
+ */
+
+#ifndef CYCLICEXECUTIVE_H_
+#define CYCLICEXECUTIVE_H_
+
+#include "RunnableClass.h"
+#include "PeriodicTask.h"
+#include <vector>
+#include <stdint.h>
+
+/**
+ * This is the largest number of release frames that the executive will allow in one hyperperiod.  Task sets whose periods
+ * have a very large least common multiple would otherwise require a huge frame table.
+ */
+#define CYCLIC_EXECUTIVE_MAX_FRAMES (4096)
+
+class CyclicExecutive: public RunnableClass {
+private:
+	/**
+	 * This structure represents one entry in the frame table.
+	 */
+	struct Frame {
+		/**
+		 * This is the offset of the frame from the start of the hyperperiod, in microseconds.
+		 */
+		uint64_t offset;
+
+		/**
+		 * These are the tasks which are released at the start of this frame, in order of decreasing priority.
+		 */
+		std::vector<PeriodicTask*> releasedTasks;
+	};
+
+	/**
+	 * This is the set of tasks which are run by this executive.
+	 */
+	std::vector<PeriodicTask*> tasks;
+
+	/**
+	 * This is the static frame table.  Frames with no released tasks are not stored.
+	 */
+	std::vector<Frame> frameTable;
+
+	/**
+	 * This is the length of the hyperperiod in microseconds.
+	 */
+	uint64_t hyperperiod = 0;
+
+	/**
+	 * This is the minor frame, the greatest common divisor of the task periods, in microseconds.
+	 */
+	uint64_t minorFrame = 0;
+
+	/**
+	 * This is a count of the number of times that the work in a frame was still running when the next frame was due.
+	 */
+	uint32_t frameOverrunCount = 0;
+
+	/**
+	 * This is a count of the number of frames that were skipped because the executive was more than a whole frame late.
+	 */
+	uint32_t skippedFrameCount = 0;
+
+	/**
+	 * This method will build the frame table from the periods of the tasks.
+	 * @return true if the table was built.  False if the task set is empty or the hyperperiod would require too many frames.
+	 */
+	bool buildFrameTable();
+
+public:
+	/**
+	 * This is the default constructor for the class.
+	 * @param threadName This is the name of the executive thread in a human readable format.
+	 */
+	CyclicExecutive(std::string threadName);
+
+	/**
+	 * This is the destructor for the class.  The tasks that were added are not deleted.
+	 */
+	virtual ~CyclicExecutive();
+
+	/**
+	 * This method will add a periodic task to the executive.  It must be called before the executive is started, and the
+	 * task must not be started on its own.
+	 * @param task This is the task that is to be run by the executive.
+	 * @return true if the task was added.  False if adding it would make the frame table larger than CYCLIC_EXECUTIVE_MAX_FRAMES.
+	 */
+	bool addTask(PeriodicTask *task);
+
+	/**
+	 * This method will obtain the hyperperiod of the task set.
+	 * @return The hyperperiod in microseconds will be returned.
+	 */
+	uint64_t getHyperperiod();
+
+	/**
+	 * This method will obtain the minor frame of the task set.
+	 * @return The minor frame in microseconds will be returned.
+	 */
+	uint64_t getMinorFrame();
+
+	/**
+	 * This is the run method for the class.  It walks the frame table, releasing each task at its frame.
+	 */
+	void run();
+
+	/**
+	 * This method is called as the executive starts.  The tasks run on the thread of the executive, so they take on its CPU affinity.
+	 */
+	virtual void startChildRunnables();
+
+	/**
+	 * This method will print out information about the executive and its frame table.
+	 */
+	virtual void printInformation();
+
+	/**
+	 * This method will reset the frame overrun diagnostics back to their default values.
+	 */
+	virtual void resetThreadDiagnostics();
+};
+
+#endif /* CYCLICEXECUTIVE_H_ */
@@ -0,0 +1,251 @@
+/**
+ * @file ElasticManager.cpp
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ *      This file implements the elastic manager, which stretches the periods of the elastic tasks under overload.
+ */
+
+#include "ElasticManager.h"
+#include "SchedulingCfg.h"
+#include <iostream>
+#include <iomanip>
+#include <unistd.h>
+
+/**
+ * This is the default constructor for the class.
+ * @param threadName This is the name of the thread in a human readable format.
+ * @param period This is the period of the manager, given in microseconds.
+ * @param utilizationBound This is the utilization per core which the cores of the elastic tasks are kept within.
+ */
+ElasticManager::ElasticManager(std::string threadName, uint32_t period, double utilizationBound) :
+		PeriodicTask(threadName, period) {
+	this->utilizationBound = utilizationBound;
+}
+
+/**
+ * This is the destructor for the class.
+ */
+ElasticManager::~ElasticManager() {
+}
+
+/**
+ * This method will determine if two core masks share a core.  A mask of 0 means all cores.
+ * @param firstMask This is the first mask.
+ * @param secondMask This is the second mask.
+ * @return true if the masks share a core.
+ */
+bool ElasticManager::sharesCore(uint32_t firstMask, uint32_t secondMask) {
+	return firstMask == 0 || secondMask == 0 || (firstMask & secondMask) != 0;
+}
+
+/**
+ * This method will add a task whose period is to be managed.  Its period when it is added is its nominal period.  It must be
+ * called before the manager is started.
+ * @param task This is the task that is to be managed.  It must run on its own thread, not from a cyclic executive.
+ * @param maximumPeriod This is the longest period the task may be stretched to, in microseconds.
+ * @param elasticity This is the elasticity of the task.  It must be greater than 0.
+ */
+void ElasticManager::addTask(PeriodicTask *task, uint32_t maximumPeriod, double elasticity) {
+	ElasticTask elasticTask;
+	elasticTask.task = task;
+	elasticTask.nominalPeriod = task->getTaskPeriod();
+	elasticTask.maximumPeriod = maximumPeriod > elasticTask.nominalPeriod ? maximumPeriod : elasticTask.nominalPeriod;
+	elasticTask.elasticity = elasticity > 0.0 ? elasticity : 1.0;
+	elasticTask.desiredPeriod = elasticTask.nominalPeriod;
+	elasticTasks.push_back(elasticTask);
+}
+
+/**
+ * This method will compress the elastic tasks so that their total utilization fits within the given capacity.
+ * @param capacity This is the utilization which is left for the elastic tasks.
+ */
+void ElasticManager::compress(double capacity) {
+	size_t count = elasticTasks.size();
+	std::vector<double> executionTime(count);
+	std::vector<double> nominalUtilization(count);
+	std::vector<double> minimumUtilization(count);
+	std::vector<double> utilization(count);
+	std::vector<bool> atMinimum(count, false);
+	double totalUtilization = 0.0;
+
+	/**
+	 * 1.0 Find the utilization of each task at its nominal and maximum periods.  A task which has not run yet has nothing to give
+	 * up, so it stays at its nominal period.
+	 */
+	for (size_t index = 0; index < count; index++) {
+		executionTime[index] = (double) elasticTasks[index].task->getAverageExecutionTime();
+		nominalUtilization[index] = executionTime[index] / elasticTasks[index].nominalPeriod;
+		minimumUtilization[index] = executionTime[index] / elasticTasks[index].maximumPeriod;
+		utilization[index] = nominalUtilization[index];
+		totalUtilization += nominalUtilization[index];
+	}
+
+	/**
+	 * 2.0 If the tasks do not fit at their nominal periods, take the excess from each task in proportion to its elasticity.  A task
+	 * which would go below its minimum utilization is held there, and the excess is shared out again among the rest, until no
+	 * more tasks reach their minimum.
+	 */
+	if (totalUtilization > capacity) {
+		bool changed = true;
+		while (changed) {
+			changed = false;
+			double heldUtilization = 0.0;
+			double freeUtilization = 0.0;
+			double freeElasticity = 0.0;
+			for (size_t index = 0; index < count; index++) {
+				if (atMinimum[index]) {
+					heldUtilization += minimumUtilization[index];
+				} else if (executionTime[index] > 0.0) {
+					freeUtilization += nominalUtilization[index];
+					freeElasticity += elasticTasks[index].elasticity;
+				}
+			}
+			if (freeElasticity == 0.0) {
+				break;
+			}
+
+			double excess = freeUtilization + heldUtilization - capacity;
+			for (size_t index = 0; index < count; index++) {
+				if (!atMinimum[index] && executionTime[index] > 0.0) {
+					utilization[index] = nominalUtilization[index]
+							- excess * elasticTasks[index].elasticity / freeElasticity;
+					if (utilization[index] <= minimumUtilization[index]) {
+						utilization[index] = minimumUtilization[index];
+						atMinimum[index] = true;
+						changed = true;
+					}
+				}
+			}
+		}
+	}
+
+	/**
+	 * 3.0 Convert the utilizations back into periods.
+	 */
+	for (size_t index = 0; index < count; index++) {
+		if (executionTime[index] > 0.0 && utilization[index] > 0.0) {
+			elasticTasks[index].desiredPeriod = (uint32_t) (executionTime[index] / utilization[index]);
+		} else {
+			elasticTasks[index].desiredPeriod = elasticTasks[index].nominalPeriod;
+		}
+	}
+}
+
+/**
+ * This is the task method.  It measures the load on the cores of the elastic tasks and adjusts their periods.
+ */
+void ElasticManager::taskMethod() {
+	if (elasticTasks.empty()) {
+		return;
+	}
+
+	/**
+	 * 1.0 Find the cores which the elastic tasks may run on.
+	 */
+	uint32_t elasticCores = 0;
+	bool allCores = false;
+	for (std::vector<ElasticTask>::iterator it = elasticTasks.begin(); it != elasticTasks.end(); it++) {
+		uint32_t mask = it->task->getCPUAffinity();
+		allCores = allCores || (mask == 0);
+		elasticCores |= mask;
+	}
+	if (allCores) {
+		elasticCores = 0;
+		coreCount.store((uint32_t) sysconf(_SC_NPROCESSORS_ONLN), std::memory_order_relaxed);
+	} else {
+		coreCount.store((uint32_t) __builtin_popcount(elasticCores), std::memory_order_relaxed);
+	}
+
+	/**
+	 * 2.0 Add up the utilization of every other periodic task which shares one of those cores.  These tasks are never stretched,
+	 * so the elastic tasks get what they leave over.
+	 */
+	double otherUtilization = 0.0;
+	for (std::list<RunnableClass*>::iterator it = RunnableClass::runningThreads.begin();
+			it != RunnableClass::runningThreads.end(); it++) {
+		PeriodicTask *pt = dynamic_cast<PeriodicTask*>(*it);
+		if (pt == NULL || !sharesCore(pt->getCPUAffinity(), elasticCores)) {
+			continue;
+		}
+		bool elastic = false;
+		for (std::vector<ElasticTask>::iterator et = elasticTasks.begin(); et != elasticTasks.end(); et++) {
+			elastic = elastic || (et->task == pt);
+		}
+		if (!elastic) {
+			otherUtilization += (double) pt->getAverageExecutionTime() / (double) pt->getTaskPeriod();
+		}
+	}
+	hardUtilization.store(otherUtilization, std::memory_order_relaxed);
+
+	/**
+	 * 3.0 Compress the elastic tasks into the capacity which is left.
+	 */
+	compress(utilizationBound * coreCount.load(std::memory_order_relaxed) - otherUtilization);
+
+	/**
+	 * 4.0 Apply the new periods.  No task runs faster than its nominal period or slower than its maximum, and no single task is
+	 * allowed more than the largest utilization of one task.  Small changes are ignored, except for a return to the nominal period.
+	 */
+	for (std::vector<ElasticTask>::iterator it = elasticTasks.begin(); it != elasticTasks.end(); it++) {
+		uint32_t period = it->desiredPeriod;
+		uint32_t selfLimitedPeriod = (uint32_t) (it->task->getAverageExecutionTime() / ELASTIC_MAX_TASK_UTILIZATION);
+		if (period < selfLimitedPeriod) {
+			period = selfLimitedPeriod;
+		}
+		if (period < it->nominalPeriod) {
+			period = it->nominalPeriod;
+		}
+		if (period > it->maximumPeriod) {
+			period = it->maximumPeriod;
+		}
+		it->desiredPeriod = period;
+
+		uint32_t currentPeriod = it->task->getTaskPeriod();
+		double change = ((double) period - (double) currentPeriod) / (double) currentPeriod;
+		if (period != currentPeriod
+				&& (period == it->nominalPeriod || change > ELASTIC_PERIOD_HYSTERESIS || change < -ELASTIC_PERIOD_HYSTERESIS)) {
+			it->task->setTaskPeriod(period);
+			adjustmentCount.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+}
+
+/**
+ * This method will print the state of each elastic task to the console.
+ */
+void ElasticManager::printElasticTasks() {
+	std::cout << "===============================================================================================\nElastic Tasks:\n";
+	uint32_t cores = coreCount.load(std::memory_order_relaxed);
+	std::cout << "Cores: " << cores << "\tBound: " << std::fixed << std::setprecision(3) << utilizationBound * cores
+			<< "\tOther Tasks: " << hardUtilization.load(std::memory_order_relaxed) << "\tAdjustments: "
+			<< adjustmentCount.load(std::memory_order_relaxed) << "\n";
+	std::cout << "Task              \tNominal(us)\t    Max(us)\tElasticity\tPeriod(us)\tAvg C(us)\tUtilization\n";
+	for (std::vector<ElasticTask>::iterator it = elasticTasks.begin(); it != elasticTasks.end(); it++) {
+		uint32_t period = it->task->getTaskPeriod();
+		long executionTime = it->task->getAverageExecutionTime();
+		std::cout << std::setw(18) << it->task->myName << "\t" << std::setw(11) << it->nominalPeriod << "\t" << std::setw(11)
+				<< it->maximumPeriod << "\t" << std::setw(10) << std::setprecision(2) << it->elasticity << "\t" << std::setw(10)
+				<< period << "\t" << std::setw(9) << executionTime << "\t" << std::setw(11) << std::setprecision(3)
+				<< (double) executionTime / (double) period << "\n";
+	}
+	std::cout << "===============================================================================================\n";
+}
@@ -0,0 +1,150 @@
+/**
+ * @file ElasticManager.h
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ *      This file defines the elastic manager.  The elastic manager is a periodic task which keeps the cores used by a set of
+ *      elastic tasks from being overloaded, following the elastic task model of Buttazzo.  Each elastic task is given a nominal
+ *      period, a maximum period and an elasticity.  When the total utilization of the cores would exceed the bound, the elastic
+ *      tasks are compressed: utilization is taken from each in proportion to its elasticity, and a task which reaches its maximum
+ *      period stays there while the rest is taken from the others.  When the load drops, the tasks return to their nominal
+ *      periods.
+ *
+ *      Utilization is computed from the moving average of the execution time of each task, so the manager follows the actual load,
+ *      such as a slower frame rate when the Pi throttles its clock.  Every other periodic task which shares a core with an elastic
+ *      task counts toward the load, but its period is never changed.
+ */
+
+#ifndef ELASTICMANAGER_H_
+#define ELASTICMANAGER_H_
+
+#include "PeriodicTask.h"
+#include <atomic>
+#include <vector>
+#include <stdint.h>
+
+class ElasticManager: public PeriodicTask {
+private:
+	/**
+	 * This structure holds the elastic parameters of one task.
+	 */
+	struct ElasticTask {
+		/**
+		 * This is the task whose period is managed.
+		 */
+		PeriodicTask *task;
+
+		/**
+		 * This is the period of the task without overload, in microseconds.  The task never runs faster than this.
+		 */
+		uint32_t nominalPeriod;
+
+		/**
+		 * This is the longest period the task may be stretched to, in microseconds.
+		 */
+		uint32_t maximumPeriod;
+
+		/**
+		 * This is the elasticity of the task.  A task with a larger elasticity gives up more of its utilization.
+		 */
+		double elasticity;
+
+		/**
+		 * This is the period which the last adjustment computed for the task, in microseconds.
+		 */
+		uint32_t desiredPeriod;
+	};
+
+	/**
+	 * These are the tasks whose periods are managed.
+	 */
+	std::vector<ElasticTask> elasticTasks;
+
+	/**
+	 * This is the utilization per core which the cores of the elastic tasks are kept within.
+	 */
+	double utilizationBound;
+
+	/**
+	 * This is the utilization of the tasks which are not elastic on the cores of the elastic tasks, as of the last adjustment.
+	 * It and the two counts below are printed from the console thread, so they are atomic.
+	 */
+	std::atomic<double> hardUtilization = {0.0};
+
+	/**
+	 * This is the number of cores which the elastic tasks may run on.
+	 */
+	std::atomic<uint32_t> coreCount = {1};
+
+	/**
+	 * This is the number of times the period of an elastic task has been changed.
+	 */
+	std::atomic<uint32_t> adjustmentCount = {0};
+
+	/**
+	 * This method will determine if two core masks share a core.  A mask of 0 means all cores.
+	 * @param firstMask This is the first mask.
+	 * @param secondMask This is the second mask.
+	 * @return true if the masks share a core.
+	 */
+	static bool sharesCore(uint32_t firstMask, uint32_t secondMask);
+
+	/**
+	 * This method will compress the elastic tasks so that their total utilization fits within the given capacity.
+	 * @param capacity This is the utilization which is left for the elastic tasks.
+	 */
+	void compress(double capacity);
+
+public:
+	/**
+	 * This is the default constructor for the class.
+	 * @param threadName This is the name of the thread in a human readable format.
+	 * @param period This is the period of the manager, given in microseconds.
+	 * @param utilizationBound This is the utilization per core which the cores of the elastic tasks are kept within.
+	 */
+	ElasticManager(std::string threadName, uint32_t period, double utilizationBound);
+
+	/**
+	 * This is the destructor for the class.
+	 */
+	virtual ~ElasticManager();
+
+	/**
+	 * This method will add a task whose period is to be managed.  Its period when it is added is its nominal period.  It must be
+	 * called before the manager is started.
+	 * @param task This is the task that is to be managed.  It must run on its own thread, not from a cyclic executive.
+	 * @param maximumPeriod This is the longest period the task may be stretched to, in microseconds.
+	 * @param elasticity This is the elasticity of the task.  It must be greater than 0.
+	 */
+	void addTask(PeriodicTask *task, uint32_t maximumPeriod, double elasticity);
+
+	/**
+	 * This is the task method.  It measures the load on the cores of the elastic tasks and adjusts their periods.
+	 */
+	void taskMethod();
+
+	/**
+	 * This method will print the state of each elastic task to the console.
+	 */
+	void printElasticTasks();
+};
+
+#endif /* ELASTICMANAGER_H_ */
@@ -0,0 +1,231 @@
+/**
+ * @file EventLoop.cpp
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ *      This file implements the event loop, which blocks on command queues and timers with epoll.
+ */
+
+#include "EventLoop.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+/**
+ * This is the epoll tag of the stop event.  Every other tag is the index of a source.
+ */
+#define STOP_EVENT_TAG (0xFFFFFFFF)
+
+/**
+ * This is the default constructor for the class.  It creates the epoll instance and the stop event.
+ */
+EventLoop::EventLoop() {
+	epollFD = epoll_create1(EPOLL_CLOEXEC);
+	stopFD = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+	struct epoll_event event;
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.u32 = STOP_EVENT_TAG;
+	if (epoll_ctl(epollFD, EPOLL_CTL_ADD, stopFD, &event) != 0) {
+		printf("Failed to create the event loop: %s\n", strerror(errno));
+	}
+}
+
+/**
+ * This is the destructor for the class.  It closes the timers and the epoll instance, but not the queues.
+ */
+EventLoop::~EventLoop() {
+	for (std::vector<EventSource>::iterator it = sources.begin(); it != sources.end(); it++) {
+		if (it->queue == NULL) {
+			close(it->fd);
+		}
+	}
+	close(stopFD);
+	close(epollFD);
+}
+
+/**
+ * This method will register a source with epoll.
+ * @param source This is the source that is to be added.
+ * @return true if the source was added.  False otherwise.
+ */
+bool EventLoop::addSource(const EventSource &source) {
+	struct epoll_event event;
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.u32 = sources.size();
+	if (epoll_ctl(epollFD, EPOLL_CTL_ADD, source.fd, &event) != 0) {
+		printf("Failed to add an event source: %s\n", strerror(errno));
+		return false;
+	}
+	sources.push_back(source);
+	return true;
+}
+
+/**
+ * This method will add a command queue to the loop.  Every command enqueued on it is passed to the handler, in order, on the
+ * thread running the loop.  It must be called before the loop is run.
+ * @param queue This is the queue that is to be waited on.
+ * @param handler This is the handler for the commands from the queue.
+ * @return true if the queue was added.  False otherwise.
+ */
+bool EventLoop::addQueue(CommandQueue *queue, CommandHandler handler) {
+	EventSource source;
+	source.fd = queue->getEventFD();
+	source.queue = queue;
+	source.commandHandler = handler;
+	return addSource(source);
+}
+
+/**
+ * This method will add a command queue to the loop which is drained in batches.  Each time the queue is signalled, every command
+ * on it is passed to the handler at once, in batches of up to COMMAND_QUEUE_BATCH, so that the handler can act on a whole burst.
+ * It must be called before the loop is run.
+ * @param queue This is the queue that is to be waited on.
+ * @param handler This is the handler for the batches of commands from the queue.
+ * @return true if the queue was added.  False otherwise.
+ */
+bool EventLoop::addBatchQueue(CommandQueue *queue, CommandBatchHandler handler) {
+	EventSource source;
+	source.fd = queue->getEventFD();
+	source.queue = queue;
+	source.commandBatchHandler = handler;
+	return addSource(source);
+}
+
+/**
+ * This method will add a periodic timer to the loop.  It must be called before the loop is run.
+ * @param periodInUs This is the period of the timer in microseconds.  The first expiration is one period from now.
+ * @param handler This is the handler that is called each time the timer expires.  If the loop falls behind, expirations
+ * which were missed are folded into one call.
+ * @return true if the timer was added.  False otherwise.
+ */
+bool EventLoop::addTimer(uint32_t periodInUs, TimerHandler handler) {
+	EventSource source;
+	source.fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	source.queue = NULL;
+	source.timerHandler = handler;
+
+	struct itimerspec timerSetting;
+	timerSetting.it_interval.tv_sec = periodInUs / 1000000;
+	timerSetting.it_interval.tv_nsec = (periodInUs % 1000000) * 1000;
+	timerSetting.it_value = timerSetting.it_interval;
+	if (source.fd < 0 || timerfd_settime(source.fd, 0, &timerSetting, NULL) != 0 || !addSource(source)) {
+		printf("Failed to add a timer to the event loop\n");
+		if (source.fd >= 0) {
+			close(source.fd);
+		}
+		return false;
+	}
+	return true;
+}
+
+/**
+ * This method will handle an event on one source.
+ * @param source This is the source which is readable.
+ */
+void EventLoop::dispatch(EventSource &source) {
+	uint64_t count;
+
+	/**
+	 * 1.0 Reading the descriptor clears it, for both an eventfd and a timerfd.
+	 */
+	if (read(source.fd, &count, sizeof(count)) != sizeof(count)) {
+		return;
+	}
+
+	if (source.queue != NULL) {
+		/**
+		 * 2.0 Hand every command that is now on the queue to the handler.  A command enqueued after the read signals the eventfd
+		 * again, so at worst the next wakeup finds the queue already empty.
+		 */
+		CommandEnvelope commands[COMMAND_QUEUE_BATCH];
+		uint32_t commandCount;
+		while ((commandCount = source.queue->tryDequeueUpTo(commands, COMMAND_QUEUE_BATCH)) > 0) {
+			if (source.commandBatchHandler) {
+				source.commandBatchHandler(commands, commandCount);
+			} else {
+				for (uint32_t index = 0; index < commandCount; index++) {
+					source.commandHandler(commands[index]);
+				}
+			}
+		}
+	} else {
+		/**
+		 * 3.0 The timer expired.
+		 */
+		source.timerHandler();
+	}
+}
+
+/**
+ * This method will run the loop on the calling thread until stop is called.
+ */
+void EventLoop::run() {
+	struct epoll_event events[EVENT_LOOP_MAX_EVENTS];
+	bool stopRequested = false;
+
+	while (!stopRequested) {
+		/**
+		 * 1.0 Block until at least one source is ready.
+		 */
+		int readyCount = epoll_wait(epollFD, events, EVENT_LOOP_MAX_EVENTS, -1);
+		if (readyCount < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			printf("The event loop failed: %s\n", strerror(errno));
+			return;
+		}
+
+		/**
+		 * 2.0 Dispatch each ready source.  The remaining sources are still handled if a stop has been requested.
+		 */
+		for (int index = 0; index < readyCount; index++) {
+			if (events[index].data.u32 == STOP_EVENT_TAG) {
+				stopRequested = true;
+			} else {
+				dispatch(sources[events[index].data.u32]);
+			}
+		}
+	}
+
+	/**
+	 * 3.0 Clear the stop event, so that the loop can be run again.
+	 */
+	uint64_t count;
+	ssize_t bytesRead = read(stopFD, &count, sizeof(count));
+	(void) bytesRead;
+}
+
+/**
+ * This method will stop the loop.  It may be called from any thread, and wakes the loop if it is blocked.
+ */
+void EventLoop::stop() {
+	uint64_t one = 1;
+	ssize_t written = write(stopFD, &one, sizeof(one));
+	(void) written;
+}
@@ -0,0 +1,169 @@
+/**
+ * @file EventLoop.h
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ *      This file defines an event loop.  An event loop lets the thread of a runnable class block on several command queues and
+ *      timers at once, using epoll.  Each command is handed to its handler as soon as it is enqueued, and the thread uses no
+ *      CPU time while it waits.  Stopping the loop wakes it immediately, so that the thread can shut down promptly.
+ */
+
+#ifndef EVENTLOOP_H_
+#define EVENTLOOP_H_
+
+#include "CommandQueue.h"
+#include <functional>
+#include <vector>
+#include <stdint.h>
+
+/**
+ * This is the largest number of ready sources which are handled for each wait on epoll.
+ */
+#define EVENT_LOOP_MAX_EVENTS (8)
+
+class EventLoop {
+public:
+	/**
+	 * This is the type of the handler which is called for each command dequeued from a queue.
+	 */
+	typedef std::function<void(const CommandEnvelope&)> CommandHandler;
+
+	/**
+	 * This is the type of the handler which is called with each batch of commands dequeued from a queue.  The first argument is
+	 * the array of commands, in order, and the second is the number of commands in it.
+	 */
+	typedef std::function<void(const CommandEnvelope*, uint32_t)> CommandBatchHandler;
+
+	/**
+	 * This is the type of the handler which is called each time a timer expires.
+	 */
+	typedef std::function<void()> TimerHandler;
+
+private:
+	/**
+	 * This structure describes one of the sources that the loop waits on.
+	 */
+	struct EventSource {
+		/**
+		 * This is the file descriptor which becomes readable when the source has an event.
+		 */
+		int fd;
+
+		/**
+		 * This is the queue of the source, or NULL if the source is a timer.
+		 */
+		CommandQueue *queue;
+
+		/**
+		 * This is the handler which is called for each command, if the source is a queue.
+		 */
+		CommandHandler commandHandler;
+
+		/**
+		 * This is the handler which is called for each batch of commands, if the source is a queue which is drained in batches.
+		 */
+		CommandBatchHandler commandBatchHandler;
+
+		/**
+		 * This is the handler which is called on each expiration, if the source is a timer.
+		 */
+		TimerHandler timerHandler;
+	};
+
+	/**
+	 * This is the epoll instance which the loop waits on.
+	 */
+	int epollFD;
+
+	/**
+	 * This is an eventfd which is signalled to stop the loop.
+	 */
+	int stopFD;
+
+	/**
+	 * These are the sources which have been added to the loop.  The index of each source is stored with its epoll registration.
+	 */
+	std::vector<EventSource> sources;
+
+	/**
+	 * This method will register a source with epoll.
+	 * @param source This is the source that is to be added.
+	 * @return true if the source was added.  False otherwise.
+	 */
+	bool addSource(const EventSource &source);
+
+	/**
+	 * This method will handle an event on one source.
+	 * @param source This is the source which is readable.
+	 */
+	void dispatch(EventSource &source);
+
+public:
+	/**
+	 * This is the default constructor for the class.  It creates the epoll instance and the stop event.
+	 */
+	EventLoop();
+
+	/**
+	 * This is the destructor for the class.  It closes the timers and the epoll instance, but not the queues.
+	 */
+	virtual ~EventLoop();
+
+	/**
+	 * This method will add a command queue to the loop.  Every command enqueued on it is passed to the handler, in order, on the
+	 * thread running the loop.  It must be called before the loop is run.
+	 * @param queue This is the queue that is to be waited on.
+	 * @param handler This is the handler for the commands from the queue.
+	 * @return true if the queue was added.  False otherwise.
+	 */
+	bool addQueue(CommandQueue *queue, CommandHandler handler);
+
+	/**
+	 * This method will add a command queue to the loop which is drained in batches.  Each time the queue is signalled, every command
+	 * on it is passed to the handler at once, in batches of up to COMMAND_QUEUE_BATCH, so that the handler can act on a whole burst.
+	 * It must be called before the loop is run.
+	 * @param queue This is the queue that is to be waited on.
+	 * @param handler This is the handler for the batches of commands from the queue.
+	 * @return true if the queue was added.  False otherwise.
+	 */
+	bool addBatchQueue(CommandQueue *queue, CommandBatchHandler handler);
+
+	/**
+	 * This method will add a periodic timer to the loop.  It must be called before the loop is run.
+	 * @param periodInUs This is the period of the timer in microseconds.  The first expiration is one period from now.
+	 * @param handler This is the handler that is called each time the timer expires.  If the loop falls behind, expirations
+	 * which were missed are folded into one call.
+	 * @return true if the timer was added.  False otherwise.
+	 */
+	bool addTimer(uint32_t periodInUs, TimerHandler handler);
+
+	/**
+	 * This method will run the loop on the calling thread until stop is called.
+	 */
+	void run();
+
+	/**
+	 * This method will stop the loop.  It may be called from any thread, and wakes the loop if it is blocked.
+	 */
+	void stop();
+};
+
+#endif /* EVENTLOOP_H_ */
@@ -34,6 +34,8 @@
 #include <time.h>
 #include <pthread.h>
 #include "GenericThreadInfo.h"
+#include "TaskStacks.h"
+#include "Trace.h"
 #include <sys/syscall.h>
 #include <unistd.h>
 
@@ -200,7 +202,7 @@ static void myInterrupt27();
  */
 static void myInterrupt28();
 
-static std::mutex cmtx;
+static PIMutex cmtx("GPIO constructor");
 
 /**
  * This will initialize the initialzed variable to 0 until a constructor is invoked.
@@ -225,8 +227,9 @@ void* startCallbackHander(void *gpioInstance) {
  * output.
  * @param val This is the default value for the GPIO pin.
  */
-GPIO::GPIO(int number, DIRECTION dir, VALUE val) {
-	std::unique_lock<std::mutex> lck(cmtx);
+GPIO::GPIO(int number, DIRECTION dir, VALUE val) :
+		mtx("GPIO " + std::to_string(number)) {
+	std::unique_lock<PIMutex> lck(cmtx);
 	// If this is the first time that a constructor has been invoked, initialize
 	// the wiringPi devices and setup the pointers.
 	if (GPIO::initialized == 0) {
@@ -248,6 +251,7 @@ GPIO::GPIO(int number, DIRECTION dir, VALUE val) {
 	isrRisingTimestamp.tv_sec = 0;
 	isrFallingTimestamp.tv_nsec = 0;
 	isrFallingTimestamp.tv_sec = 0;
+	isrTraceBuffer = NULL;
 
 	// Based upon the GPIO direction, setup the pin accordingly.
 	if (dir == GPIO::DIRECTION::GPIO_OUT) {
@@ -313,6 +317,11 @@ void GPIO::enableEdgeInterrupt(EDGE edgeType) {
 		responsiveEdges = INT_EDGE_SETUP;
 	}
 
+	// Create the trace buffer of the interrupt thread now, rather than on the first interrupt.
+	if (isrTraceBuffer == NULL) {
+		isrTraceBuffer = Trace::reserveThreadBuffer(("GPIO " + std::to_string(number)).c_str());
+	}
+
 	// The following code is ugly, but it sets up the method to be invoked
 	// when an edge transition occurs. There is a much cleaner way of doing
 	// this with table entries and function pointers.
@@ -415,7 +424,7 @@ void GPIO::enableEdgeInterrupt(EDGE edgeType) {
  */
 int GPIO::waitForEdge(int maxWait) // waits until button is pressed up to a maximum value.
 		{
-	std::unique_lock<std::mutex> lck(mtx);
+	std::unique_lock<PIMutex> lck(mtx);
 
 	if (std::cv_status::timeout
 			== cv.wait_for(lck, std::chrono::milliseconds(maxWait))) {
@@ -474,6 +483,7 @@ void GPIO::setCallbackMethod(CallbackType methodCallback) {
 
 		pthread_attr_t tattr;
 		pthread_attr_init(&tattr);
+		pthread_attr_setstacksize(&tattr, GPIO_CALLBACK_STACK_SIZE);
 		pthread_getschedparam(pthread_self(), &policy, &sparam);
 
 		pthread_create(&thread, &tattr, &startCallbackHander,
@@ -494,7 +504,7 @@ void GPIO::setCallbackMethod(CallbackType methodCallback) {
 void GPIO::callBackThreadHandler() {
 	while (this->methodCallback != NULL) {
 
-		std::unique_lock<std::mutex> lck(mtx);
+		std::unique_lock<PIMutex> lck(mtx);
 		ccv.wait(lck);
 		this->methodCallback(0);
 	}
@@ -512,6 +522,9 @@ void GPIO::handleInterruptDrivenGPIOPin() {
 		// Update the timestamp for the interrupt.
 		clock_gettime(CLOCK_REALTIME, &isrFallingTimestamp);
 	}
+	// Trace the interrupt only once the edge has been timed.
+	Trace::adoptThreadBuffer(isrTraceBuffer);
+	TRACE_EVENT(TRACE_ISR, "GPIO interrupt", number);
 	// Notify the condition variable for a blocked call.
 	cv.notify_one();
 	// Notify the condition variable for the callback.
@@ -32,8 +32,10 @@
 #ifndef GPIO_H_
 #define GPIO_H_
 
-#include <mutex>              // std::mutex, std::unique_lock
-#include <condition_variable> // std::condition_variable
+#include <mutex>              // std::unique_lock
+#include <condition_variable> // std::condition_variable_any
+#include "PIMutex.h"
+#include "Trace.h"
 
 #define NUMBER_OF_GPIO_PINS (28)
 
@@ -85,14 +87,14 @@ private:
 	 * This is a mutex that is used to protect critical resources within this
 	 * class.
 	 */
-	std::mutex mtx;
+	PIMutex mtx;
 	
 	/**
 	 * These two condition variables are used internally to allow the
 	 * invocation of a callback method and a block for edge method.
 	 */
-	std::condition_variable cv;
-	std::condition_variable ccv;
+	std::condition_variable_any cv;
+	std::condition_variable_any ccv;
 
 	/**
 	 * This is a callback variable that is used to invoke a method when a
@@ -112,6 +114,12 @@ private:
 	 */
 	struct timespec isrFallingTimestamp;
 
+	/**
+	 * This is the trace buffer of the interrupt thread of the pin.  It is created when the interrupt is enabled, so that the first
+	 * interrupt does not allocate it while an edge is being timed.
+	 */
+	Trace::ThreadBuffer *isrTraceBuffer;
+
 
 
 public:
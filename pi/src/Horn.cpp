@@ -11,15 +11,29 @@ using namespace se3910RPi;
 * @param taskRate This is the rate at which the thread re-executes.
 */
 Horn::Horn(CommandQueue *queue, int gpioPin, std::string threadName, uint32_t taskRate):
-PeriodicTask(threadName, taskRate) {
+PeriodicTask(threadName, taskRate), pulseGeneration(0), pulseMutex(threadName + " pulses") {
     myqueue = queue;
     hornPin = new GPIO(gpioPin, GPIO::GPIO_OUT);
     hornPin->setValue(GPIO::GPIO_LOW);
 }
 /**
+* This constructor creates a horn whose pulses are timed by one-shot timers from a timer service, so that the on and off
+* times are exact rather than rounded to the period of the task.
+* @param queue This is the queue that this task is to read from.
+* @param gpioPin This is the GPIO pin that the buzzer is attached to.
+* @param timerService This is the timer service which times the pulses.
+* @param threadName This is the name that is to be given to the executing thread as a string.
+* @param taskRate This is the rate at which the thread re-executes.
+*/
+Horn::Horn(CommandQueue *queue, int gpioPin, TimerService *timerService, std::string threadName, uint32_t taskRate):
+Horn(queue, gpioPin, threadName, taskRate) {
+    this->timerService = timerService;
+}
+/**
 * This is the default destructor that will clean up from the class.
 */
 Horn::~Horn() {
+    stopTimedPulses();
     delete myqueue;
     delete hornPin;
 }
@@ -27,6 +41,7 @@ Horn::~Horn() {
 * This method will cause the horn to sound continuously until stopped.
 */
 void Horn::soundHorn() {
+    stopTimedPulses();
     length = 0;
     repetitionTime = 1;
     hornPin->setValue(GPIO::GPIO_HIGH);
@@ -51,27 +66,82 @@ void Horn::pulseHorn(int length, int period) {
 * This method will silence the horn so that it no longer is making any audio noise.
 */
 void Horn::silenceHorn() {
+    stopTimedPulses();
     length = 0;
     repetitionTime = 1;
     hornPin->setValue(GPIO::GPIO_LOW);
 }
 /**
+* This method will start pulsing the horn with timers from the timer service.
+* @param length This is the length of the on time, given in ms.
+* @param period This is the period for the horn, given in ms.
+*/
+void Horn::startTimedPulses(int length, int period) {
+    stopTimedPulses();
+    uint32_t generation = pulseGeneration.load();
+    uint32_t onTime = length * 1000;
+
+    // Each pulse turns the horn on and sets a one-shot timer to turn it off again.
+    // The generation is checked and the pin driven under the mutex, so that the horn can not be stopped in between.
+    TimerService::TimerCallback pulse = [this, generation, onTime]() {
+        {
+            std::lock_guard<PIMutex> lock(pulseMutex);
+            if (pulseGeneration.load() != generation) {
+                return;
+            }
+            hornPin->setValue(GPIO::GPIO_HIGH);
+        }
+        timerService->addOneShot(onTime, [this, generation]() {
+            std::lock_guard<PIMutex> lock(pulseMutex);
+            if (pulseGeneration.load() == generation) {
+                hornPin->setValue(GPIO::GPIO_LOW);
+            }
+        });
+    };
+    pulse();
+    pulseTimer = timerService->addTimer(period * 1000, period * 1000, pulse);
+}
+/**
+* This method will stop any pulses which are timed by the timer service.
+*/
+void Horn::stopTimedPulses() {
+    {
+        // Once this returns, no timer from before drives the pin, so the caller may set it.
+        std::lock_guard<PIMutex> lock(pulseMutex);
+        pulseGeneration++;
+    }
+    if (pulseTimer != 0) {
+        timerService->cancelTimer(pulseTimer);
+        pulseTimer = 0;
+    }
+}
+/**
 * This is the task method for the class.
 */
 void Horn::taskMethod() {
-    if (myqueue->hasItem()) {
-        int item = myqueue->dequeue();
-        int type = item & 0xF0000000;
+    // Each command sets the whole state of the horn, so only the last one of a burst matters.
+    CommandEnvelope items[COMMAND_QUEUE_BATCH];
+    uint32_t count = myqueue->tryDequeueUpTo(items, COMMAND_QUEUE_BATCH);
+    if (count > 0) {
+        const CommandEnvelope &item = items[count - 1];
+        int type = (int) item.opcode;
         if (type == HORN_MUTE_COMMAND) {
             silenceHorn();
         } else if (type == HORN_SOUND_COMMAND) {
             soundHorn();
         } else if (type == HORN_PULSE_COMMAND) {
-            hornCount = 0;
-            this->length = item & 0x00000FFF;
-            this->repetitionTime = (item >> 3) & 0x00000FFF;
-            printf("%d\n", repetitionTime);
-            printf("%d\n", length);
+            // The lowest 12 bits are the period, and the next 12 bits are the on time, both in ms.
+            int onTime = item.getArgument();
+            int period = item.getValue();
+            if ((timerService != NULL) && (onTime > 0) && (period > onTime)) {
+                this->length = 0;
+                startTimedPulses(onTime, period);
+            } else {
+                stopTimedPulses();
+                hornCount = 0;
+                this->length = onTime;
+                this->repetitionTime = period;
+            }
         }
     }
     if (this->length > 0) {
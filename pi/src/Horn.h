@@ -31,6 +31,8 @@
 #include <thread>
 #include "PeriodicTask.h"
 #include "CommandQueue.h"
+#include "TimerService.h"
+#include <atomic>
 
 class Horn: public PeriodicTask {
 public:
@@ -42,6 +44,17 @@ public:
 	 * @param taskRate This is the rate at which the thread re-executes.
 	 */
 	Horn(CommandQueue *queue, int gpioPin, std::string threadName, uint32_t taskRate);
+
+	/**
+	 * This constructor creates a horn whose pulses are timed by one-shot timers from a timer service, so that the on and off
+	 * times are exact rather than rounded to the period of the task.
+	 * @param queue This is the queue that this task is to read from.
+	 * @param gpioPin This is the GPIO pin that the buzzer is attached to.
+	 * @param timerService This is the timer service which times the pulses.
+	 * @param threadName This is the name that is to be given to the executing thread as a string.
+	 * @param taskRate This is the rate at which the thread re-executes.
+	 */
+	Horn(CommandQueue *queue, int gpioPin, TimerService *timerService, std::string threadName, uint32_t taskRate);
 	/**
 	 * This is the default destructor that will clean up from the class.
 	 */
@@ -93,6 +106,40 @@ private:
 	 * This is the length of time until repetition is to occur again in ms.
 	 */
 	int repetitionTime = 1;
+
+	/**
+	 * This is the timer service which times the pulses, or NULL if the pulses are timed by the task itself.
+	 */
+	TimerService *timerService = NULL;
+
+	/**
+	 * This is the periodic timer which starts each pulse, or 0 if the horn is not pulsing.
+	 */
+	TimerService::TimerID pulseTimer = 0;
+
+	/**
+	 * This is incremented each time the horn changes what it is doing.  A timer which was set up for an earlier command sees that
+	 * it has changed, and does nothing.
+	 */
+	std::atomic<uint32_t> pulseGeneration;
+
+	/**
+	 * This mutex is held while the generation is changed, and while a timer checks the generation and drives the pin.  Without it,
+	 * a timer could check the generation, the horn be silenced, and the timer then turn the horn back on for good.
+	 */
+	PIMutex pulseMutex;
+
+	/**
+	 * This method will start pulsing the horn with timers from the timer service.
+	 * @param length This is the length of the on time, given in ms.
+	 * @param period This is the period for the horn, given in ms.
+	 */
+	void startTimedPulses(int length, int period);
+
+	/**
+	 * This method will stop any pulses which are timed by the timer service.
+	 */
+	void stopTimedPulses();
 };
 
 #endif /* HORN_H_ */
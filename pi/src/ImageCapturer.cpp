@@ -21,6 +21,24 @@ ImageCapturer::ImageCapturer(Camera *referencedCamera, ImageTransmitter *trans,
 	imageWidth = width;
 	imageHeight = height;
 	size = new Size(width, height);
+
+	// Transmitting images is the least important work on the robot, so the stream sheds frames when it cannot keep up.
+	setOverrunPolicy(DEGRADE);
+}
+
+/**
+ * This method is called when the stream has overrun its period.  It doubles the decimation, up to IMAGE_CAPTURER_MAX_DECIMATION, so
+ * that the stream sheds load instead of starving the lower priority tasks.  If the execution ran over several periods, the
+ * decimation is raised far enough that one execution fits between the releases which transmit.
+ * @param missedReleases This is the number of releases which were already due when the execution completed.
+ */
+void ImageCapturer::handleOverrun(uint32_t missedReleases) {
+	uint32_t needed = decimation * 2;
+	if (needed < missedReleases + 1) {
+		needed = missedReleases + 1;
+	}
+	decimation = needed < IMAGE_CAPTURER_MAX_DECIMATION ? needed : IMAGE_CAPTURER_MAX_DECIMATION;
+	releasesSinceOverrun = 0;
 }
 
 /**
@@ -39,7 +57,22 @@ void ImageCapturer::taskMethod() {
 	static milliseconds totalTransmit(0);
 	static long framesTransmitted = 0;
 
+	/**
+	 * 0.1 Once the stream has kept up for long enough, halve the decimation to send more images again.
+	 */
+	releaseCount++;
+	releasesSinceOverrun++;
+	if (decimation > 1 && releasesSinceOverrun >= IMAGE_CAPTURER_RECOVERY_RELEASES) {
+		decimation /= 2;
+		releasesSinceOverrun = 0;
+	}
 
+	/**
+	 * 0.2 If the stream is decimated, only every decimation'th release sends an image.
+	 */
+	if (releaseCount % decimation != 0) {
+		return;
+	}
 
 	/**
 	 * 1.0 Obtain the time since the epoch from the system clock in ms.
@@ -105,9 +138,10 @@ void ImageCapturer::taskMethod() {
 		cout << "Transmit:\t" << (delta.count()) << "\t";
 		milliseconds delayTime = std::chrono::milliseconds(getTaskPeriod() / 1000) - (end - start);
 		if (delayTime.count() < 0) {
-			xmitTimeDeadlineMissCount++;
+			// The miss itself is counted by the periodic task, which applies the overrun policy once this release completes.
 			cout << "Delaying:\t" << delayTime.count()
-			 << " Missed Deadline Count: " << xmitTimeDeadlineMissCount
+			 << " Overrun Count: " << getOverrunCount()
+			 << " Decimation: " << decimation
 			 << "\n" << std::flush;
 		} else {
 			cout << "Delaying:\t" << delayTime.count() << "\t" << std::flush;
@@ -10,6 +10,17 @@
 #include "Camera.h"
 #include "ImageTransmitter.h"
 
+/**
+ * This is the largest decimation the image stream will fall back to when it overruns.  At a decimation of n, only one release in
+ * n captures and transmits an image.
+ */
+#define IMAGE_CAPTURER_MAX_DECIMATION (8)
+
+/**
+ * This is the number of releases in a row without an overrun after which the image stream halves its decimation again.
+ */
+#define IMAGE_CAPTURER_RECOVERY_RELEASES (30)
+
 class ImageCapturer: public PeriodicTask {
 private:
 	/**
@@ -43,9 +54,30 @@ private:
 	int count = 0;
 
 	/**
-	 * This variable will keep track of how many times the image has failed to transmit in an appropriate amount of time (i.e. we have not ttransmitted fast enough.)
+	 * This is the current frame decimation.  Only one release in this many captures and transmits an image.  It is raised each time the
+	 * stream overruns its period, and lowered again once the stream keeps up.
+	 */
+	uint32_t decimation = 1;
+
+	/**
+	 * This is the number of releases since the last overrun, or since the decimation was last lowered.
 	 */
-	int xmitTimeDeadlineMissCount=0;
+	uint32_t releasesSinceOverrun = 0;
+
+	/**
+	 * This is the count of releases of the task.  It is used to pick which releases transmit when the stream is decimated.
+	 */
+	uint32_t releaseCount = 0;
+
+protected:
+	/**
+	 * This method is called when the stream has overrun its period.  It doubles the decimation, up to IMAGE_CAPTURER_MAX_DECIMATION, so
+	 * that the stream sheds load instead of starving the lower priority tasks.  If the execution ran over several periods, the
+	 * decimation is raised far enough that one execution fits between the releases which transmit.
+	 * @param missedReleases This is the number of releases which were already due when the execution completed.
+	 */
+	virtual void handleOverrun(uint32_t missedReleases);
+
 public:
 
 	/**
@@ -33,6 +33,7 @@
 #include <unistd.h>
 #include <stdint.h>
 #include "time_util.h"
+#include "Trace.h"
 #include <string.h>
 
 /**
@@ -123,9 +124,11 @@ int ImageTransmitter::streamImage(Mat *image) {
 		uchar *buffer = new uchar[allocationSize];
 
 		/**
-		 * 1.10 Obtain the current timestamp in ms using the time_util library.
+		 * 1.10 Obtain the current timestamp in ms using the time_util library.  It is in synchronized time, so that the station
+		 * can tell how old the image is.
 		 */
-		int timeStamp = current_timestamp();
+		int timeStamp = (int) synchronized_timestamp();
+		TRACE_EVENT(TRACE_BEGIN, "streamImage", imageCount);
 
 		/**
 		 * 1.12 Declare a variable that will keep track of the index into the image (i.e. which row is being packed right now),
@@ -156,7 +159,7 @@ int ImageTransmitter::streamImage(Mat *image) {
 			 */
             ((int *)buffer)[0] = htonl(channels);
             ((int *)buffer)[1] = htonl(timeStamp);
-            ((int *)buffer)[2] = htonl(current_timestamp());
+            ((int *)buffer)[2] = htonl((int) synchronized_timestamp());
             ((int *)buffer)[3] = htonl(imageCount);
             ((int *)buffer)[4] = htonl(rows);
             ((int *)buffer)[5] = htonl(cols);
@@ -194,6 +197,8 @@ int ImageTransmitter::streamImage(Mat *image) {
 		 * 1.13 Close the socket down.
 		 */
 		close(sockfd);
+		TRACE_EVENT(TRACE_SEND, "image sent", rows);
+		TRACE_EVENT(TRACE_END, "streamImage", imageCount);
 	}
 	return 0;
 }
@@ -0,0 +1,187 @@
+/**
+ * @file LatencyHistogram.cpp
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ *      This file implements a fixed size log-linear latency histogram.
+ */
+
+#include "LatencyHistogram.h"
+#include <iostream>
+#include <iomanip>
+
+/**
+ * This is the default constructor.  It creates an empty histogram.
+ */
+LatencyHistogram::LatencyHistogram() {
+	reset();
+}
+
+/**
+ * This is the destructor for the histogram.
+ */
+LatencyHistogram::~LatencyHistogram() {
+	// Nothing is dynamically allocated, so there is nothing to clean up.
+}
+
+/**
+ * This method will determine which bucket a value belongs in.
+ * @param value This is the value that is to be placed.
+ * @return The index of the bucket holding the value will be returned.
+ */
+uint32_t LatencyHistogram::bucketIndexOf(uint32_t value) {
+	/**
+	 * 1.0 Small values are recorded exactly in the linear range.
+	 */
+	if (value < LATENCY_HISTOGRAM_SUB_BUCKET_COUNT) {
+		return value;
+	}
+
+	/**
+	 * 2.0 Otherwise, find the most significant bit and keep only the top bits below it.  The shift tells us which power of two
+	 * range we are in, and the remaining bits tell us which linear sub-bucket within that range.
+	 */
+	uint32_t msb = 31 - __builtin_clz(value);
+	uint32_t shift = msb - (LATENCY_HISTOGRAM_SUB_BUCKET_BITS - 1);
+	uint32_t subBucket = (value >> shift) - LATENCY_HISTOGRAM_HALF_SUB_BUCKET_COUNT;
+	return (shift + 1) * LATENCY_HISTOGRAM_HALF_SUB_BUCKET_COUNT + subBucket;
+}
+
+/**
+ * This method will determine the largest value which is placed in the given bucket.
+ * @param index This is the index of the bucket.
+ * @return The return will be the highest value that maps into the bucket.
+ */
+uint32_t LatencyHistogram::highestValueInBucket(uint32_t index) {
+	if (index < LATENCY_HISTOGRAM_SUB_BUCKET_COUNT) {
+		return index;
+	}
+	uint32_t shift = index / LATENCY_HISTOGRAM_HALF_SUB_BUCKET_COUNT - 1;
+	uint64_t subBucket = index % LATENCY_HISTOGRAM_HALF_SUB_BUCKET_COUNT + LATENCY_HISTOGRAM_HALF_SUB_BUCKET_COUNT;
+	return (uint32_t) (((subBucket + 1) << shift) - 1);
+}
+
+/**
+ * This method will record a single value into the histogram.  It is safe to call from one thread while others read.
+ * @param value This is the value to record.  Negative values are recorded as 0.
+ */
+void LatencyHistogram::recordValue(int64_t value) {
+	/**
+	 * 1.0 Clamp the value into the range covered by the histogram.
+	 */
+	uint32_t clamped;
+	if (value < 0) {
+		clamped = 0;
+	} else if (value > UINT32_MAX) {
+		clamped = UINT32_MAX;
+	} else {
+		clamped = (uint32_t) value;
+	}
+
+	/**
+	 * 2.0 Count the value in its bucket and in the total.
+	 */
+	buckets[bucketIndexOf(clamped)].fetch_add(1, std::memory_order_relaxed);
+	totalCount.fetch_add(1, std::memory_order_relaxed);
+
+	/**
+	 * 3.0 Raise the maximum if this value is larger.  The loop only repeats if another thread raised the max at the same time.
+	 */
+	uint32_t currentMax = maxValue.load(std::memory_order_relaxed);
+	while ((clamped > currentMax)
+			&& (!maxValue.compare_exchange_weak(currentMax, clamped, std::memory_order_relaxed))) {
+	}
+}
+
+/**
+ * This method will obtain the value at the given percentile.  The value returned is the highest value which is equivalent
+ * to the bucket holding the percentile, so it will never understate the latency.
+ * @param percentile This is the percentile, between 0 and 100.
+ * @return The value at the given percentile will be returned, or 0 if nothing has been recorded.
+ */
+uint32_t LatencyHistogram::getValueAtPercentile(double percentile) {
+	uint32_t total = totalCount.load(std::memory_order_relaxed);
+	if (total == 0) {
+		return 0;
+	}
+
+	/**
+	 * 1.0 Figure out how many values must be at or below the answer.  Always require at least one.
+	 */
+	uint64_t target = (uint64_t) ((percentile / 100.0) * total + 0.5);
+	if (target < 1) {
+		target = 1;
+	}
+
+	/**
+	 * 2.0 Walk the buckets in order until enough values have been seen.  The answer never exceeds the exact max.
+	 */
+	uint64_t seen = 0;
+	uint32_t maxRecorded = maxValue.load(std::memory_order_relaxed);
+	for (uint32_t index = 0; index < LATENCY_HISTOGRAM_BUCKET_COUNT; index++) {
+		seen += buckets[index].load(std::memory_order_relaxed);
+		if (seen >= target) {
+			uint32_t value = highestValueInBucket(index);
+			return (value < maxRecorded) ? value : maxRecorded;
+		}
+	}
+	return maxRecorded;
+}
+
+/**
+ * This method will obtain the maximum value recorded.
+ * @return The maximum value recorded since the last reset.
+ */
+uint32_t LatencyHistogram::getMaxValue() {
+	return maxValue.load(std::memory_order_relaxed);
+}
+
+/**
+ * This method will obtain the number of values recorded.
+ * @return The total number of values recorded since the last reset.
+ */
+uint32_t LatencyHistogram::getTotalCount() {
+	return totalCount.load(std::memory_order_relaxed);
+}
+
+/**
+ * This method will clear the histogram back to its empty state.
+ */
+void LatencyHistogram::reset() {
+	for (uint32_t index = 0; index < LATENCY_HISTOGRAM_BUCKET_COUNT; index++) {
+		buckets[index].store(0, std::memory_order_relaxed);
+	}
+	totalCount.store(0, std::memory_order_relaxed);
+	maxValue.store(0, std::memory_order_relaxed);
+}
+
+/**
+ * This method will print out the count, p50, p90, p99, p99.9 and max of the histogram on a single line, tab separated,
+ * followed by a newline.
+ */
+void LatencyHistogram::printPercentiles() {
+	std::cout << std::setw(10) << getTotalCount() << "\t " << std::setw(8)
+			<< getValueAtPercentile(50.0) << "\t " << std::setw(8)
+			<< getValueAtPercentile(90.0) << "\t " << std::setw(8)
+			<< getValueAtPercentile(99.0) << "\t " << std::setw(8)
+			<< getValueAtPercentile(99.9) << "\t " << std::setw(8)
+			<< getMaxValue() << "\n";
+}
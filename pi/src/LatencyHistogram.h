@@ -0,0 +1,138 @@
+/**
+ * @file LatencyHistogram.h
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ *      This file defines a fixed size latency histogram.  Values are placed into log-linear buckets
+ *      (in the style of an HDR histogram): each power of two range is split into a fixed number of
+ *      linear sub-buckets, so the relative error of any reported value is bounded no matter how large
+ *      the value is.  Recording a value is a single relaxed atomic increment, so the histogram can be
+ *      written by a real time thread while another thread reads it.
+ */
+
+#ifndef LATENCYHISTOGRAM_H_
+#define LATENCYHISTOGRAM_H_
+
+#include <atomic>
+#include <stdint.h>
+
+/**
+ * This is the number of bits of precision kept for each value.  With 5 bits, each power of two is split into
+ * 16 linear sub-buckets, giving a worst case relative error of 1/16 (6.25%).
+ */
+#define LATENCY_HISTOGRAM_SUB_BUCKET_BITS (5)
+
+/**
+ * This is the number of linear buckets at the bottom of the histogram.  Values below this are recorded exactly.
+ */
+#define LATENCY_HISTOGRAM_SUB_BUCKET_COUNT (1 << LATENCY_HISTOGRAM_SUB_BUCKET_BITS)
+
+/**
+ * This is the number of sub-buckets in each power of two range above the linear range.
+ */
+#define LATENCY_HISTOGRAM_HALF_SUB_BUCKET_COUNT (LATENCY_HISTOGRAM_SUB_BUCKET_COUNT / 2)
+
+/**
+ * This is the total number of buckets required to cover every 32 bit value.
+ */
+#define LATENCY_HISTOGRAM_BUCKET_COUNT ((32 - LATENCY_HISTOGRAM_SUB_BUCKET_BITS + 2) * LATENCY_HISTOGRAM_HALF_SUB_BUCKET_COUNT)
+
+class LatencyHistogram {
+private:
+	/**
+	 * This is the count of values recorded into each bucket.
+	 */
+	std::atomic<uint32_t> buckets[LATENCY_HISTOGRAM_BUCKET_COUNT];
+
+	/**
+	 * This is the total number of values recorded since the last reset.
+	 */
+	std::atomic<uint32_t> totalCount;
+
+	/**
+	 * This is the largest value recorded since the last reset.  It is kept exactly, not rounded to a bucket.
+	 */
+	std::atomic<uint32_t> maxValue;
+
+	/**
+	 * This method will determine which bucket a value belongs in.
+	 * @param value This is the value that is to be placed.
+	 * @return The index of the bucket holding the value will be returned.
+	 */
+	static uint32_t bucketIndexOf(uint32_t value);
+
+	/**
+	 * This method will determine the largest value which is placed in the given bucket.
+	 * @param index This is the index of the bucket.
+	 * @return The return will be the highest value that maps into the bucket.
+	 */
+	static uint32_t highestValueInBucket(uint32_t index);
+
+public:
+	/**
+	 * This is the default constructor.  It creates an empty histogram.
+	 */
+	LatencyHistogram();
+
+	/**
+	 * This is the destructor for the histogram.
+	 */
+	virtual ~LatencyHistogram();
+
+	/**
+	 * This method will record a single value into the histogram.  It is safe to call from one thread while others read.
+	 * @param value This is the value to record.  Negative values are recorded as 0.
+	 */
+	void recordValue(int64_t value);
+
+	/**
+	 * This method will obtain the value at the given percentile.  The value returned is the highest value which is equivalent
+	 * to the bucket holding the percentile, so it will never understate the latency.
+	 * @param percentile This is the percentile, between 0 and 100.
+	 * @return The value at the given percentile will be returned, or 0 if nothing has been recorded.
+	 */
+	uint32_t getValueAtPercentile(double percentile);
+
+	/**
+	 * This method will obtain the maximum value recorded.
+	 * @return The maximum value recorded since the last reset.
+	 */
+	uint32_t getMaxValue();
+
+	/**
+	 * This method will obtain the number of values recorded.
+	 * @return The total number of values recorded since the last reset.
+	 */
+	uint32_t getTotalCount();
+
+	/**
+	 * This method will clear the histogram back to its empty state.
+	 */
+	void reset();
+
+	/**
+	 * This method will print out the count, p50, p90, p99, p99.9 and max of the histogram on a single line, tab separated,
+	 * followed by a newline.
+	 */
+	void printPercentiles();
+};
+
+#endif /* LATENCYHISTOGRAM_H_ */
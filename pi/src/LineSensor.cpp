@@ -37,8 +37,10 @@ LineSensor::~LineSensor() {
 * units of time.
 */
 void LineSensor::taskMethod() {
-    if (ctrlQueue->hasItem()) {
-        int item = ctrlQueue->dequeue();
+    CommandEnvelope items[COMMAND_QUEUE_BATCH];
+    uint32_t count = ctrlQueue->tryDequeueUpTo(items, COMMAND_QUEUE_BATCH);
+    for (uint32_t index = 0; index < count; index++) {
+        int item = items[index].getCommandWord();
         if (item == START_LINE_SENSING) {
             currentlyActive = true;
         } else if (item == STOP_LINE_SENSING) {
@@ -57,24 +59,24 @@ void LineSensor::taskMethod() {
 
         if (lineFollowingEnabled) {
             if (leftValue == GPIO::GPIO_LOW && rightValue == GPIO::GPIO_LOW && centerValue == GPIO::GPIO_HIGH) {
-                mcq->enqueue(MOTORDIRECTIONBITMAP|FORWARD);
+                mcq->enqueue(MOTORDIRECTIONBITMAP|FORWARD, CommandQueue::NORMAL_LANE, SOURCE_LINE_SENSOR);
                 stopCount = 0;
             } else if (rightValue == GPIO::GPIO_LOW && leftValue == GPIO::GPIO_HIGH) {
-                mcq->enqueue(MOTORDIRECTIONBITMAP|LEFT);
+                mcq->enqueue(MOTORDIRECTIONBITMAP|LEFT, CommandQueue::NORMAL_LANE, SOURCE_LINE_SENSOR);
                 stopCount = 0;
             } else if (leftValue == GPIO::GPIO_LOW && rightValue == GPIO::GPIO_HIGH) {
-                mcq->enqueue(MOTORDIRECTIONBITMAP|RIGHT);
+                mcq->enqueue(MOTORDIRECTIONBITMAP|RIGHT, CommandQueue::NORMAL_LANE, SOURCE_LINE_SENSOR);
                 stopCount = 0;
             } else if (leftValue == GPIO::GPIO_HIGH && rightValue == GPIO::GPIO_HIGH && centerValue == GPIO::GPIO_HIGH){
             	if(stopCount == 2){
-                mcq->enqueue(MOTORDIRECTIONBITMAP|STOP);
+                mcq->enqueue(MOTORDIRECTIONBITMAP|STOP, CommandQueue::URGENT_LANE, SOURCE_LINE_SENSOR);
             	} else {
             		stopCount++;
             	}
             }
         } else {
         	if (leftValue == GPIO::GPIO_HIGH && rightValue == GPIO::GPIO_HIGH && centerValue == GPIO::GPIO_HIGH) {
-        		mcq->enqueue(MOTORDIRECTIONBITMAP|STOP);
+        		mcq->enqueue(MOTORDIRECTIONBITMAP|STOP, CommandQueue::URGENT_LANE, SOURCE_LINE_SENSOR);
         	}
         }
     }
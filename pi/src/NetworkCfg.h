@@ -33,5 +33,59 @@
  */
 #define NUMBER_OF_QUEUES (3)
 
+/**
+ * This is the most clients which can be connected to the robot at once.  A client which connects beyond this is turned away.
+ */
+#define NETWORK_MAX_CLIENTS (8)
+
+/**
+ * These are the roles a client has when it connects, until it sends a ROLE_MSG_TYPE message.  A client starts as both a controller
+ * and an observer, so a single operator console works as before.
+ */
+#define NETWORK_DEFAULT_CLIENT_ROLES (CLIENT_ROLE_CONTROLLER | CLIENT_ROLE_OBSERVER)
+
+/**
+ * If this is 1, commands are also accepted as UDP datagrams on UDP_CONTROL_PORT.  A lost datagram is simply skipped, so it does
+ * not hold up the commands behind it as a lost TCP segment does.  A datagram is only accepted from the IP address of a client
+ * which is connected over TCP as a controller.  UDP is not authenticated and a source address can be forged, so this must only
+ * be enabled on a trusted network.
+ */
+#define USE_UDP_CONTROL (1)
+
+/**
+ * This is the port which UDP commands are received on.
+ */
+#define UDP_CONTROL_PORT (9091)
+
+/**
+ * This is the most UDP senders which are kept track of at once.  Each sender is identified by its address and port.
+ */
+#define UDP_CONTROL_MAX_SENDERS (NETWORK_MAX_CLIENTS)
+
+/**
+ * This is the oldest a UDP command may be, in ms from its timestamp to when it is received, before it is dropped.  Unless the
+ * clock of the robot is synchronised with the station that sent it, the age is measured from the fastest UDP command seen from
+ * that sender instead.  If it is 0, commands are not dropped for their age.
+ */
+#define UDP_CONTROL_MAX_AGE_MS (100)
+
+/**
+ * This is how far back in ms the timestamp of a UDP command may be from the newest one taken from its sender and still be
+ * dropped as out of order.  A command from further back is taken to mean that the sender has restarted or its clock has been
+ * set back, so everything known about the sender is forgotten and the command is taken as its first.
+ */
+#define UDP_CONTROL_RESTART_MS (1000)
+
+/**
+ * If this is 1, the robot synchronises its clock with a controller by probing it periodically, so that the timestamps of the
+ * robot and the station can be compared.  The staleness check on UDP commands and the measurement of transit times depend on it.
+ */
+#define USE_CLOCK_SYNC (1)
+
+/**
+ * This is the period between the clock synchronisation probes, in ms.
+ */
+#define NETWORK_CLOCK_SYNC_PERIOD_MS (1000)
+
 
 #endif /* NETWORKCFG_H_ */
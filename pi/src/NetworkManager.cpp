@@ -21,6 +21,7 @@
  *
  * @section DESCRIPTION
  * This file defines the implementation for the Network Manager.  The Network Manager manages network connections and acts as a server, receiving messages sent over a socket.
+ * Every client is served from one thread, which waits on all of the sockets at once with epoll.
  */
 
 #include "NetworkManager.h"
@@ -28,6 +29,9 @@
 #include "CommandQueue.h"
 #include "NetworkMessage.h"
 #include "NetworkCommands.h"
+#include "Trace.h"
+#include "ClockSynchronizer.h"
+#include "time_util.h"
 #include <sys/time.h>
 #include <unistd.h>
 #include <stdlib.h>
@@ -38,22 +42,108 @@
 #include <netinet/in.h>
 #include <string.h>
 #include <string>
+#include <iomanip>
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <stdint.h>
 
 using namespace std;
 
+/**
+ * This is the epoll tag of the stop event.
+ */
+#define STOP_EVENT_TAG (0xFFFFFFFF)
+
+/**
+ * This is the epoll tag of the listening socket.  Every other tag is the index of a client.
+ */
+#define LISTEN_EVENT_TAG (0xFFFFFFFE)
+
+/**
+ * This is the epoll tag of the UDP socket.
+ */
+#define UDP_EVENT_TAG (0xFFFFFFFD)
+
+/**
+ * This is the epoll tag of the clock synchronisation timer.
+ */
+#define CLOCK_SYNC_EVENT_TAG (0xFFFFFFFC)
+
+/**
+ * This method will verify the checksum of a message.
+ * @param message This is the message, in host byte order.
+ * @return true if the checksum is correct.  False otherwise.
+ */
+static bool checksumValid(const networkMessageStruct &message) {
+	int calculatedChecksum = message.messageID
+			^ message.timestampHigh
+			^ message.timestampLow
+			^ message.messageType ^ message.message
+			^ message.messageDestination;
+	return calculatedChecksum == message.xorChecksum;
+}
+
+/**
+ * This method will obtain the timestamp of a message.
+ * @param message This is the message, in host byte order.
+ * @return The timestamp will be returned, in ms since the start of the Epoch on the clock of the sender.
+ */
+static int64_t senderTimestampOf(const networkMessageStruct &message) {
+	return ((int64_t) message.timestampHigh << 32) | (uint32_t) message.timestampLow;
+}
+
 /**
  * This is the constructor for the Network Manager.  It will instantiate a new instance of the class.
  * @param port This is the port that the network manager is to listen on for incoming connections.
  * @param queue This is the queue that is to be used for enqueueing received requests.
  * @param threadName This is the name given to the executing thread.  It is a simple, string that is human readable.
+ * @param udpPort This is the port that UDP commands are received on, or 0 if they are not to be accepted.
  */
 NetworkManager::NetworkManager(unsigned short port, CommandQueue **queue,
-		std::string threadName) :
-		RunnableClass(threadName) {
+		std::string threadName, unsigned short udpPort) :
+		RunnableClass(threadName), clientMutex(threadName + " clients") {
 	portNumber = port;
-	myThread = NULL;
+	udpPortNumber = udpPort;
 	keepGoing = true;
 	referencequeue = queue;
+	for (int index = 0; index < NETWORK_MAX_CLIENTS; index++) {
+		clients[index].socket = -1;
+		clients[index].roles = 0;
+	}
+	receiveCallCount = 0;
+	receivedMessageCount = 0;
+	for (int index = 0; index < UDP_CONTROL_MAX_SENDERS; index++) {
+		memset(&udpSenders[index].address, 0, sizeof(udpSenders[index].address));
+		udpSenders[index].lastHeard = 0;
+		resetUdpSender(udpSenders[index]);
+	}
+	udpReceivedCount = 0;
+	udpRefusedCount = 0;
+	udpOutOfOrderCount = 0;
+	udpStaleCount = 0;
+	udpRestartCount = 0;
+	smallestClockDifference = INT64_MAX;
+	clockSyncFD = -1;
+	probeID = 0;
+	probeSentAt = 0;
+	probeClient = -1;
+	synchronizedClient = -1;
+
+	/**
+	 * Create the epoll instance and the stop event here, so that stop works even if the thread never got as far as listening.
+	 */
+	epollFD = epoll_create1(EPOLL_CLOEXEC);
+	stopFD = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	struct epoll_event event;
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.u32 = STOP_EVENT_TAG;
+	if (epoll_ctl(epollFD, EPOLL_CTL_ADD, stopFD, &event) != 0) {
+		perror("epoll_ctl");
+	}
 }
 
 /**
@@ -61,8 +151,24 @@ NetworkManager::NetworkManager(unsigned short port, CommandQueue **queue,
  */
 NetworkManager::~NetworkManager() {
 	/**
-	 * Right now, this destructor doesn't have anything to do, as there are no dynamically allocated objects that need to be destroyed.
+	 * Close any clients which are still connected, along with the descriptors the class created.
 	 */
+	for (uint32_t index = 0; index < NETWORK_MAX_CLIENTS; index++) {
+		if (clients[index].socket >= 0) {
+			closeClient(index);
+		}
+	}
+	if (server_fd > 0) {
+		close(server_fd);
+	}
+	if (udp_fd >= 0) {
+		close(udp_fd);
+	}
+	if (clockSyncFD >= 0) {
+		close(clockSyncFD);
+	}
+	close(stopFD);
+	close(epollFD);
 }
 
 /**
@@ -75,28 +181,25 @@ void NetworkManager::stop() {
 	RunnableClass::stop();
 
 	/**
-	 * 2.0 Call shutdown on the socket to shut down the full-duplex connection.
+	 * 2.0 Signal the stop event, which wakes the thread from epoll.
 	 */
-	shutdown(server_fd, SHUT_RDWR);
+	uint64_t one = 1;
+	ssize_t written = write(stopFD, &one, sizeof(one));
+	(void) written;
 }
 
 /**
  * This is the run method for the class.  It contains the code that is to run periodically on the given thread.
  */
 void NetworkManager::run() {
-	int valread;
 	struct sockaddr_in serverAddress;
-	struct sockaddr_in clientAddress;
 	int opt = 1;
-	int addrlen = sizeof(clientAddress);
-	int socketOpen;
-	networkMessageStruct receivedMessage;
 
 	/**
-	 * 1.0 Create a socket file descriptor.  The socket is a tcp socket.
+	 * 1.0 Create a socket file descriptor.  The socket is a tcp socket, and it does not block, so that it can be waited on with epoll.
 	 * If there is an error, indicate that the socket failed and return from the message.
 	 */
-	if ((server_fd = socket(AF_INET, SOCK_STREAM, 0)) == 0) {
+	if ((server_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0) {
 		perror("socket failed");
 		return;
 	}
@@ -126,104 +229,634 @@ void NetworkManager::run() {
 	serverAddress.sin_port = htons(portNumber);
 
 	/**
-	 * 6.0 Now bind the listening socket to the correct port.  If there is a failure, print out an error and exit the program.
+	 * 6.0 Now bind the listening socket to the correct port and listen on it.  If there is a failure, print out an error and exit the program.
 	 */
 	if (bind(server_fd, (struct sockaddr *) &serverAddress,
 			sizeof(serverAddress)) < 0) {
 		perror("bind failed");
 		exit(EXIT_FAILURE);
 	}
+	if (listen(server_fd, NETWORK_MAX_CLIENTS) < 0) {
+		perror("listen");
+		exit(EXIT_FAILURE);
+	}
+
+	/**
+	 * 7.0 Wait on the listening socket along with the clients.
+	 */
+	struct epoll_event event;
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.u32 = LISTEN_EVENT_TAG;
+	if (epoll_ctl(epollFD, EPOLL_CTL_ADD, server_fd, &event) != 0) {
+		perror("epoll_ctl");
+		return;
+	}
+
+	/**
+	 * 7.1 If UDP commands are accepted, bind their socket to the same addresses and wait on it as well.  The robot still runs
+	 * over TCP if it fails.
+	 */
+	if (udpPortNumber != 0) {
+		struct sockaddr_in udpAddress = serverAddress;
+		udpAddress.sin_port = htons(udpPortNumber);
+		udp_fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+		event.data.u32 = UDP_EVENT_TAG;
+		if ((udp_fd < 0) || (bind(udp_fd, (struct sockaddr *) &udpAddress, sizeof(udpAddress)) < 0)
+				|| (epoll_ctl(epollFD, EPOLL_CTL_ADD, udp_fd, &event) != 0)) {
+			perror("UDP control socket");
+			if (udp_fd >= 0) {
+				close(udp_fd);
+				udp_fd = -1;
+			}
+		}
+	}
 
 	/**
-	 * 7.0 Loop so long as the thread is to continue running.
+	 * 7.2 If the clock is to be synchronised, start the timer which sends the probes.
 	 */
+	if (USE_CLOCK_SYNC) {
+		struct itimerspec timerSetting;
+		timerSetting.it_interval.tv_sec = NETWORK_CLOCK_SYNC_PERIOD_MS / 1000;
+		timerSetting.it_interval.tv_nsec = (NETWORK_CLOCK_SYNC_PERIOD_MS % 1000) * 1000000;
+		timerSetting.it_value = timerSetting.it_interval;
+		clockSyncFD = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+		event.data.u32 = CLOCK_SYNC_EVENT_TAG;
+		if ((clockSyncFD < 0) || (timerfd_settime(clockSyncFD, 0, &timerSetting, NULL) != 0)
+				|| (epoll_ctl(epollFD, EPOLL_CTL_ADD, clockSyncFD, &event) != 0)) {
+			perror("clock synchronisation timer");
+			if (clockSyncFD >= 0) {
+				close(clockSyncFD);
+				clockSyncFD = -1;
+			}
+		}
+	}
+
+	/**
+	 * 8.0 Loop so long as the thread is to continue running.
+	 */
+	struct epoll_event events[NETWORK_MAX_CLIENTS + 4];
 	while (keepGoing) {
 		/**
-		 * 7.1 Listen for and accept the given connection.  If there is an error, print out an error and exit.
+		 * 8.1 Block until a client connects, a client sends something, a probe is due, or the thread is stopped.
 		 */
-		if (listen(server_fd, 3) < 0) {
-			perror("listen");
-			exit(EXIT_FAILURE);
+		int readyCount = epoll_wait(epollFD, events, NETWORK_MAX_CLIENTS + 4, -1);
+		if (readyCount < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			perror("epoll_wait");
+			return;
 		}
 
 		/**
-		 * 7.2 Accept the connection from the client, setting the connected socket to the value returned from the accept call.
-		 * If there is an error and the thread is to keep going, return after printing out an error if the thread is to continue running.
+		 * 8.2 Handle each socket which is ready.
 		 */
-		if (((connectedSocket = accept(server_fd, (struct sockaddr*) &clientAddress, (socklen_t*) &addrlen)) < 0)
-				&& (keepGoing)) {
-			perror("connect");
+		for (int index = 0; index < readyCount; index++) {
+			if (events[index].data.u32 == STOP_EVENT_TAG) {
+				// keepGoing is already false, so the loop ends once the ready sockets are handled.
+			} else if (events[index].data.u32 == LISTEN_EVENT_TAG) {
+				acceptClients();
+			} else if (events[index].data.u32 == UDP_EVENT_TAG) {
+				receiveDatagrams();
+			} else if (events[index].data.u32 == CLOCK_SYNC_EVENT_TAG) {
+				uint64_t expirations;
+				if (read(clockSyncFD, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+					sendClockProbe();
+				}
+			} else {
+				receiveFromClient(events[index].data.u32);
+			}
+		}
+	}
+}
+
+/**
+ * This method will accept every connection which is waiting on the listening socket.
+ */
+void NetworkManager::acceptClients() {
+	struct sockaddr_in clientAddress;
+	socklen_t addrlen = sizeof(clientAddress);
+	int clientSocket;
+
+	while ((clientSocket = accept4(server_fd, (struct sockaddr*) &clientAddress, &addrlen, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+		addrlen = sizeof(clientAddress);
+
+		/**
+		 * 1.0 Find a free entry for the client.  If there is none, turn the client away.
+		 */
+		std::lock_guard<PIMutex> guard(clientMutex);
+		uint32_t index = 0;
+		while (index < NETWORK_MAX_CLIENTS && clients[index].socket >= 0) {
+			index++;
+		}
+		if (index == NETWORK_MAX_CLIENTS) {
+			printf("Refusing a client, as %d clients are already connected.\n", NETWORK_MAX_CLIENTS);
+			close(clientSocket);
+			continue;
+		}
+
+		/**
+		 * 2.0 Wait on the client along with the others.
+		 */
+		struct epoll_event event;
+		memset(&event, 0, sizeof(event));
+		event.events = EPOLLIN | EPOLLRDHUP;
+		event.data.u32 = index;
+		if (epoll_ctl(epollFD, EPOLL_CTL_ADD, clientSocket, &event) != 0) {
+			perror("epoll_ctl");
+			close(clientSocket);
+			continue;
+		}
+		clients[index].socket = clientSocket;
+		clients[index].roles = NETWORK_DEFAULT_CLIENT_ROLES;
+		clients[index].address = clientAddress.sin_addr;
+		clients[index].decoder.reset();
+	}
+	if (errno != EAGAIN && errno != EWOULDBLOCK && keepGoing) {
+		perror("accept");
+	}
+}
+
+/**
+ * This method will read whatever a client has sent, and process each message which is complete.
+ * @param index This is the index of the client which is readable.
+ */
+void NetworkManager::receiveFromClient(uint32_t index) {
+	ClientConnection &client = clients[index];
+	networkMessageStruct receivedMessages[NETWORK_RECEIVE_BATCH];
+	if (client.socket < 0) {
+		return;
+	}
+
+	while (true) {
+		/**
+		 * 1.0 Read everything the client has sent, up to the space in its buffer.  The read never blocks.
+		 */
+		uint32_t freeSpace = client.decoder.getFreeSpace();
+		ssize_t valread = recv(client.socket, client.decoder.getWritePosition(), freeSpace, 0);
+		receiveCallCount++;
+
+		/**
+		 * 2.0 If 0 bytes were received, the client has closed the socket.  If the read failed for any reason other than there
+		 * being nothing more to read, the connection is broken.  Either way, disconnect the client.
+		 */
+		if (valread == 0 || (valread < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+			closeClient(index);
 			return;
 		}
-		socketOpen = sizeof(networkMessageStruct);
+		if (valread < 0) {
+			return;
+		}
+
+		/**
+		 * 3.0 Act on every message which is now complete.
+		 */
+		uint32_t count = client.decoder.decode(valread, receivedMessages);
+		receivedMessageCount += count;
+		for (uint32_t message = 0; message < count; message++) {
+			processMessage(index, receivedMessages[message]);
+		}
+
+		/**
+		 * 4.0 If the read did not fill the buffer, the socket is empty, and epoll reports it again when more arrives.  Otherwise
+		 * there may be more waiting, so read again.
+		 */
+		if ((uint32_t) valread < freeSpace) {
+			return;
+		}
+	}
+}
+
+/**
+ * This method will act on one complete message from a client.
+ * @param index This is the index of the client that sent the message.
+ * @param receivedMessage This is the message, in host byte order.
+ */
+void NetworkManager::processMessage(uint32_t index, const networkMessageStruct &receivedMessage) {
+	ClientConnection &client = clients[index];
+	TRACE_EVENT(TRACE_RECEIVE, "network receive", receivedMessage.message);
+
+	/**
+	 * 1.0 Verify that the XOR checksum of the data received, not including the checksum field, matches the checksum that was
+	 * transmitted.
+	 **/
+	if (!checksumValid(receivedMessage)) {
+		return;
+	}
+
+	if (receivedMessage.messageType == ROLE_MSG_TYPE) {
+		/**
+		 * 1.1 The client is setting its roles.  The list of clients is read by the transmission thread, so lock it.
+		 */
+		std::lock_guard<PIMutex> guard(clientMutex);
+		client.roles = (uint32_t) receivedMessage.message & (CLIENT_ROLE_CONTROLLER | CLIENT_ROLE_OBSERVER);
+	} else if (receivedMessage.messageType == CLOCK_SYNC_MSG_TYPE) {
+		/**
+		 * 1.2 The client is replying to a clock synchronisation probe.
+		 */
+		processClockReply(index, receivedMessage);
+	} else if ((client.roles & CLIENT_ROLE_CONTROLLER) != 0) {
+		/**
+		 * 1.3 The message is from a controller.  Enqueue it if it is a command.
+		 */
+		enqueueCommand(receivedMessage);
+	}
+}
+
+/**
+ * This method will enqueue a command message on the queue it is addressed to.
+ * @param receivedMessage This is the message, in host byte order.  Its checksum must already have been verified.
+ */
+void NetworkManager::enqueueCommand(const networkMessageStruct &receivedMessage) {
+	/**
+	 * Enqueue it to the right queue if the destination queue is valid and it is a COMMAND_MSG_TYPE.
+	 */
+	if ((receivedMessage.messageType == COMMAND_MSG_TYPE) &&
+		(receivedMessage.messageDestination > 0) &&
+		(receivedMessage.messageDestination <= NUMBER_OF_QUEUES)) {
+		CommandEnvelope command = CommandEnvelope::fromCommandWord(receivedMessage.message, SOURCE_NETWORK,
+				receivedMessage.messageID, senderTimestampOf(receivedMessage));
+		(*(referencequeue[receivedMessage.messageDestination - 1])).enqueue(command);
 
 		/**
-		 * 7.3 So long as the socket remains open and the thread continues running.
+		 * Record how long the command took to arrive.  Once the clock is synchronised with the station, the synchronized time
+		 * is directly comparable with the timestamp.  Until then, the fastest command seen so far is taken to have arrived at
+		 * once, which removes the offset between the clocks of the sender and the robot.
 		 */
-		while ((socketOpen > 0) && (keepGoing)) {
-			valread = 0;
-			char* buf = (char*) &receivedMessage;
+		int64_t difference = synchronized_timestamp() - command.senderTimestamp;
+		if (ClockSynchronizer::isSynchronized()) {
+			transitHistogram.recordValue(difference * 1000);
+		} else {
+			if (difference < smallestClockDifference) {
+				smallestClockDifference = difference;
+			}
+			transitHistogram.recordValue((difference - smallestClockDifference) * 1000);
+		}
+	}
+}
+
+/**
+ * This method will send a clock synchronisation probe to the first connected controller.
+ */
+void NetworkManager::sendClockProbe() {
+	std::lock_guard<PIMutex> guard(clientMutex);
+
+	/**
+	 * 1.0 Probe the controller the clock is already synchronised with, if it is still connected, so that the estimate keeps
+	 * following the same clock.  Otherwise probe the first controller.
+	 */
+	int32_t target = -1;
+	if ((synchronizedClient >= 0) && (clients[synchronizedClient].socket >= 0)
+			&& ((clients[synchronizedClient].roles & CLIENT_ROLE_CONTROLLER) != 0)) {
+		target = synchronizedClient;
+	}
+	for (int32_t index = 0; (target < 0) && (index < NETWORK_MAX_CLIENTS); index++) {
+		if ((clients[index].socket >= 0) && ((clients[index].roles & CLIENT_ROLE_CONTROLLER) != 0)) {
+			target = index;
+		}
+	}
+	if (target < 0) {
+		probeClient = -1;
+		return;
+	}
+
+	/**
+	 * 2.0 Build the probe.  A probe which is still outstanding is abandoned, since its reply would now be too late to be accurate.
+	 */
+	probeID++;
+	int64_t now = synchronized_timestamp();
+	networkMessageStruct probe = networkMessageStruct();
+	probe.messageID = probeID;
+	probe.timestampHigh = (int32_t) (now >> 32);
+	probe.timestampLow = (int32_t) now;
+	probe.messageType = CLOCK_SYNC_MSG_TYPE;
+	probe.xorChecksum = probe.messageID ^ probe.timestampHigh ^ probe.timestampLow ^ probe.messageType ^ probe.message
+			^ probe.messageDestination;
+	NetworkMessageDecoder::toNetworkOrder(&probe, 1);
+
+	/**
+	 * 3.0 Send it, noting the time as late as possible.  If the socket can not take it right now, try again on the next period.
+	 * If only part of it was sent, or the connection failed, shut the socket down as sendToClients does, since the client is out
+	 * of step.
+	 */
+	probeSentAt = monotonic_timestamp_us();
+	probeClient = -1;
+	ssize_t sent = send(clients[target].socket, &probe, sizeof(probe), MSG_DONTWAIT | MSG_NOSIGNAL);
+	if (sent == (ssize_t) sizeof(probe)) {
+		probeClient = target;
+	} else if (sent >= 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+		shutdown(clients[target].socket, SHUT_RDWR);
+	}
+}
+
+/**
+ * This method will handle the reply to a clock synchronisation probe.
+ * @param index This is the index of the client that sent the reply.
+ * @param receivedMessage This is the reply, in host byte order.  Its checksum must already have been verified.
+ */
+void NetworkManager::processClockReply(uint32_t index, const networkMessageStruct &receivedMessage) {
+	int64_t replyReceivedAt = monotonic_timestamp_us();
+
+	/**
+	 * 1.0 Ignore anything which is not the reply to the outstanding probe.
+	 */
+	if (((int32_t) index != probeClient) || (receivedMessage.messageID != probeID)) {
+		return;
+	}
+	probeClient = -1;
+
+	/**
+	 * 2.0 If the reply is from a different station than the clock was synchronised with, its clock is a different one, so start
+	 * again.
+	 */
+	if ((int32_t) index != synchronizedClient) {
+		ClockSynchronizer::reset();
+		synchronizedClient = index;
+		resetUdpSenders();
+	}
+
+	/**
+	 * 3.0 Record the exchange.  If it is the first since the synchronizer was reset, the synchronized time moves from the clock
+	 * of the robot to the clock of the station, so the clock differences measured for the UDP senders no longer hold.
+	 */
+	bool wasSynchronized = ClockSynchronizer::isSynchronized();
+	ClockSynchronizer::recordSample(probeSentAt, senderTimestampOf(receivedMessage), replyReceivedAt);
+	if (!wasSynchronized && ClockSynchronizer::isSynchronized()) {
+		resetUdpSenders();
+	}
+}
+
+/**
+ * This method will read every datagram waiting on the UDP socket, and enqueue the commands in them which are current.
+ */
+void NetworkManager::receiveDatagrams() {
+	networkMessageStruct datagrams[NETWORK_RECEIVE_BATCH];
+	struct sockaddr_in sources[NETWORK_RECEIVE_BATCH];
+	struct mmsghdr headers[NETWORK_RECEIVE_BATCH];
+	struct iovec vectors[NETWORK_RECEIVE_BATCH];
+	int count;
 
+	/**
+	 * 1.0 Receive the datagrams in batches, so that a burst costs one call rather than one for each datagram.
+	 */
+	memset(headers, 0, sizeof(headers));
+	for (int index = 0; index < NETWORK_RECEIVE_BATCH; index++) {
+		vectors[index].iov_base = &datagrams[index];
+		vectors[index].iov_len = sizeof(networkMessageStruct);
+		headers[index].msg_hdr.msg_iov = &vectors[index];
+		headers[index].msg_hdr.msg_iovlen = 1;
+		headers[index].msg_hdr.msg_name = &sources[index];
+	}
+	for (;;) {
+		for (int index = 0; index < NETWORK_RECEIVE_BATCH; index++) {
+			headers[index].msg_hdr.msg_namelen = sizeof(sources[index]);
+		}
+		count = recvmmsg(udp_fd, headers, NETWORK_RECEIVE_BATCH, MSG_DONTWAIT, NULL);
+		if (count <= 0) {
+			break;
+		}
+		receiveCallCount++;
+		receivedMessageCount += count;
+		NetworkMessageDecoder::toHostOrder(datagrams, count);
+		int64_t receiveTime = synchronized_timestamp();
+		int64_t now = monotonic_timestamp_us();
+
+		for (int index = 0; index < count; index++) {
 			/**
-			 * 7.3.1 Receive the message.  Make sure to wait on all of the message being received.
+			 * 2.0 A datagram holds exactly one message.  Ignore anything else, or anything which is damaged.
 			 */
-			valread = recv(connectedSocket, buf, sizeof(networkMessageStruct), MSG_WAITALL);
+			const networkMessageStruct &receivedMessage = datagrams[index];
+			const struct sockaddr_in &source = sources[index];
+			if ((headers[index].msg_len != sizeof(networkMessageStruct))
+					|| (headers[index].msg_hdr.msg_namelen != sizeof(struct sockaddr_in))
+					|| (source.sin_family != AF_INET) || !checksumValid(receivedMessage)
+					|| (receivedMessage.messageType != COMMAND_MSG_TYPE) || (receivedMessage.messageDestination <= 0)
+					|| (receivedMessage.messageDestination > NUMBER_OF_QUEUES)) {
+				continue;
+			}
+			udpReceivedCount++;
+			TRACE_EVENT(TRACE_RECEIVE, "udp receive", receivedMessage.message);
 
 			/**
-			 * 7.3.2 Check to see if 0 bytes were received.
+			 * 2.1 Only a controller may send commands, so refuse a datagram unless a controller is connected from its address.
 			 */
-			if (valread == 0) {
-				/**
-				 * 7.3.2.1 If we receive 0 bytes, the socket has been closed so abort.
-				 */
-				socketOpen = 0;
-				close(connectedSocket);
-				connectedSocket = 0;
-			} else {
-				/**
-				 * 7.3.3.1 Otherwise, Convert the message to the appropriate endian format.
-				 * Do this by converting each individual structure element accordingly.
-				 */
-				receivedMessage.messageID = ntohl(receivedMessage.messageID);
-				receivedMessage.timestampHigh = ntohl(receivedMessage.timestampHigh);
-				receivedMessage.timestampLow = ntohl(receivedMessage.timestampLow);
-				receivedMessage.messageType = ntohl(receivedMessage.messageType);
-				receivedMessage.message = ntohl(receivedMessage.message);
-				receivedMessage.messageDestination = ntohl(receivedMessage.messageDestination);
-				receivedMessage.xorChecksum = ntohl(receivedMessage.xorChecksum);
-
-				/**
-				 * 7.3.3.2 Calculate the XOR checksum of the data received, not including the checksum field.
-				 */
-				int calculatedChecksum = receivedMessage.messageID
-						^ receivedMessage.timestampHigh
-						^ receivedMessage.timestampLow
-						^ receivedMessage.messageType ^ receivedMessage.message
-						^ receivedMessage.messageDestination;
-
-				/**
-				 * 7.3.3.3 Verify that the received checksum matchess the checksum that was transmitted.
-				 **/
-				if (calculatedChecksum == receivedMessage.xorChecksum) {
-					/**
-					 * 7.3.3.3.1 The message is valid.  Enqueue it to the right queue if the destination queue is valid and it is a COMMAND_MSG_TYPE.
-					 */
-					if ((receivedMessage.messageType == COMMAND_MSG_TYPE) &&
-						(receivedMessage.messageDestination > 0) &&
-						(receivedMessage.messageDestination <= NUMBER_OF_QUEUES)) {
-						(*(referencequeue[receivedMessage.messageDestination - 1])).enqueue(receivedMessage.message);
-					}
-				}
+			if (!isControllerAddress(source.sin_addr)) {
+				udpRefusedCount++;
+				continue;
 			}
+
+			/**
+			 * 3.0 Drop the command if a newer one has already been taken from the same sender for its queue.  Commands are ordered
+			 * by their timestamp, then by their message ID, so a sender which restarts its message IDs is still accepted.  A
+			 * command from much further back means the sender has restarted, so start again with it.
+			 */
+			UdpSender &sender = findUdpSender(source, now);
+			int queueIndex = receivedMessage.messageDestination - 1;
+			int64_t timestamp = senderTimestampOf(receivedMessage);
+			int64_t newest = sender.newestTimestamp[queueIndex];
+			if ((newest != INT64_MIN) && (timestamp < newest - UDP_CONTROL_RESTART_MS)) {
+				udpRestartCount++;
+				resetUdpSender(sender);
+			} else if ((timestamp < newest) || ((timestamp == newest)
+					&& ((int32_t) (receivedMessage.messageID - sender.newestMessageID[queueIndex]) <= 0))) {
+				udpOutOfOrderCount++;
+				continue;
+			}
+
+			/**
+			 * 4.0 Drop the command if it is too old to act on.  It still counts as the newest, so that an older one behind it is
+			 * dropped as well.  If the clock is synchronised with the station the command came from, the age is measured directly.
+			 * Otherwise the clocks can not be compared, so the fastest command seen from the sender is taken to have arrived at
+			 * once, and the age is how much longer this one took.
+			 */
+			sender.newestTimestamp[queueIndex] = timestamp;
+			sender.newestMessageID[queueIndex] = receivedMessage.messageID;
+			sender.lastHeard = now;
+			int64_t age = receiveTime - timestamp;
+			if (age < sender.smallestClockDifference) {
+				sender.smallestClockDifference = age;
+			}
+			if (!ClockSynchronizer::isSynchronized() || (synchronizedClient < 0)
+					|| (clients[synchronizedClient].address.s_addr != source.sin_addr.s_addr)) {
+				age -= sender.smallestClockDifference;
+			}
+			if ((UDP_CONTROL_MAX_AGE_MS > 0) && (age > UDP_CONTROL_MAX_AGE_MS)) {
+				udpStaleCount++;
+				continue;
+			}
+			enqueueCommand(receivedMessage);
+		}
+		if (count < NETWORK_RECEIVE_BATCH) {
+			break;
+		}
+	}
+}
+
+/**
+ * This method will indicate whether or not a connected client with the controller role has the given address.
+ * @param address This is the IP address, in network byte order.
+ * @return true if a controller is connected from the address.  False otherwise.
+ */
+bool NetworkManager::isControllerAddress(const struct in_addr &address) {
+	for (int index = 0; index < NETWORK_MAX_CLIENTS; index++) {
+		if ((clients[index].socket >= 0) && ((clients[index].roles & CLIENT_ROLE_CONTROLLER) != 0)
+				&& (clients[index].address.s_addr == address.s_addr)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * This method will find the entry of a UDP sender, taking the entry of the sender which has been silent longest if it is new.
+ * @param address This is the address and port the sender sends from.
+ * @param now This is the current time on the monotonic clock, in microseconds.
+ * @return The entry of the sender will be returned.
+ */
+NetworkManager::UdpSender &NetworkManager::findUdpSender(const struct sockaddr_in &address, int64_t now) {
+	int oldest = 0;
+	for (int index = 0; index < UDP_CONTROL_MAX_SENDERS; index++) {
+		if ((udpSenders[index].address.sin_port == address.sin_port)
+				&& (udpSenders[index].address.sin_addr.s_addr == address.sin_addr.s_addr)) {
+			return udpSenders[index];
+		}
+		if (udpSenders[index].lastHeard < udpSenders[oldest].lastHeard) {
+			oldest = index;
 		}
 	}
+
+	/**
+	 * The sender is new.  Free entries have never been heard from, so they are taken before any sender is forgotten.
+	 */
+	UdpSender &sender = udpSenders[oldest];
+	sender.address = address;
+	sender.lastHeard = now;
+	resetUdpSender(sender);
+	return sender;
 }
 
 /**
- * This method will return the socket ID for the given class.
- * @return The socket ID will be returned.
+ * This method will forget the order and clock of a UDP sender, so that its next command is taken as its first.
+ * @param sender This is the entry of the sender.
  */
-int NetworkManager::getSocketID() {
-	return connectedSocket;
+void NetworkManager::resetUdpSender(UdpSender &sender) {
+	for (int index = 0; index < NUMBER_OF_QUEUES; index++) {
+		sender.newestTimestamp[index] = INT64_MIN;
+		sender.newestMessageID[index] = 0;
+	}
+	sender.smallestClockDifference = INT64_MAX;
 }
 
+/**
+ * This method will forget the order and clock of every UDP sender.  It is called whenever the synchronized time changes its time
+ * base, since the clock differences already measured were measured against the old one.
+ */
+void NetworkManager::resetUdpSenders() {
+	for (int index = 0; index < UDP_CONTROL_MAX_SENDERS; index++) {
+		resetUdpSender(udpSenders[index]);
+	}
+}
+
+/**
+ * This method will disconnect a client and free its entry.  It is only called on the thread of the network manager.
+ * @param index This is the index of the client.
+ */
+void NetworkManager::closeClient(uint32_t index) {
+	std::lock_guard<PIMutex> guard(clientMutex);
+	if ((int32_t) index == probeClient) {
+		probeClient = -1;
+	}
+	if ((int32_t) index == synchronizedClient) {
+		// The next client in this entry may be a different station, with a different clock, so start again.
+		synchronizedClient = -1;
+		ClockSynchronizer::reset();
+		resetUdpSenders();
+	}
+	epoll_ctl(epollFD, EPOLL_CTL_DEL, clients[index].socket, NULL);
+	close(clients[index].socket);
+	clients[index].socket = -1;
+	clients[index].roles = 0;
+	clients[index].decoder.reset();
+}
+
+/**
+ * This method will send a message to every client with the given role.  It never blocks.  A client which can not take the
+ * message right now misses it, and a client whose connection has failed is disconnected.
+ * @param message This is the message that is to be sent.  It must already be in network byte order.
+ * @param role This is the role a client must have to be sent the message.
+ * @return The number of clients the message was sent to will be returned.
+ */
+uint32_t NetworkManager::sendToClients(const networkMessageStruct &message, uint32_t role) {
+	uint32_t sentCount = 0;
+	std::lock_guard<PIMutex> guard(clientMutex);
+	for (uint32_t index = 0; index < NETWORK_MAX_CLIENTS; index++) {
+		if (clients[index].socket < 0 || (clients[index].roles & role) == 0) {
+			continue;
+		}
+		ssize_t sent = send(clients[index].socket, &message, sizeof(networkMessageStruct), MSG_DONTWAIT | MSG_NOSIGNAL);
+		if (sent == (ssize_t) sizeof(networkMessageStruct)) {
+			sentCount++;
+		} else if (sent >= 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+			/**
+			 * Part of the message was sent, which would leave the client out of step, or the connection failed.  Shut the socket
+			 * down rather than close it here, so that the thread of the network manager sees it end and disconnects the client.
+			 */
+			shutdown(clients[index].socket, SHUT_RDWR);
+		}
+	}
+	return sentCount;
+}
+
+/**
+ * This method will return the number of connected clients.
+ * @return The number of connected clients will be returned.
+ */
+uint32_t NetworkManager::getClientCount() {
+	uint32_t count = 0;
+	std::lock_guard<PIMutex> guard(clientMutex);
+	for (uint32_t index = 0; index < NETWORK_MAX_CLIENTS; index++) {
+		if (clients[index].socket >= 0) {
+			count++;
+		}
+	}
+	return count;
+}
+
+/**
+ * This method will print out information about the thread, along with how many messages each read from a socket delivered.
+ */
+void NetworkManager::printInformation() {
+	uint32_t calls = receiveCallCount;
+	uint32_t messages = receivedMessageCount;
+	std::cout << myOSThreadID << "\t" << std::setw(18) << myName << "\t "
+			<< std::setw(5) << getPriority() << "\t clients " << getClientCount()
+			<< "\t messages " << messages << "\t receive calls " << calls
+			<< "\t messages per call " << ((calls == 0) ? 0.0 : (double) messages / calls)
+			<< "\t UDP commands " << udpReceivedCount << "\t refused " << udpRefusedCount
+			<< "\t out of order " << udpOutOfOrderCount << "\t stale " << udpStaleCount
+			<< "\t sender restarts " << udpRestartCount << "\n";
+}
+
+/**
+ * This method will reset the counts of reads and messages.
+ */
+void NetworkManager::resetThreadDiagnostics() {
+	receiveCallCount = 0;
+	receivedMessageCount = 0;
+	udpReceivedCount = 0;
+	udpRefusedCount = 0;
+	udpOutOfOrderCount = 0;
+	udpStaleCount = 0;
+	udpRestartCount = 0;
+	smallestClockDifference = INT64_MAX;
+	transitHistogram.reset();
+}
+
+/**
+ * This method will print the distribution of the time commands took to arrive over the network.
+ */
+void NetworkManager::printLatencyInformation() {
+	std::cout << myOSThreadID << "\t" << std::setw(18) << myName << "\t Transit    \t";
+	transitHistogram.printPercentiles();
+}
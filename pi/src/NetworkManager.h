@@ -21,6 +21,19 @@
  *
  * @section DESCRIPTION
  * This file defines the interface for the Network Manager.  The Network Manager manages network connections and acts as a server, receiving messages sent over a socket to the class.
+ * It serves every connected client from one thread.  The listening socket and the client sockets are non-blocking and are waited on
+ * together with epoll, so a slow or idle client never holds up the others.  Each wakeup reads whatever a client has sent in one
+ * call, and decodes every complete message in it.
+ *
+ * Commands can also be sent as UDP datagrams, one message to each.  Since a datagram may be lost or arrive out of order, a
+ * UDP command is dropped if it is older than the newest command already taken from the same sender for its queue, or if it is
+ * too old to be worth acting on.  The newest command always wins.  UDP is not authenticated: a datagram is only accepted from the
+ * address of a connected controller, but that address is not proven, so UDP control must only be enabled on a trusted network.
+ * Each client has a role: a controller may send commands to the robot, and an observer receives the telemetry which the robot
+ * sends.
+ *
+ * The network manager also probes a controller periodically to synchronise the clock of the robot with the clock of the station,
+ * and hands each exchange to the clock synchronizer.
  */
 
 #ifndef NETWORKMANAGER_H_
@@ -31,11 +44,73 @@
 #include "RunnableClass.h"
 #include "NetworkCfg.h"
 #include "NetworkMessage.h"
+#include "NetworkMessageDecoder.h"
+#include "PIMutex.h"
+#include "LatencyHistogram.h"
+#include <atomic>
 #include <string>
+#include <stdint.h>
+#include <netinet/in.h>
 
 
 class NetworkManager: public RunnableClass {
 private:
+	/**
+	 * This structure holds the state of one connected client.
+	 */
+	struct ClientConnection {
+		/**
+		 * This is the socket of the client, or -1 if the entry is free.
+		 */
+		int socket;
+
+		/**
+		 * These are the role flags of the client, CLIENT_ROLE_CONTROLLER and CLIENT_ROLE_OBSERVER.
+		 */
+		uint32_t roles;
+
+		/**
+		 * This is the IP address the client connected from.  UDP commands are only accepted from the address of a controller.
+		 */
+		struct in_addr address;
+
+		/**
+		 * This is the decoder which the stream from the client is read into.  A message may arrive over several reads.
+		 */
+		NetworkMessageDecoder decoder;
+	};
+
+	/**
+	 * This structure holds what is known about one sender of UDP commands.  Each sender has its own clock, so commands are only
+	 * ordered, and their age only measured, against earlier commands from the same sender.
+	 */
+	struct UdpSender {
+		/**
+		 * This is the address and port the sender sends from.  A sender which is not in use has a port of 0.
+		 */
+		struct sockaddr_in address;
+
+		/**
+		 * These are the sender timestamp and message ID of the newest command taken from the sender for each queue.  A command
+		 * which is not newer is dropped.
+		 */
+		int64_t newestTimestamp[NUMBER_OF_QUEUES];
+		int32_t newestMessageID[NUMBER_OF_QUEUES];
+
+		/**
+		 * This is the least difference seen between the clock of the robot when a command from the sender arrived and the
+		 * timestamp of the command, in ms.  Unless the clock is synchronised with the sender, the age of a command is measured
+		 * from it, since the two clocks can not be compared directly.
+		 */
+		int64_t smallestClockDifference;
+
+		/**
+		 * This is when a command was last received from the sender on the monotonic clock, in microseconds.  The sender which
+		 * has been silent longest gives up its entry when a new one needs it.
+		 */
+		int64_t lastHeard;
+	};
+
 	/**
 	 * This is the port that will be used for receiving messages over the network.
 	 */
@@ -51,9 +126,166 @@ private:
 	int server_fd=0;
 
 	/**
-	 * This is the connected socket of the network manager.  This will be updated whenever a connection is made and it is used to send messages back to the master as well as to receive messages from the master.
+	 * This is the port that UDP commands are received on, or 0 if they are not accepted.
+	 */
+	unsigned short udpPortNumber;
+
+	/**
+	 * This is the socket which UDP commands are received on, or -1 if there is none.
+	 */
+	int udp_fd=-1;
+
+	/**
+	 * These are the senders UDP commands have been received from.  They are only used by the thread of the network manager.
+	 */
+	UdpSender udpSenders[UDP_CONTROL_MAX_SENDERS];
+
+	/**
+	 * These count the UDP commands received, those refused for not coming from a controller, those dropped for being out of
+	 * order or too old, and the senders which were taken to have restarted, since the diagnostics were last reset.
+	 */
+	std::atomic<uint32_t> udpReceivedCount;
+	std::atomic<uint32_t> udpRefusedCount;
+	std::atomic<uint32_t> udpOutOfOrderCount;
+	std::atomic<uint32_t> udpStaleCount;
+	std::atomic<uint32_t> udpRestartCount;
+
+	/**
+	 * This is the least difference seen between the clock of the robot when a command arrived and the timestamp of the command,
+	 * in ms.  The clocks of the senders are not synchronised with the robot, so it is taken as the offset between the clocks.
+	 */
+	int64_t smallestClockDifference;
+
+	/**
+	 * This is a timerfd which expires each time a clock synchronisation probe is due, or -1 if there is none.
+	 */
+	int clockSyncFD;
+
+	/**
+	 * This is the messageID of the last clock synchronisation probe.  A reply with any other ID is ignored.
+	 */
+	int32_t probeID;
+
+	/**
+	 * This is when the last probe was sent on the monotonic clock, in microseconds.
+	 */
+	int64_t probeSentAt;
+
+	/**
+	 * This is the index of the client the last probe was sent to, or -1 if no probe is outstanding.
+	 */
+	int32_t probeClient;
+
+	/**
+	 * This is the index of the client the clock is synchronised with, or -1 if it is not synchronised with any.
 	 */
-	int connectedSocket=0;
+	int32_t synchronizedClient;
+
+	/**
+	 * This is the distribution of the time commands took to arrive over the network, above the fastest one, in microseconds.
+	 */
+	LatencyHistogram transitHistogram;
+
+	/**
+	 * This is the epoll instance which the listening socket, the client sockets and the stop event are waited on with.
+	 */
+	int epollFD;
+
+	/**
+	 * This is an eventfd which is signalled to stop the thread.
+	 */
+	int stopFD;
+
+	/**
+	 * These are the connected clients.  The index of each client is stored with its epoll registration.
+	 */
+	ClientConnection clients[NETWORK_MAX_CLIENTS];
+
+	/**
+	 * This is the mutex which protects the list of clients.  The thread of the network manager changes the list as clients come and
+	 * go, while the transmission thread sends to the clients on it.
+	 */
+	PIMutex clientMutex;
+
+	/**
+	 * These count the reads from client sockets and the messages they delivered, since the diagnostics were last reset.
+	 */
+	std::atomic<uint32_t> receiveCallCount;
+	std::atomic<uint32_t> receivedMessageCount;
+
+	/**
+	 * This method will accept every connection which is waiting on the listening socket.
+	 */
+	void acceptClients();
+
+	/**
+	 * This method will read whatever a client has sent, and process each message which is complete.
+	 * @param index This is the index of the client which is readable.
+	 */
+	void receiveFromClient(uint32_t index);
+
+	/**
+	 * This method will act on one complete message from a client.
+	 * @param index This is the index of the client that sent the message.
+	 * @param receivedMessage This is the message, in host byte order.
+	 */
+	void processMessage(uint32_t index, const networkMessageStruct &receivedMessage);
+
+	/**
+	 * This method will read every datagram waiting on the UDP socket, and enqueue the commands in them which are current.
+	 */
+	void receiveDatagrams();
+
+	/**
+	 * This method will indicate whether or not a connected client with the controller role has the given address.
+	 * @param address This is the IP address, in network byte order.
+	 * @return true if a controller is connected from the address.  False otherwise.
+	 */
+	bool isControllerAddress(const struct in_addr &address);
+
+	/**
+	 * This method will find the entry of a UDP sender, taking the entry of the sender which has been silent longest if it is new.
+	 * @param address This is the address and port the sender sends from.
+	 * @param now This is the current time on the monotonic clock, in microseconds.
+	 * @return The entry of the sender will be returned.
+	 */
+	UdpSender &findUdpSender(const struct sockaddr_in &address, int64_t now);
+
+	/**
+	 * This method will forget the order and clock of a UDP sender, so that its next command is taken as its first.
+	 * @param sender This is the entry of the sender.
+	 */
+	void resetUdpSender(UdpSender &sender);
+
+	/**
+	 * This method will forget the order and clock of every UDP sender.  It is called whenever the synchronized time changes its
+	 * time base, since the clock differences already measured were measured against the old one.
+	 */
+	void resetUdpSenders();
+
+	/**
+	 * This method will enqueue a command message on the queue it is addressed to.
+	 * @param receivedMessage This is the message, in host byte order.  Its checksum must already have been verified.
+	 */
+	void enqueueCommand(const networkMessageStruct &receivedMessage);
+
+	/**
+	 * This method will send a clock synchronisation probe to the first connected controller.
+	 */
+	void sendClockProbe();
+
+	/**
+	 * This method will handle the reply to a clock synchronisation probe.
+	 * @param index This is the index of the client that sent the reply.
+	 * @param receivedMessage This is the reply, in host byte order.  Its checksum must already have been verified.
+	 */
+	void processClockReply(uint32_t index, const networkMessageStruct &receivedMessage);
+
+	/**
+	 * This method will disconnect a client and free its entry.  It is only called on the thread of the network manager.
+	 * @param index This is the index of the client.
+	 */
+	void closeClient(uint32_t index);
 
 public:
 	/**
@@ -61,8 +293,9 @@ public:
 	 * @param port This is the port that the network manager is to listen on for incoming connections.
 	 * @param queue This is the array of pointers to queues that is to be used for enqueueing received requests.
 	 * @param threadName This is the name given to the executing thread.  It is a simple, string that is human readable.
+	 * @param udpPort This is the port that UDP commands are received on, or 0 if they are not to be accepted.
 	 */
-	NetworkManager(unsigned short port, CommandQueue* queue[], std::string threadName);
+	NetworkManager(unsigned short port, CommandQueue* queue[], std::string threadName, unsigned short udpPort = 0);
 
 	/**
 	 * This is the destructor for the class which will clean up from the instantiation and operation of the class.
@@ -79,10 +312,34 @@ public:
 	void stop();
 
 	/**
-	 * This method will return the socket ID for the given class.
-	 * @return The socket ID will be returned.
+	 * This method will send a message to every client with the given role.  It never blocks.  A client which can not take the
+	 * message right now misses it, and a client whose connection has failed is disconnected.
+	 * @param message This is the message that is to be sent.  It must already be in network byte order.
+	 * @param role This is the role a client must have to be sent the message.
+	 * @return The number of clients the message was sent to will be returned.
+	 */
+	uint32_t sendToClients(const networkMessageStruct &message, uint32_t role = CLIENT_ROLE_OBSERVER);
+
+	/**
+	 * This method will return the number of connected clients.
+	 * @return The number of connected clients will be returned.
+	 */
+	uint32_t getClientCount();
+
+	/**
+	 * This method will print out information about the thread, along with how many messages each read from a socket delivered.
+	 */
+	virtual void printInformation();
+
+	/**
+	 * This method will print the distribution of the time commands took to arrive over the network.
+	 */
+	virtual void printLatencyInformation();
+
+	/**
+	 * This method will reset the counts of reads and messages, and the distribution of transit times.
 	 */
-	int getSocketID();
+	virtual void resetThreadDiagnostics();
 };
 
 
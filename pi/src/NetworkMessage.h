@@ -32,6 +32,37 @@
 
 #define COMMAND_MSG_TYPE (0x09)
 
+/**
+ * This is the type of a message which sets the roles of the client which sends it.  The message field holds the role flags.
+ */
+#define ROLE_MSG_TYPE (0x0A)
+
+/**
+ * This role flag lets a client send commands to the robot.  Commands from a client without it are ignored.
+ */
+#define CLIENT_ROLE_CONTROLLER (0x01)
+
+/**
+ * This role flag has the robot send its telemetry to a client.
+ */
+#define CLIENT_ROLE_OBSERVER (0x02)
+
+/**
+ * This is the type of a message which the robot sends to acknowledge a command once it has been acted on.  The messageID is the
+ * ID of the command, the timestamp is when the robot received it in ms since the start of the Epoch in synchronized time,
+ * and the message is the time from receiving the command to acting on it, in microseconds.  The destination is the queue which
+ * the command was sent to.  The checksum is the XOR of every other field, as it is for a command.
+ */
+#define ACK_MSG_TYPE (0x0B)
+
+/**
+ * This is the type of a message which synchronises the clock of the robot with the clock of a station.  The robot sends a probe
+ * to one controller, with a new messageID and its synchronized time in the timestamp.  The client replies at once with the same
+ * messageID, the same type, and its own time in ms since the start of the Epoch in the timestamp, read just before it replies.
+ * The message and destination are 0, and the checksum is the XOR of every other field, as it is for a command.
+ */
+#define CLOCK_SYNC_MSG_TYPE (0x0C)
+
 /**
  * This structure represents a network message.
  */
@@ -0,0 +1,107 @@
+/**
+ * @file NetworkMessageDecoder.cpp
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ *      This file implements the decoder for the stream of network messages which arrives on a socket.
+ */
+
+#include "NetworkMessageDecoder.h"
+#include <string.h>
+#include <netinet/in.h>
+
+/**
+ * This is the number of 32 bit words in a message.  Every field of a message is a word, so the whole message is converted to
+ * host byte order one word at a time.
+ */
+#define WORDS_PER_MESSAGE (sizeof(networkMessageStruct) / sizeof(int32_t))
+
+/**
+ * This is the default constructor, which creates an empty decoder.
+ */
+NetworkMessageDecoder::NetworkMessageDecoder() {
+	used = 0;
+}
+
+/**
+ * This method will return where the next read from the socket is to be placed.
+ * @return A pointer to the free part of the buffer will be returned.
+ */
+char *NetworkMessageDecoder::getWritePosition() {
+	return ((char*) buffer) + used;
+}
+
+/**
+ * This method will return how many bytes the next read from the socket may place in the buffer.
+ * @return The number of free bytes in the buffer will be returned.  It is never 0 after a call to decode.
+ */
+uint32_t NetworkMessageDecoder::getFreeSpace() {
+	return sizeof(buffer) - used;
+}
+
+/**
+ * This method will decode the messages which are complete once more bytes have been read into the buffer.  The bytes of a
+ * message which is still incomplete are kept for the next read.
+ * @param bytesRead This is the number of bytes which were just read into the free part of the buffer.
+ * @param messages This is the array which receives the complete messages, in host byte order.  It must hold
+ * NETWORK_RECEIVE_BATCH messages.
+ * @return The number of complete messages will be returned.
+ */
+uint32_t NetworkMessageDecoder::decode(uint32_t bytesRead, networkMessageStruct *messages) {
+	used += bytesRead;
+	uint32_t count = used / sizeof(networkMessageStruct);
+
+	/**
+	 * 1.0 Copy out every complete message and convert them all to host byte order.
+	 */
+	memcpy(messages, buffer, count * sizeof(networkMessageStruct));
+	toHostOrder(messages, count);
+
+	/**
+	 * 2.0 Move the start of the next message, if it has partly arrived, to the front of the buffer.
+	 */
+	uint32_t decodedBytes = count * sizeof(networkMessageStruct);
+	used -= decodedBytes;
+	if (used > 0) {
+		memmove(buffer, ((char*) buffer) + decodedBytes, used);
+	}
+	return count;
+}
+
+/**
+ * This method will discard anything in the buffer, such as when the connection it came from is closed.
+ */
+void NetworkMessageDecoder::reset() {
+	used = 0;
+}
+
+/**
+ * This method will convert messages from network byte order to host byte order in place.
+ * @param messages This is the array of messages.
+ * @param count This is the number of messages in the array.
+ */
+void NetworkMessageDecoder::toHostOrder(networkMessageStruct *messages, uint32_t count) {
+	// Every field is a word, so the messages are converted in one pass over the words.
+	uint32_t *words = (uint32_t*) messages;
+	for (uint32_t index = 0; index < count * WORDS_PER_MESSAGE; index++) {
+		words[index] = ntohl(words[index]);
+	}
+}
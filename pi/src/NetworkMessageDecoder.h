@@ -0,0 +1,104 @@
+/**
+ * @file NetworkMessageDecoder.h
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ *      This file defines a decoder for the stream of network messages which arrives on a socket.  Whatever the socket has is read
+ *      into one buffer, which is reused from read to read, so a burst of messages costs one read rather than one read each.  Every
+ *      complete message in the buffer is converted to host byte order and handed out together, and a message which has only
+ *      partly arrived is kept at the front of the buffer for the next read to finish.
+ */
+
+#ifndef NETWORKMESSAGEDECODER_H_
+#define NETWORKMESSAGEDECODER_H_
+
+#include "NetworkMessage.h"
+#include <stdint.h>
+
+/**
+ * This is the most messages which are read from a socket at once.  The buffer of the decoder holds this many messages.
+ */
+#define NETWORK_RECEIVE_BATCH (32)
+
+class NetworkMessageDecoder {
+private:
+	/**
+	 * This is the buffer which the stream is read into.  It is declared as messages so that it is aligned for them.
+	 */
+	networkMessageStruct buffer[NETWORK_RECEIVE_BATCH];
+
+	/**
+	 * This is the number of bytes in the buffer which have been read but not yet decoded.
+	 */
+	uint32_t used;
+
+public:
+	/**
+	 * This is the default constructor, which creates an empty decoder.
+	 */
+	NetworkMessageDecoder();
+
+	/**
+	 * This method will return where the next read from the socket is to be placed.
+	 * @return A pointer to the free part of the buffer will be returned.
+	 */
+	char *getWritePosition();
+
+	/**
+	 * This method will return how many bytes the next read from the socket may place in the buffer.
+	 * @return The number of free bytes in the buffer will be returned.  It is never 0 after a call to decode.
+	 */
+	uint32_t getFreeSpace();
+
+	/**
+	 * This method will decode the messages which are complete once more bytes have been read into the buffer.  The bytes of a
+	 * message which is still incomplete are kept for the next read.
+	 * @param bytesRead This is the number of bytes which were just read into the free part of the buffer.
+	 * @param messages This is the array which receives the complete messages, in host byte order.  It must hold
+	 * NETWORK_RECEIVE_BATCH messages.
+	 * @return The number of complete messages will be returned.
+	 */
+	uint32_t decode(uint32_t bytesRead, networkMessageStruct *messages);
+
+	/**
+	 * This method will discard anything in the buffer, such as when the connection it came from is closed.
+	 */
+	void reset();
+
+	/**
+	 * This method will convert messages from network byte order to host byte order in place.
+	 * @param messages This is the array of messages.
+	 * @param count This is the number of messages in the array.
+	 */
+	static void toHostOrder(networkMessageStruct *messages, uint32_t count);
+
+	/**
+	 * This method will convert messages from host byte order to network byte order in place.  Swapping the bytes of a word is its
+	 * own inverse, so this is the same conversion as toHostOrder.
+	 * @param messages This is the array of messages.
+	 * @param count This is the number of messages in the array.
+	 */
+	static void toNetworkOrder(networkMessageStruct *messages, uint32_t count) {
+		toHostOrder(messages, count);
+	}
+};
+
+#endif /* NETWORKMESSAGEDECODER_H_ */
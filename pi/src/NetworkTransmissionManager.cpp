@@ -29,6 +29,7 @@
 #include "CommandQueue.h"
 #include "NetworkMessage.h"
 #include "NetworkCommands.h"
+#include "NetworkMessageDecoder.h"
 #include <sys/time.h>
 #include <unistd.h>
 #include <stdlib.h>
@@ -44,7 +45,7 @@ using namespace std;
 
 NetworkTransmissionManager::NetworkTransmissionManager(
 		NetworkManager *associatedReceptionManager, std::string threadName) :
-		RunnableClass(threadName) {
+		RunnableClass(threadName), queueMutex(threadName + " queue") {
 	this->associatedReceptionManager = associatedReceptionManager;
 	/**
 	 * Initialize the semaphore to be a counting sem with nothing on it.
@@ -69,7 +70,7 @@ void NetworkTransmissionManager::stop() {
 	 */
 	RunnableClass::stop();
 
-	networkMessageStruct endMsg;
+	networkMessageStruct endMsg = networkMessageStruct();
 
 	enqueueMessage(endMsg);
 
@@ -77,7 +78,7 @@ void NetworkTransmissionManager::stop() {
 
 void NetworkTransmissionManager::enqueueMessage(networkMessageStruct &itemToEnqueue) {
 	// Lock the queue.
-	std::lock_guard<std::mutex> guard(queueMutex);
+	std::lock_guard<PIMutex> guard(queueMutex);
 	// Place the given item on the end of the queue.
 	transmissionQueue.push(itemToEnqueue);
 	// Indicate that something has been enqueued through the semaphore.
@@ -99,7 +100,7 @@ void NetworkTransmissionManager::run() {
 			/**
 			 * Lock the queue and dequeue an item from it.
 			 */
-			std::lock_guard<std::mutex> guard(queueMutex);
+			std::lock_guard<PIMutex> guard(queueMutex);
 
 			/**
 			 * Obtain the first item from the queue and then dispose of it.
@@ -108,16 +109,11 @@ void NetworkTransmissionManager::run() {
 			transmissionQueue.pop();
 		}
 
-		// Now that we have an item to transmit,
-		itemToTransmit.message = htonl(itemToTransmit.message);
-		itemToTransmit.messageDestination = htonl(itemToTransmit.messageDestination);
-		itemToTransmit.xorChecksum = htonl(itemToTransmit.xorChecksum);
+		// Now that we have an item to transmit, convert every field to network byte order, so that the ID, timestamp and type of an
+		// acknowledgement arrive intact as well as the message.
+		NetworkMessageDecoder::toNetworkOrder(&itemToTransmit, 1);
 
-		if (associatedReceptionManager->getSocketID() > 0) {
-			// Now send it.
-			send(associatedReceptionManager->getSocketID(), &itemToTransmit, sizeof(networkMessageStruct), 0);
-		} else {
-			// DO nothing, as we are not connected through a socket right now.
-		}
+		// Now send it to every client which observes the robot.  If none are connected, it goes nowhere.
+		associatedReceptionManager->sendToClients(itemToTransmit, CLIENT_ROLE_OBSERVER);
 	}
 }
@@ -31,6 +31,10 @@
 #include "NetworkMessage.h"
 #include <string>
 #include "NetworkManager.h"
+#include "PIMutex.h"
+#include <mutex>
+#include <queue>
+#include <semaphore.h>
 
 
 class NetworkTransmissionManager: public RunnableClass {
@@ -44,7 +48,7 @@ private:
 	/**
 	 * This is a mutex for the class which is used to lock critical sections in different methods.
 	 */
-	std::mutex queueMutex;
+	PIMutex queueMutex;
 
 
 public:
@@ -12,7 +12,8 @@
 #include <thread>
 #include <math.h>
 #include <map>
-#include <mutex>              // std::mutex, std::unique_lock
+#include <mutex>              // std::unique_lock
+#include "PIMutex.h"
 
 using namespace se3910RPi;
 
@@ -24,14 +25,14 @@ std::map<uint16_t, PCA9685Driver*> PCA9685Driver::deviceMaps;
 /**
  * This mutex will protect critical sections of the code that exist and could be harmed by having race conditions occur.
  */
-static std::mutex cmtx;
+static PIMutex cmtx("PCA9685");
 
 PCA9685Driver* PCA9685Driver::obtainPCA9685Instance(uint16_t deviceID)
 {
 	/**
 	 * Lock the mutex to prevent simultaneous access here.
 	 */
-	std::unique_lock<std::mutex> lck(cmtx);
+	std::unique_lock<PIMutex> lck(cmtx);
 	if (deviceMaps.find(deviceID) == deviceMaps.end())
 	{
 		// There is no instance.  Make one and insert it.
@@ -127,7 +128,7 @@ void PCA9685Driver::shutdown()
 	/**
 	 * Lock this method to prevent multiple threads from being in here simultaneously, as things could go wrong.
 	 */
-	std::unique_lock<std::mutex> lck(cmtx);
+	std::unique_lock<PIMutex> lck(cmtx);
 
 	/**
 	 * Decrement the count indicating there is one less usage of this object.
@@ -0,0 +1,261 @@
+/**
+ * @file PIMutex.cpp
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ *      This file implements the priority inheritance mutex and its statistics.
+ */
+
+#include "PIMutex.h"
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <system_error>
+#include <time.h>
+#include <vector>
+
+/**
+ * This method will obtain the list of every mutex.  The list is created on first use, so that mutexes which are static
+ * variables in other files can register themselves no matter the order in which the statics are constructed.
+ * @return The list of every mutex will be returned.
+ */
+static std::vector<PIMutex*> &registeredMutexes() {
+	static std::vector<PIMutex*> mutexes;
+	return mutexes;
+}
+
+/**
+ * This is the lock which protects the list of every mutex.  It is a plain mutex which is statically initialized, so it is valid
+ * before any constructor runs.
+ */
+static pthread_mutex_t registryMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * This method will obtain the current time on CLOCK_MONOTONIC.
+ * @return The time will be returned in nanoseconds.
+ */
+static uint64_t monotonicNow() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec;
+}
+
+/**
+ * This constructor creates a mutex which uses priority inheritance.
+ * @param name This is the name of the mutex, as it is printed in the statistics.
+ */
+PIMutex::PIMutex(std::string name) :
+		name(name), protocol(PRIORITY_INHERITANCE), ceiling(0) {
+	initialize();
+}
+
+/**
+ * This constructor creates a mutex which uses the priority ceiling protocol.
+ * @param name This is the name of the mutex, as it is printed in the statistics.
+ * @param ceiling This is the SCHED_FIFO priority that a thread runs at while it holds the mutex.
+ */
+PIMutex::PIMutex(std::string name, int ceiling) :
+		name(name), protocol(PRIORITY_CEILING), ceiling(ceiling) {
+	initialize();
+}
+
+/**
+ * This method will set up the underlying mutex with the given protocol.
+ */
+void PIMutex::initialize() {
+	/**
+	 * 1.0 Set the protocol.  If the system does not support it, fall back to a plain mutex, which still provides mutual exclusion.
+	 */
+	pthread_mutexattr_t attributes;
+	pthread_mutexattr_init(&attributes);
+
+	int result;
+	if (protocol == PRIORITY_CEILING) {
+		result = pthread_mutexattr_setprotocol(&attributes, PTHREAD_PRIO_PROTECT);
+		if (result == 0) {
+			result = pthread_mutexattr_setprioceiling(&attributes, ceiling);
+		}
+	} else {
+		result = pthread_mutexattr_setprotocol(&attributes, PTHREAD_PRIO_INHERIT);
+	}
+	if (result != 0) {
+		printf("Mutex %s does not bound priority inversion: %s\n", name.c_str(), strerror(result));
+		pthread_mutexattr_destroy(&attributes);
+		pthread_mutexattr_init(&attributes);
+	}
+
+	pthread_mutex_init(&mutex, &attributes);
+	pthread_mutexattr_destroy(&attributes);
+
+	/**
+	 * 2.0 Add the mutex to the list, so that its statistics are printed.
+	 */
+	pthread_mutex_lock(&registryMutex);
+	registeredMutexes().push_back(this);
+	pthread_mutex_unlock(&registryMutex);
+}
+
+/**
+ * This is the destructor.  The mutex must not be locked.
+ */
+PIMutex::~PIMutex() {
+	pthread_mutex_lock(&registryMutex);
+	std::vector<PIMutex*> &mutexes = registeredMutexes();
+	mutexes.erase(std::remove(mutexes.begin(), mutexes.end(), this), mutexes.end());
+	pthread_mutex_unlock(&registryMutex);
+
+	pthread_mutex_destroy(&mutex);
+}
+
+/**
+ * This method will lock the mutex, blocking until it is available.
+ */
+void PIMutex::lock() {
+#if PIMUTEX_COLLECT_STATISTICS
+	/**
+	 * 1.0 Try to take the mutex without waiting, so that the clock is only read before blocking when the mutex is contended.
+	 */
+	if (pthread_mutex_trylock(&mutex) == 0) {
+		recordLock(0);
+		return;
+	}
+
+	/**
+	 * 2.0 Wait for the mutex, and record how long it took.
+	 */
+	uint64_t waitStart = monotonicNow();
+	int result = pthread_mutex_lock(&mutex);
+	if (result != 0) {
+		throw std::system_error(result, std::system_category(), "Unable to lock " + name);
+	}
+	contendedCount++;
+	recordLock(monotonicNow() - waitStart);
+#else
+	int result = pthread_mutex_lock(&mutex);
+	if (result != 0) {
+		throw std::system_error(result, std::system_category(), "Unable to lock " + name);
+	}
+#endif
+}
+
+/**
+ * This method will lock the mutex if it is available.  It never blocks.
+ * @return true if the mutex was locked.  False otherwise.
+ */
+bool PIMutex::try_lock() {
+	if (pthread_mutex_trylock(&mutex) != 0) {
+		return false;
+	}
+#if PIMUTEX_COLLECT_STATISTICS
+	recordLock(0);
+#endif
+	return true;
+}
+
+/**
+ * This method will unlock the mutex.  It must be called by the thread which locked it.
+ */
+void PIMutex::unlock() {
+#if PIMUTEX_COLLECT_STATISTICS
+	uint64_t holdTime = monotonicNow() - lockedAt;
+	if (holdTime > longestHoldTime) {
+		longestHoldTime = holdTime;
+	}
+#endif
+	pthread_mutex_unlock(&mutex);
+}
+
+/**
+ * This method will record that the mutex has just been locked.  It is called with the mutex held.
+ * @param waitTime This is the time the thread waited for the mutex, in nanoseconds.
+ */
+void PIMutex::recordLock(uint64_t waitTime) {
+	lockCount++;
+	totalWaitTime += waitTime;
+	if (waitTime > longestWaitTime) {
+		longestWaitTime = waitTime;
+	}
+	lockedAt = monotonicNow();
+}
+
+/**
+ * This method will obtain the underlying POSIX mutex.
+ * @return A pointer to the mutex will be returned.
+ */
+pthread_mutex_t *PIMutex::native_handle() {
+	return &mutex;
+}
+
+/**
+ * This method will return the longest time the mutex has been held.
+ * @return The longest hold time in microseconds since the statistics were last reset.
+ */
+uint64_t PIMutex::getLongestHoldTime() {
+	return longestHoldTime / 1000;
+}
+
+/**
+ * This method will return the longest time a thread has waited for the mutex.
+ * @return The longest wait time in microseconds since the statistics were last reset.
+ */
+uint64_t PIMutex::getLongestWaitTime() {
+	return longestWaitTime / 1000;
+}
+
+/**
+ * This method will print the statistics of every mutex to the console.  The statistics are read without locking the mutexes, so
+ * that printing them does not delay the threads which use them, and may be slightly out of date.
+ */
+void PIMutex::printLockStatistics() {
+	pthread_mutex_lock(&registryMutex);
+	printf("%-32s %-8s %10s %10s %14s %14s %14s\n", "Mutex", "Protocol", "Locks", "Contended", "Longest Hold", "Longest Wait",
+			"Average Wait");
+	std::vector<PIMutex*> &mutexes = registeredMutexes();
+	for (std::vector<PIMutex*>::iterator it = mutexes.begin(); it != mutexes.end(); it++) {
+		PIMutex *m = *it;
+		uint32_t contended = m->contendedCount;
+		printf("%-32s %-8s %10u %10u %11llu us %11llu us %11llu us\n", m->name.c_str(),
+				(m->protocol == PRIORITY_CEILING) ? "CEILING" : "INHERIT", (unsigned int) m->lockCount, (unsigned int) contended,
+				(unsigned long long) m->getLongestHoldTime(), (unsigned long long) m->getLongestWaitTime(),
+				(unsigned long long) ((contended == 0) ? 0 : m->totalWaitTime / contended / 1000));
+	}
+	pthread_mutex_unlock(&registryMutex);
+}
+
+/**
+ * This method will reset the statistics of every mutex.  Each mutex is locked while its statistics are reset.
+ */
+void PIMutex::resetLockStatistics() {
+	pthread_mutex_lock(&registryMutex);
+	std::vector<PIMutex*> &mutexes = registeredMutexes();
+	for (std::vector<PIMutex*>::iterator it = mutexes.begin(); it != mutexes.end(); it++) {
+		PIMutex *m = *it;
+		pthread_mutex_lock(&m->mutex);
+		m->lockCount = 0;
+		m->contendedCount = 0;
+		m->longestHoldTime = 0;
+		m->longestWaitTime = 0;
+		m->totalWaitTime = 0;
+		m->lockedAt = monotonicNow();
+		pthread_mutex_unlock(&m->mutex);
+	}
+	pthread_mutex_unlock(&registryMutex);
+}
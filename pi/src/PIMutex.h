@@ -0,0 +1,191 @@
+/**
+ * @file PIMutex.h
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ *      This file defines a mutex which bounds priority inversion between real time threads.  A plain std::mutex lets a low
+ *      priority thread which holds the lock be preempted by medium priority threads while a high priority thread waits for it,
+ *      for as long as the medium priority threads run.  This mutex prevents that with one of two POSIX protocols:
+ *
+ *      PRIORITY_INHERITANCE raises the thread which holds the lock to the priority of the highest thread waiting for it.
+ *      PRIORITY_CEILING raises any thread which takes the lock to a fixed ceiling, which must be at least the priority of every
+ *      thread that uses the lock.  It also prevents deadlock between such locks, but a thread above the ceiling may not lock it.
+ *
+ *      The mutex can be used anywhere a std::mutex is used with std::lock_guard or std::unique_lock.  A condition variable must be
+ *      a std::condition_variable_any.  Each mutex records how often it was contended and its longest hold and wait times, and
+ *      every mutex can be listed with printLockStatistics to find the critical sections which delay the real time threads.
+ */
+
+#ifndef PIMUTEX_H_
+#define PIMUTEX_H_
+
+#include <pthread.h>
+#include <stdint.h>
+#include <string>
+
+/**
+ * If this is 1, each mutex records its lock count and its hold and wait times.  This costs two reads of the clock for each lock.
+ * If it is 0, no statistics are recorded.
+ */
+#define PIMUTEX_COLLECT_STATISTICS (1)
+
+class PIMutex {
+public:
+	/**
+	 * This enumeration gives the protocol used to bound priority inversion.
+	 */
+	enum Protocol {
+		PRIORITY_INHERITANCE, PRIORITY_CEILING
+	};
+
+private:
+	/**
+	 * This is the underlying POSIX mutex.
+	 */
+	pthread_mutex_t mutex;
+
+	/**
+	 * This is the name of the mutex, as it is printed in the statistics.
+	 */
+	std::string name;
+
+	/**
+	 * This is the protocol of the mutex.
+	 */
+	Protocol protocol;
+
+	/**
+	 * This is the priority ceiling of the mutex, if it uses the ceiling protocol.
+	 */
+	int ceiling;
+
+	/**
+	 * This is the time at which the mutex was last locked, on CLOCK_MONOTONIC in nanoseconds.
+	 */
+	uint64_t lockedAt = 0;
+
+	/**
+	 * This is the number of times the mutex has been locked.
+	 */
+	uint32_t lockCount = 0;
+
+	/**
+	 * This is the number of times a thread had to wait for the mutex.
+	 */
+	uint32_t contendedCount = 0;
+
+	/**
+	 * This is the longest time the mutex has been held, in nanoseconds.
+	 */
+	uint64_t longestHoldTime = 0;
+
+	/**
+	 * This is the longest time a thread has waited for the mutex, in nanoseconds.
+	 */
+	uint64_t longestWaitTime = 0;
+
+	/**
+	 * This is the total time threads have waited for the mutex, in nanoseconds.
+	 */
+	uint64_t totalWaitTime = 0;
+
+	/**
+	 * This method will set up the underlying mutex with the given protocol.
+	 */
+	void initialize();
+
+	/**
+	 * This method will record that the mutex has just been locked.  It is called with the mutex held.
+	 * @param waitTime This is the time the thread waited for the mutex, in nanoseconds.
+	 */
+	void recordLock(uint64_t waitTime);
+
+public:
+	/**
+	 * This constructor creates a mutex which uses priority inheritance.
+	 * @param name This is the name of the mutex, as it is printed in the statistics.
+	 */
+	PIMutex(std::string name);
+
+	/**
+	 * This constructor creates a mutex which uses the priority ceiling protocol.
+	 * @param name This is the name of the mutex, as it is printed in the statistics.
+	 * @param ceiling This is the SCHED_FIFO priority that a thread runs at while it holds the mutex.
+	 */
+	PIMutex(std::string name, int ceiling);
+
+	/**
+	 * This is the destructor.  The mutex must not be locked.
+	 */
+	virtual ~PIMutex();
+
+	/**
+	 * A mutex can not be copied.
+	 */
+	PIMutex(const PIMutex&) = delete;
+	PIMutex& operator=(const PIMutex&) = delete;
+
+	/**
+	 * This method will lock the mutex, blocking until it is available.
+	 */
+	void lock();
+
+	/**
+	 * This method will lock the mutex if it is available.  It never blocks.
+	 * @return true if the mutex was locked.  False otherwise.
+	 */
+	bool try_lock();
+
+	/**
+	 * This method will unlock the mutex.  It must be called by the thread which locked it.
+	 */
+	void unlock();
+
+	/**
+	 * This method will obtain the underlying POSIX mutex.
+	 * @return A pointer to the mutex will be returned.
+	 */
+	pthread_mutex_t *native_handle();
+
+	/**
+	 * This method will return the longest time the mutex has been held.
+	 * @return The longest hold time in microseconds since the statistics were last reset.
+	 */
+	uint64_t getLongestHoldTime();
+
+	/**
+	 * This method will return the longest time a thread has waited for the mutex.
+	 * @return The longest wait time in microseconds since the statistics were last reset.
+	 */
+	uint64_t getLongestWaitTime();
+
+	/**
+	 * This method will print the statistics of every mutex to the console.
+	 */
+	static void printLockStatistics();
+
+	/**
+	 * This method will reset the statistics of every mutex.
+	 */
+	static void resetLockStatistics();
+};
+
+#endif /* PIMUTEX_H_ */
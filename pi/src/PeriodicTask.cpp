@@ -26,9 +26,43 @@
  */
 
 #include "PeriodicTask.h"
+#include "time_util.h"
+#include "Trace.h"
 #include <iostream>
 #include <chrono>
 #include <iomanip>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#ifndef SCHED_DEADLINE
+#define SCHED_DEADLINE (6)
+#endif
+
+/**
+ * This is the layout of the attributes passed to the sched_setattr system call.  The C library has no wrapper for it.
+ */
+struct DeadlineSchedAttr {
+	uint32_t size;
+	uint32_t schedPolicy;
+	uint64_t schedFlags;
+	int32_t schedNice;
+	uint32_t schedPriority;
+	uint64_t schedRuntime;
+	uint64_t schedDeadline;
+	uint64_t schedPeriod;
+};
+
+/**
+ * This flag makes threads created by a deadline task start under SCHED_OTHER.  Without it, a deadline task can not create threads.
+ */
+#define DEADLINE_FLAG_RESET_ON_FORK (0x01)
+
+/**
+ * This is the smallest runtime, in nanoseconds, that the kernel accepts for a deadline task.
+ */
+#define DEADLINE_MINIMUM_RUNTIME (1024)
 
 /**
  * This is the default constructor for the class.
@@ -37,22 +71,21 @@
  * Must be at least 100 microseconds.
  */
 PeriodicTask::PeriodicTask(std::string threadName, uint32_t period) :
-		RunnableClass(threadName) {
+		RunnableClass(threadName), serviceReleaseMutex(threadName + " releases") {
 	this->setTaskPeriod(period);
 	this->setPriority(1);
+	sem_init(&serviceReleaseSemaphore, 0, 0);
 }
 
 /**
  * This method will clean up from the periodic task and its execution.
  */
 PeriodicTask::~PeriodicTask() {
-	/**
-	 * Nothing to be done in the destructor.
-	 */
+	sem_destroy(&serviceReleaseSemaphore);
 }
 
 /**
- * This will set the period for the given task.
+ * This will set the period for the given task.  If the task is running, the new period takes effect from its next release.
  * @param period This is the period, given in microseconds, between executions of this task.
  * However, it must be at least 100 microseconds (.1 ms)
  */
@@ -61,7 +94,28 @@ void PeriodicTask::setTaskPeriod(uint32_t period) {
 	 * Set the task period to the parameter passed in if it is greater than or equal to 100.
 	 */
 	if (period >= 100) {
-		taskPeriod = period;
+		if (runStarted) {
+			/**
+			 * The thread of the task is using the period, so hand the change to it.
+			 */
+			requestedPeriod.store(period);
+		} else {
+			taskPeriod = period;
+		}
+	}
+}
+
+/**
+ * This method will apply a period which was requested while the task was running.  It is called from the thread of the task
+ * between executions.  A task running under SCHED_DEADLINE is readmitted with the new period.
+ */
+void PeriodicTask::applyRequestedPeriod() {
+	uint32_t period = requestedPeriod.exchange(0);
+	if (period != 0 && period != taskPeriod.load(std::memory_order_relaxed)) {
+		taskPeriod.store(period, std::memory_order_relaxed);
+		if (deadlineRuntime > 0) {
+			configureScheduler();
+		}
 	}
 }
 
@@ -70,7 +124,174 @@ void PeriodicTask::setTaskPeriod(uint32_t period) {
  * @return the Task period in microseconds will be returned.
  */
 uint32_t PeriodicTask::getTaskPeriod() {
-	return taskPeriod;
+	return taskPeriod.load(std::memory_order_relaxed);
+}
+
+/**
+ * This method will set the release mode for the task.  It should be set before the task is started.
+ * @param mode This is the mode that is to be used to compute the release of each period.
+ */
+void PeriodicTask::setReleaseMode(ReleaseMode mode) {
+	releaseMode = mode;
+}
+
+/**
+ * This method will return the release mode for the task.
+ * @return The release mode for the task will be returned.
+ */
+PeriodicTask::ReleaseMode PeriodicTask::getReleaseMode() {
+	return releaseMode;
+}
+
+/**
+ * This method will set the overrun policy for the task.
+ * @param policy This is the policy that is to be followed when the task overruns its period.
+ */
+void PeriodicTask::setOverrunPolicy(OverrunPolicy policy) {
+	overrunPolicy = policy;
+}
+
+/**
+ * This method will return the overrun policy for the task.
+ * @return The overrun policy for the task will be returned.
+ */
+PeriodicTask::OverrunPolicy PeriodicTask::getOverrunPolicy() {
+	return overrunPolicy;
+}
+
+/**
+ * This method will set the largest number of late releases that the CATCH_UP policy runs back to back.
+ * @param limit This is the maximum length of a catch up burst.  It must be at least 1.
+ */
+void PeriodicTask::setCatchUpLimit(uint32_t limit) {
+	if (limit >= 1) {
+		catchUpLimit = limit;
+	}
+}
+
+/**
+ * This method will select whether the task runs under SCHED_DEADLINE or SCHED_FIFO.  It must be called before the task starts.
+ * @param enabled If this is true, the task runs under SCHED_DEADLINE.
+ */
+void PeriodicTask::setDeadlineScheduling(bool enabled) {
+	deadlineScheduling = enabled;
+}
+
+/**
+ * This method will return the SCHED_DEADLINE runtime that is in use for the task.
+ * @return The runtime in microseconds, or 0 if the task is not running under SCHED_DEADLINE.
+ */
+long PeriodicTask::getDeadlineRuntime() {
+	return deadlineRuntime / 1000;
+}
+
+/**
+ * This method will return the number of executions which were throttled because they used up their SCHED_DEADLINE runtime.
+ * @return The count of budget exhaustions since the diagnostics were last reset.
+ */
+uint32_t PeriodicTask::getBudgetExhaustionCount() {
+	return budgetExhaustionCount;
+}
+
+/**
+ * This method will set the scheduling policy of the thread of the task.  If deadline scheduling is enabled, the task is run
+ * under SCHED_DEADLINE with its period as both deadline and period.  Otherwise, or if the kernel refuses, it runs under SCHED_FIFO.
+ */
+void PeriodicTask::configureScheduler() {
+	deadlineRuntime = 0;
+	if (!deadlineScheduling) {
+		RunnableClass::configureScheduler();
+		return;
+	}
+
+	/**
+	 * 1.0 Derive the runtime from the larger of the measured worst case execution time and the budget, plus a margin.  A task with
+	 * neither is given a fixed share of its period.
+	 */
+	uint64_t period = (uint64_t) taskPeriod * 1000;
+	long executionTime = worstCaseExecutionTime > wcetBudget ? worstCaseExecutionTime : wcetBudget;
+	uint64_t runtime;
+	if (executionTime > 0) {
+		runtime = (uint64_t) (executionTime * 1000 * SCHED_DEADLINE_RUNTIME_MARGIN);
+	} else {
+		runtime = (uint64_t) (period * SCHED_DEADLINE_DEFAULT_UTILIZATION);
+	}
+	if (runtime < DEADLINE_MINIMUM_RUNTIME) {
+		runtime = DEADLINE_MINIMUM_RUNTIME;
+	}
+	if (runtime > period) {
+		runtime = period;
+	}
+
+	/**
+	 * 2.0 Ask the kernel for the reservation.  It refuses if the total utilization of the deadline tasks would be too high.
+	 */
+	struct DeadlineSchedAttr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.schedPolicy = SCHED_DEADLINE;
+	attr.schedFlags = DEADLINE_FLAG_RESET_ON_FORK;
+	attr.schedRuntime = runtime;
+	attr.schedDeadline = period;
+	attr.schedPeriod = period;
+
+	if (syscall(SYS_sched_setattr, 0, &attr, 0) != 0) {
+		printf("Failed to set SCHED_DEADLINE for %s, using SCHED_FIFO: %s\n", myName.c_str(), strerror(errno));
+		RunnableClass::configureScheduler();
+		return;
+	}
+	deadlineRuntime = runtime;
+}
+
+/**
+ * This method will return the number of times the task has overrun its period.
+ * @return The count of overruns since the diagnostics were last reset.
+ */
+uint32_t PeriodicTask::getOverrunCount() {
+	return overrunCount;
+}
+
+/**
+ * This method will return the number of releases which have been skipped because the task was more than a full period late.
+ * @return The count of skipped releases since the diagnostics were last reset.
+ */
+uint32_t PeriodicTask::getSkippedReleaseCount() {
+	return skippedReleaseCount;
+}
+
+/**
+ * This method will return the worst case execution time measured for the task.
+ * @return The worst case CPU time of one execution in microseconds since the diagnostics were last reset.
+ */
+long PeriodicTask::getWorstCaseExecutionTime() {
+	return worstCaseExecutionTime;
+}
+
+/**
+ * This method will return the moving average of the execution time of the task.  Unlike the worst case, it follows the
+ * current load, so it falls again after a burst.
+ * @return The average CPU time of one execution in microseconds.
+ */
+long PeriodicTask::getAverageExecutionTime() {
+	return averageExecutionTime.load(std::memory_order_relaxed);
+}
+
+/**
+ * This method will set the execution time budget for the task.
+ * @param budget This is the estimated worst case execution time of the task in microseconds.
+ */
+void PeriodicTask::setWCETBudget(long budget) {
+	if (budget >= 0) {
+		wcetBudget = budget;
+	}
+}
+
+/**
+ * This method will return the execution time budget for the task.
+ * @return The estimated worst case execution time of the task in microseconds.  0 if no budget has been set.
+ */
+long PeriodicTask::getWCETBudget() {
+	return wcetBudget;
 }
 
 /**
@@ -84,6 +305,80 @@ void PeriodicTask::waitForNextExecution(
 	std::this_thread::sleep_for(remainingSleepTime);
 }
 
+/**
+ * This method will suspend execution until the next release time has been reached.  It will do this by blocking on an absolute time
+ * so that wakeup latency does not accumulate from one period to the next.
+ */
+void PeriodicTask::waitForNextExecution() {
+	/**
+	 * Sleep until the absolute release time.  If a signal interrupts the sleep, simply go back to sleep, as the deadline has not moved.
+	 */
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &nextReleaseTime, NULL) == EINTR) {
+	}
+}
+
+/**
+ * This method will compute the next release time after an execution of the task has completed.  If the task has overrun its period,
+ * the overrun is counted and the overrun policy decides which of the releases that are already due are run.
+ * @param completionTime This is the time at which the current execution of the task completed.
+ */
+void PeriodicTask::computeNextRelease(const struct timespec &completionTime) {
+	/**
+	 * 1.0 The next release is exactly one period after the current release.
+	 */
+	timespec_add_us(nextReleaseTime, taskPeriod);
+
+	/**
+	 * 2.0 Determine how late we are relative to that release.  If the release is still in the future, there is nothing more to do.
+	 */
+	int64_t lateness = timespec_delta_us(nextReleaseTime, completionTime);
+	if (lateness >= 0) {
+		/**
+		 * 2.1 The task completed after the next release was due, so this is an overrun, unless the execution was itself part of
+		 * the backlog of an earlier one.  Every release up to the completion time is already due.
+		 */
+		if (!backlogRelease) {
+			overrunCount++;
+		}
+		int64_t dueReleases = lateness / taskPeriod + 1;
+
+		/**
+		 * 2.2 Decide how many of the due releases to drop.  Dropping a release moves the next release on by a whole period, so the
+		 * task always stays aligned to its original phase.
+		 */
+		int64_t droppedReleases;
+		if (overrunPolicy == CATCH_UP) {
+			/**
+			 * 2.2.1 Run the due releases back to back, up to the catch up limit, so that a short overload loses no work but a long one
+			 * does not starve the lower priority tasks.
+			 */
+			droppedReleases = dueReleases > catchUpLimit ? dueReleases - catchUpLimit : 0;
+		} else {
+			/**
+			 * 2.2.2 Give the task the chance to shed load, then wait for the first release which is still in the future.
+			 */
+			if (overrunPolicy == DEGRADE) {
+				handleOverrun(dueReleases);
+			}
+			droppedReleases = dueReleases;
+		}
+
+		if (droppedReleases > 0) {
+			skippedReleaseCount += droppedReleases;
+			timespec_add_us(nextReleaseTime, droppedReleases * taskPeriod);
+		}
+	}
+}
+
+/**
+ * This method is called when the task overruns its period and its overrun policy is DEGRADE.  Derived classes override it to
+ * reduce the work done by each execution.  It is called from the thread of the task, between executions.
+ * @param missedReleases This is the number of releases which were already due when the execution completed.
+ */
+void PeriodicTask::handleOverrun(uint32_t /*missedReleases*/) {
+	// By default, a task has no way to reduce its work, so the overrun is only counted.
+}
+
 /**
  * This method will return the CPU usage for the given task.  The usage will be as a percentage value.
  */
@@ -99,10 +394,15 @@ double PeriodicTask::getCPUUsageInfo() {
 void PeriodicTask::printInformation() {
 	std::cout << myOSThreadID << "\t" << std::setw(18) << myName << "\t "
 			<< std::setw(5) << getPriority() << "\t " << std::setw(10)
-			<< taskPeriod << "\t " << std::setw(18) << lastExecutionTime
+			<< taskPeriod.load(std::memory_order_relaxed) << "\t " << std::setw(18) << lastExecutionTime
 			<< "\t " << std::setw(8) << worstCaseExecutionTime << "\t "
+			<< std::setw(10) << lastReleaseJitter << "\t " << std::setw(13)
+			<< worstCaseReleaseJitter << "\t "
 			<< std::setw(18) << lastWallTime.count() << "\t " << std::setw(8)
-			<< worstCaseWallTime.count() << "\t" << std::fixed
+			<< worstCaseWallTime.count() << "\t " << std::setw(8)
+			<< overrunCount << "\t " << std::setw(7) << skippedReleaseCount
+			<< "\t " << std::setw(9) << budgetExhaustionCount
+			<< "\t" << std::fixed
 			<< std::setprecision(3) << getCPUUsageInfo() << "%";
 	if (worstCaseWallTime.count() > taskPeriod) {
 		std::cout << "**";
@@ -110,6 +410,18 @@ void PeriodicTask::printInformation() {
 	std::cout << "\n";
 }
 
+/**
+ * This method will print out the release jitter, execution time and wall time distributions for the task.
+ */
+void PeriodicTask::printLatencyInformation() {
+	std::cout << myOSThreadID << "\t" << std::setw(18) << myName << "\t Jitter     \t";
+	releaseJitterHistogram.printPercentiles();
+	std::cout << myOSThreadID << "\t" << std::setw(18) << myName << "\t Execution  \t";
+	executionTimeHistogram.printPercentiles();
+	std::cout << myOSThreadID << "\t" << std::setw(18) << myName << "\t Wall Time  \t";
+	wallTimeHistogram.printPercentiles();
+}
+
 /**
  * This method will reset thread diagnostics back to their default values.
  */
@@ -119,80 +431,269 @@ void PeriodicTask::resetThreadDiagnostics() {
 	lastExecutionTime = 0;
 	lastWallTime = std::chrono::microseconds(0);
 	worstCaseWallTime = std::chrono::microseconds(0);
+	lastReleaseJitter = 0;
+	worstCaseReleaseJitter = 0;
+	overrunCount = 0;
+	skippedReleaseCount = 0;
+	budgetExhaustionCount = 0;
+	releaseJitterHistogram.reset();
+	executionTimeHistogram.reset();
+	wallTimeHistogram.reset();
 }
 
 /**
- * This is a private method that will be used by start to invoke the run method.
+ * This method will execute one release of the task.  It measures the release jitter, CPU time and wall time of the
+ * execution and updates the diagnostics accordingly.
+ * @param releaseTime This is the instant, on CLOCK_MONOTONIC, at which this execution was released.
+ * @param completionTime This will be set to the instant, on CLOCK_MONOTONIC, at which the execution completed.
  */
-void PeriodicTask::run() {
+void PeriodicTask::executeRelease(const struct timespec &releaseTime,
+		struct timespec &completionTime) {
+	// Get the start time for the given iteration of the task.
+	clockid_t threadTimer;
+	struct timespec startTs;
+	struct timespec endTs;
+	struct timespec wallStart;
+
 	/**
-	 * Set keep going to be true, to indicate that the thread is to continue running.
+	 * The following gets the wall time, for determining the release jitter and next execution time.
 	 */
-	keepGoing = true;
+	clock_gettime(CLOCK_MONOTONIC, &wallStart);
+	struct timespec followingRelease = releaseTime;
+	timespec_add_us(followingRelease, taskPeriod.load(std::memory_order_relaxed));
+	backlogRelease = (timespec_delta_us(releaseTime, previousCompletionTime) >= 0)
+			|| (timespec_delta_us(followingRelease, wallStart) >= 0);
 
-	while (keepGoing == true) {
-		// Get the start time for the given iteration of the task.
-		clockid_t threadTimer;
-		struct timespec startTs;
-		struct timespec endTs;
+	/**
+	 * The release jitter is how far after the intended release time the task actually started.
+	 */
+	long jitter = timespec_delta_us(releaseTime, wallStart);
+	if (jitter < 0) {
+		jitter = 0;
+	}
+	lastReleaseJitter = jitter;
+	if (jitter > worstCaseReleaseJitter) {
+		worstCaseReleaseJitter = jitter;
+	}
+	releaseJitterHistogram.recordValue(jitter);
+
+	/**
+	 * Obtain the cpu time at the start of this periodic task. This is for CPU time measurement.
+	 **/
+	pthread_getcpuclockid(pthread_self(), &threadTimer);
+	clock_gettime(threadTimer, &startTs);
+
+	/**Now run the task.
+	 * Call the task method.
+	 */
+	TRACE_EVENT(TRACE_BEGIN, myName.c_str(), 0);
+	this->taskMethod();
+	TRACE_EVENT(TRACE_END, myName.c_str(), 0);
 
+	/**
+	 *Now get the end CPU time entry.
+	 **/
+	clock_gettime(threadTimer, &endTs);
+	long deltaInus = (endTs.tv_sec * 1000000 + endTs.tv_nsec / 1000)
+			- (startTs.tv_sec * 1000000 + startTs.tv_nsec / 1000);
+
+	/**
+	 * Determine where we are in terms of the worst case execution time.
+	 */
+	if (deltaInus > worstCaseExecutionTime) {
+		worstCaseExecutionTime = deltaInus;
+	}
+	lastExecutionTime = deltaInus;
+	long average = averageExecutionTime.load(std::memory_order_relaxed);
+	if (average == 0) {
+		average = deltaInus;
+	} else {
+		average += (deltaInus - average) / 8;
+	}
+	averageExecutionTime.store(average, std::memory_order_relaxed);
+	executionTimeHistogram.recordValue(deltaInus);
+
+	/**
+	 * If the execution used all of its SCHED_DEADLINE runtime, the kernel throttled it until the next period.
+	 */
+	if (deadlineRuntime > 0 && (uint64_t) deltaInus * 1000 >= deadlineRuntime) {
+		budgetExhaustionCount++;
+	}
+
+	/**
+	 * Now figure out exactly what time it is to schedule the next execution.
+	 */
+	clock_gettime(CLOCK_MONOTONIC, &completionTime);
+	previousCompletionTime = completionTime;
+
+	// Now figure out the difference.
+	lastWallTime = std::chrono::microseconds(
+			timespec_delta_us(wallStart, completionTime));
+	if (lastWallTime > worstCaseWallTime) {
+		worstCaseWallTime = lastWallTime;
+	}
+	wallTimeHistogram.recordValue(lastWallTime.count());
+}
+
+/**
+ * This method is called by the timer service to release the task.  It may be called while the task is still running.
+ * @param releaseTime This is the instant, on CLOCK_MONOTONIC, of the latest release.
+ * @param releaseCount This is the number of releases which became due, including the latest.
+ */
+void PeriodicTask::release(const struct timespec &releaseTime, uint32_t releaseCount) {
+	{
+		std::lock_guard<PIMutex> lock(serviceReleaseMutex);
+		latestServiceRelease = releaseTime;
+		pendingServiceReleases += releaseCount;
+	}
+	sem_post(&serviceReleaseSemaphore);
+}
+
+/**
+ * This method will run the task on the releases from the timer service until the task is stopped.  It applies the overrun
+ * policy in the same way as computeNextRelease: when several releases are due at once, SKIP and DEGRADE run only the latest,
+ * and CATCH_UP runs up to the catch up limit of the latest.
+ */
+void PeriodicTask::runServiceReleases() {
+	while (keepGoing == true) {
 		/**
-		 * The following gets the wall time, for determining next execution time.
+		 * 1.0 Wait to be released.  Several releases may have been posted, so take them all at once.
 		 */
-		std::chrono::high_resolution_clock::time_point start =
-				std::chrono::high_resolution_clock::now();
+		sem_wait(&serviceReleaseSemaphore);
+		while (sem_trywait(&serviceReleaseSemaphore) == 0) {
+		}
 
-		/**
-		 * Obtain the cpu time at the start of this periodic task. This is for CPU time measurement.
-		 **/
-		pthread_getcpuclockid(pthread_self(), &threadTimer);
-		clock_gettime(threadTimer, &startTs);
+		struct timespec releaseTime;
+		uint32_t dueReleases;
+		{
+			std::lock_guard<PIMutex> lock(serviceReleaseMutex);
+			releaseTime = latestServiceRelease;
+			dueReleases = pendingServiceReleases;
+			pendingServiceReleases = 0;
+		}
+		if (keepGoing == false) {
+			break;
+		}
 
-		/**Now run the task.
-		 * Call the task method.
+		/**
+		 * 2.0 More than one release is due only if the last execution overran, or the timer service itself was held up.  Let the
+		 * overrun policy decide how many of them to run.  Those which are dropped are the oldest, so the task stays in phase.
 		 */
-		this->taskMethod();
+		uint32_t runReleases = dueReleases;
+		if (overrunPolicy == CATCH_UP) {
+			runReleases = dueReleases > catchUpLimit ? catchUpLimit : dueReleases;
+		} else if (dueReleases > 1) {
+			runReleases = 1;
+		}
+		skippedReleaseCount += dueReleases - runReleases;
 
 		/**
-		 *Now get the end CPU time entry.
-		 **/
-		clock_gettime(threadTimer, &endTs);
-		long deltaInus = (endTs.tv_sec * 1000000 + endTs.tv_nsec / 1000)
-				- (startTs.tv_sec * 1000000 + startTs.tv_nsec / 1000);
+		 * 3.0 Run the remaining releases in order.
+		 */
+		for (uint32_t remaining = runReleases; remaining > 0 && keepGoing; remaining--) {
+			struct timespec thisRelease = releaseTime;
+			timespec_add_us(thisRelease, -(int64_t) (remaining - 1) * taskPeriod);
+
+			struct timespec completionTime;
+			executeRelease(thisRelease, completionTime);
+
+			/**
+			 * 3.1 If the execution started on time and completed after the following release was due, it is an overrun.  The
+			 * releases which became due meanwhile arrive with the next wakeup, where the overrun policy decides which are run.
+			 */
+			struct timespec followingRelease = thisRelease;
+			timespec_add_us(followingRelease, taskPeriod);
+			int64_t lateness = timespec_delta_us(followingRelease, completionTime);
+			if (lateness >= 0 && !backlogRelease) {
+				overrunCount++;
+				if (overrunPolicy == DEGRADE) {
+					handleOverrun(lateness / taskPeriod + 1);
+				}
+			}
+		}
 
 		/**
-		 * Determine where we are in terms of the worst case execution time.
+		 * 4.0 Pick up a change of period.  The timer service reads the new period when it schedules the next release.
 		 */
-		if (deltaInus > worstCaseExecutionTime) {
-			worstCaseExecutionTime = deltaInus;
-		}
-		lastExecutionTime = deltaInus;
+		applyRequestedPeriod();
+	}
+}
 
+/**
+ * This method will stop the task.  A task released by the timer service is woken so that it exits at once.
+ */
+void PeriodicTask::stop() {
+	RunnableClass::stop();
+	if (releaseMode == TIMER_SERVICE_RELEASE) {
+		sem_post(&serviceReleaseSemaphore);
+	}
+}
+
+/**
+ * This is the run method for the class.  It releases the task method once per period.
+ */
+void PeriodicTask::run() {
+	/**
+	 * Set keep going to be true, to indicate that the thread is to continue running.
+	 */
+	keepGoing = true;
+
+	if (releaseMode == TIMER_SERVICE_RELEASE) {
 		/**
-		 * Now figure out exactly what time it is to schedule the next execution.
+		 * The timer service decides when the task is released.
 		 */
-		std::chrono::high_resolution_clock::time_point end =
-				std::chrono::high_resolution_clock::now();
+		runServiceReleases();
+		return;
+	}
 
-		// Now figure out the difference.
-		std::chrono::microseconds executionTime = std::chrono::duration_cast<
-				std::chrono::microseconds>(end - start);
+	/**
+	 * The first release happens immediately.  Every later release is computed from this one.
+	 */
+	clock_gettime(CLOCK_MONOTONIC, &nextReleaseTime);
 
-		lastWallTime = executionTime;
-		if (lastWallTime > worstCaseWallTime) {
-			worstCaseWallTime = lastWallTime;
-		}
+	while (keepGoing == true) {
+		struct timespec completionTime;
 
 		/**
-		 * Figure out how long to sleep.
+		 * Run the task once and measure it.
 		 */
-		std::chrono::microseconds remainingSleepTime =
-				std::chrono::microseconds(taskPeriod) - executionTime;
+		executeRelease(nextReleaseTime, completionTime);
 
 		/**
-		 * Sleep until the next execution should occur.
+		 * Pick up a change of period before the next release is computed from it.
 		 */
-		waitForNextExecution(remainingSleepTime);
+		applyRequestedPeriod();
+
+		if (releaseMode == ABSOLUTE_RELEASE) {
+			/**
+			 * Compute the next release on the absolute time line and sleep until it arrives.
+			 */
+			computeNextRelease(completionTime);
+			waitForNextExecution();
+		} else {
+			/**
+			 * Figure out how long to sleep.
+			 */
+			std::chrono::microseconds remainingSleepTime =
+					std::chrono::microseconds(taskPeriod.load(std::memory_order_relaxed)) - lastWallTime;
+
+			if (remainingSleepTime.count() < 0) {
+				overrunCount++;
+				if (overrunPolicy == DEGRADE) {
+					handleOverrun(1);
+				}
+			}
+
+			/**
+			 * The intended release is measured from the end of this execution, which is what makes this mode drift.
+			 */
+			nextReleaseTime = completionTime;
+			timespec_add_us(nextReleaseTime, remainingSleepTime.count());
+
+			/**
+			 * Sleep until the next execution should occur.
+			 */
+			waitForNextExecution(remainingSleepTime);
+		}
 	}
 }
-
@@ -29,28 +29,108 @@
 #define PERIODICTASK_H_
 
 #include "RunnableClass.h"
+#include "LatencyHistogram.h"
+#include "SchedulingCfg.h"
+#include "PIMutex.h"
 
 #include <chrono>
+#include <atomic>
+#include <time.h>
+#include <mutex>
+#include <semaphore.h>
+
+/**
+ * This is the default number of late releases that a task using the CATCH_UP overrun policy will run back to back.
+ */
+#define PERIODIC_TASK_DEFAULT_CATCH_UP_LIMIT (2)
 
 class PeriodicTask: public RunnableClass {
+	/**
+	 * The cyclic executive runs the task method of several periodic tasks from its own thread, so it needs access to
+	 * the release and diagnostic bookkeeping of each task.
+	 */
+	friend class CyclicExecutive;
+
+	/**
+	 * The timer service releases tasks from its own thread.
+	 */
+	friend class TimerService;
+
+public:
+	/**
+	 * This enumeration defines how the release of the next period is computed.
+	 * RELATIVE_RELEASE sleeps for the remainder of the period after the task method returns, so any wakeup latency accumulates as phase drift.
+	 * ABSOLUTE_RELEASE computes each release instant from the previous one and sleeps until that instant on CLOCK_MONOTONIC, so the task does not drift.
+	 * TIMER_SERVICE_RELEASE blocks until the task is released by a timer service, which releases all of its tasks from one timer.
+	 * It is set by TimerService::addTask.
+	 */
+	enum ReleaseMode {
+		RELATIVE_RELEASE, ABSOLUTE_RELEASE, TIMER_SERVICE_RELEASE
+	};
+
+	/**
+	 * This enumeration defines what the task does when an execution completes after its next release was due.  Every policy counts the overrun.
+	 * SKIP_TO_NEXT_RELEASE drops every release which is already due and waits for the next release on the original time line.
+	 * CATCH_UP runs the releases which are already due back to back, but never more than the catch up limit.  Any beyond that are dropped.
+	 * DEGRADE calls handleOverrun so that the task can shed load, and then drops the due releases as SKIP_TO_NEXT_RELEASE does.
+	 */
+	enum OverrunPolicy {
+		SKIP_TO_NEXT_RELEASE, CATCH_UP, DEGRADE
+	};
+
 private:
 	/**
 	 * This variable sets the period for the task.  The period defines the length of
 	 * time from one invocation until the next invocation.  The task period is given
-	 * in microseconds.  Default value is 100 ms or 100000 microseconds.
+	 * in microseconds.  Default value is 100 ms or 100000 microseconds.  Only the thread of the task changes it once the task is
+	 * running, but other threads such as the elastic manager read it, so it is atomic.
+	 */
+	std::atomic<uint32_t> taskPeriod = {100000};
+
+	/**
+	 * This is a period which has been requested for the task while it is running, in microseconds, or 0 if there is none.  The
+	 * thread of the task applies it between executions, so that the period never changes part way through computing a release.
 	 */
-	uint32_t taskPeriod = 100000;
+	std::atomic<uint32_t> requestedPeriod = {0};
 
 	/**
 	 * This variable stores the worst case execution time from a CPU time standpoint.
 	 */
 	long worstCaseExecutionTime = 0;
 
+	/**
+	 * This variable holds the execution time budget for the task in microseconds.  It is the designer's estimate of the
+	 * worst case execution time, used by the schedulability analysis until a larger execution time has been measured.
+	 */
+	long wcetBudget = 0;
+
+	/**
+	 * This variable determines whether the task is to run under SCHED_DEADLINE instead of SCHED_FIFO.
+	 */
+	bool deadlineScheduling = (USE_SCHED_DEADLINE != 0);
+
+	/**
+	 * This is the SCHED_DEADLINE runtime of the task in nanoseconds.  It is 0 if the task is not running under SCHED_DEADLINE.
+	 */
+	uint64_t deadlineRuntime = 0;
+
+	/**
+	 * This is a count of the number of executions which used up the whole SCHED_DEADLINE runtime, and so were throttled by the
+	 * kernel until the next period.
+	 */
+	uint32_t budgetExhaustionCount = 0;
+
 	/**
 	 * This variable holds the last execution value for the CPU, showing the time it took to execute.
 	 */
 	long lastExecutionTime = 0;
 
+	/**
+	 * This is an exponentially weighted moving average of the CPU execution time of the task in microseconds.  Each execution
+	 * contributes one eighth.  It is read by the elastic manager on another thread, so it is atomic.
+	 */
+	std::atomic<long> averageExecutionTime = {0};
+
 	/**
 	 * This variable holds the last wall time measurement for the given periodic task.  The wall time is the time from the start to the end of the task running.
 	 */
@@ -62,19 +142,151 @@ private:
 	std::chrono::microseconds worstCaseWallTime = std::chrono::microseconds(0);
 
 	/**
-	 * This is a private method that will be used by start to invoke the run method.
+	 * This variable determines how the next release of the task is computed.  By default, releases are computed on an absolute time line.
+	 */
+	ReleaseMode releaseMode = ABSOLUTE_RELEASE;
+
+	/**
+	 * This variable determines what the task does when it overruns its period.
+	 */
+	OverrunPolicy overrunPolicy = SKIP_TO_NEXT_RELEASE;
+
+	/**
+	 * This is the largest number of late releases that the CATCH_UP policy will run back to back.
+	 */
+	uint32_t catchUpLimit = PERIODIC_TASK_DEFAULT_CATCH_UP_LIMIT;
+
+	/**
+	 * This is the instant, on CLOCK_MONOTONIC, at which the next execution of the task is to be released.
+	 */
+	struct timespec nextReleaseTime;
+
+	/**
+	 * This semaphore is posted by the timer service each time it releases the task.
+	 */
+	sem_t serviceReleaseSemaphore;
+
+	/**
+	 * This mutex protects the latest release from the timer service and the count of releases which are waiting to be run.
+	 */
+	PIMutex serviceReleaseMutex;
+
+	/**
+	 * This is the time of the latest release from the timer service.
+	 */
+	struct timespec latestServiceRelease;
+
+	/**
+	 * This is the number of releases from the timer service which have not been run yet.
+	 */
+	uint32_t pendingServiceReleases = 0;
+
+	/**
+	 * This is the instant, on CLOCK_MONOTONIC, at which the previous execution of the task completed.
+	 */
+	struct timespec previousCompletionTime = { 0, 0 };
+
+	/**
+	 * This is true if the last execution was for a release which was already late when it started: either it was due before the
+	 * execution ahead of it completed, or it did not start until its following release was due.  Such a release is part of a
+	 * backlog which the task did not cause by running it, so running late is not counted as an overrun.
+	 */
+	bool backlogRelease = false;
+
+	/**
+	 * This variable holds the last release jitter, in microseconds.  The release jitter is the time from when the task should have been released until it actually started running.
+	 */
+	long lastReleaseJitter = 0;
+
+	/**
+	 * This variable holds the worst case release jitter in microseconds.
+	 */
+	long worstCaseReleaseJitter = 0;
+
+	/**
+	 * This is a count of the number of times that an execution of the task completed after the next release was due.
+	 */
+	uint32_t overrunCount = 0;
+
+	/**
+	 * This is a count of the number of releases that were skipped entirely because the task was more than a full period late.
+	 */
+	uint32_t skippedReleaseCount = 0;
+
+	/**
+	 * This is the distribution of release jitter for the task, in microseconds.
 	 */
-	void invokeRun();
+	LatencyHistogram releaseJitterHistogram;
+
+	/**
+	 * This is the distribution of the CPU execution time for the task, in microseconds.
+	 */
+	LatencyHistogram executionTimeHistogram;
+
+	/**
+	 * This is the distribution of the wall time for the task, in microseconds.
+	 */
+	LatencyHistogram wallTimeHistogram;
 
 	/**
 	 * This method will suspend execution until the next period has been reached.  It will do this by blocking.
 	 */
 	void waitForNextExecution(std::chrono::microseconds remainingSleepTime);
 	/**
-	 * This method will suspend execution until the next period has been reached.  It will do this by blocking.
+	 * This method will suspend execution until the next release time has been reached.  It will do this by blocking on an absolute time
+	 * so that wakeup latency does not accumulate from one period to the next.
 	 */
 	void waitForNextExecution();
 
+	/**
+	 * This method will compute the next release time after an execution of the task has completed.  If the task has overrun its period,
+	 * the overrun is counted and the overrun policy decides which of the releases that are already due are run.
+	 * @param completionTime This is the time at which the current execution of the task completed.
+	 */
+	void computeNextRelease(const struct timespec &completionTime);
+
+	/**
+	 * This method will execute one release of the task.  It measures the release jitter, CPU time and wall time of the
+	 * execution and updates the diagnostics accordingly.
+	 * @param releaseTime This is the instant, on CLOCK_MONOTONIC, at which this execution was released.
+	 * @param completionTime This will be set to the instant, on CLOCK_MONOTONIC, at which the execution completed.
+	 */
+	void executeRelease(const struct timespec &releaseTime, struct timespec &completionTime);
+
+	/**
+	 * This method will apply a period which was requested while the task was running.  It is called from the thread of the task
+	 * between executions.  A task running under SCHED_DEADLINE is readmitted with the new period.
+	 */
+	void applyRequestedPeriod();
+
+	/**
+	 * This method is called by the timer service to release the task.  It may be called while the task is still running.
+	 * @param releaseTime This is the instant, on CLOCK_MONOTONIC, of the latest release.
+	 * @param releaseCount This is the number of releases which became due, including the latest.
+	 */
+	void release(const struct timespec &releaseTime, uint32_t releaseCount);
+
+	/**
+	 * This method will run the task on the releases from the timer service until the task is stopped.  It applies the overrun
+	 * policy in the same way as computeNextRelease: when several releases are due at once, SKIP and DEGRADE run only the latest,
+	 * and CATCH_UP runs up to the catch up limit of the latest.
+	 */
+	void runServiceReleases();
+
+protected:
+	/**
+	 * This method is called when the task overruns its period and its overrun policy is DEGRADE.  Derived classes override it to
+	 * reduce the work done by each execution.  It is called from the thread of the task, between executions.
+	 * @param missedReleases This is the number of releases which were already due when the execution completed.
+	 */
+	virtual void handleOverrun(uint32_t missedReleases);
+
+	/**
+	 * This method will set the scheduling policy of the thread of the task.  If deadline scheduling is enabled, the task is run
+	 * under SCHED_DEADLINE with its period as both deadline and period.  Otherwise, or if the kernel refuses, it runs under SCHED_FIFO.
+	 */
+	virtual void configureScheduler();
+
 public:
 	/**
 	 * This is the default constructor for the class.
@@ -96,7 +308,7 @@ public:
 	virtual void taskMethod()=0;
 
 	/**
-	 * This will set the period for the given task.
+	 * This will set the period for the given task.  If the task is running, the new period takes effect from its next release.
 	 * @param period This is the period, given in microseconds, between executions of this task.
 	 * However, it must be at least 100 microseconds (.1 ms)
 	 */
@@ -108,6 +320,91 @@ public:
 	 */
 	virtual uint32_t getTaskPeriod() final;
 
+	/**
+	 * This method will set the release mode for the task.  It should be set before the task is started.
+	 * @param mode This is the mode that is to be used to compute the release of each period.
+	 */
+	virtual void setReleaseMode(ReleaseMode mode) final;
+
+	/**
+	 * This method will return the release mode for the task.
+	 * @return The release mode for the task will be returned.
+	 */
+	virtual ReleaseMode getReleaseMode() final;
+
+	/**
+	 * This method will set the overrun policy for the task.
+	 * @param policy This is the policy that is to be followed when the task overruns its period.
+	 */
+	virtual void setOverrunPolicy(OverrunPolicy policy) final;
+
+	/**
+	 * This method will return the overrun policy for the task.
+	 * @return The overrun policy for the task will be returned.
+	 */
+	virtual OverrunPolicy getOverrunPolicy() final;
+
+	/**
+	 * This method will set the largest number of late releases that the CATCH_UP policy runs back to back.
+	 * @param limit This is the maximum length of a catch up burst.  It must be at least 1.
+	 */
+	virtual void setCatchUpLimit(uint32_t limit) final;
+
+	/**
+	 * This method will select whether the task runs under SCHED_DEADLINE or SCHED_FIFO.  It must be called before the task starts.
+	 * @param enabled If this is true, the task runs under SCHED_DEADLINE.
+	 */
+	virtual void setDeadlineScheduling(bool enabled) final;
+
+	/**
+	 * This method will return the SCHED_DEADLINE runtime that is in use for the task.
+	 * @return The runtime in microseconds, or 0 if the task is not running under SCHED_DEADLINE.
+	 */
+	virtual long getDeadlineRuntime() final;
+
+	/**
+	 * This method will return the number of executions which were throttled because they used up their SCHED_DEADLINE runtime.
+	 * @return The count of budget exhaustions since the diagnostics were last reset.
+	 */
+	virtual uint32_t getBudgetExhaustionCount() final;
+
+	/**
+	 * This method will return the number of times the task has overrun its period.
+	 * @return The count of overruns since the diagnostics were last reset.
+	 */
+	virtual uint32_t getOverrunCount() final;
+
+	/**
+	 * This method will return the number of releases which have been skipped because the task was more than a full period late.
+	 * @return The count of skipped releases since the diagnostics were last reset.
+	 */
+	virtual uint32_t getSkippedReleaseCount() final;
+
+	/**
+	 * This method will return the worst case execution time measured for the task.
+	 * @return The worst case CPU time of one execution in microseconds since the diagnostics were last reset.
+	 */
+	virtual long getWorstCaseExecutionTime() final;
+
+	/**
+	 * This method will return the moving average of the execution time of the task.  Unlike the worst case, it follows the
+	 * current load, so it falls again after a burst.
+	 * @return The average CPU time of one execution in microseconds.
+	 */
+	virtual long getAverageExecutionTime() final;
+
+	/**
+	 * This method will set the execution time budget for the task.
+	 * @param budget This is the estimated worst case execution time of the task in microseconds.
+	 */
+	virtual void setWCETBudget(long budget) final;
+
+	/**
+	 * This method will return the execution time budget for the task.
+	 * @return The estimated worst case execution time of the task in microseconds.  0 if no budget has been set.
+	 */
+	virtual long getWCETBudget() final;
+
 	/**
 	 * This is the run method for the class.
 	 */
@@ -118,13 +415,23 @@ public:
 	 */
 	virtual void printInformation();
 
+	/**
+	 * This method will print out the release jitter, execution time and wall time distributions for the task.
+	 */
+	virtual void printLatencyInformation();
+
 	virtual double getCPUUsageInfo();
 
 	/**
-	 * This method will reset thread diagnostics back to their default values.  The wall times and CPU times will be set to 0.
+	 * This method will reset thread diagnostics back to their default values.  The wall times, CPU times, release jitter, overrun counts and latency histograms will be set to 0.
 	 */
 	virtual void resetThreadDiagnostics();
 
+	/**
+	 * This method will stop the task.  A task released by the timer service is woken so that it exits at once.
+	 */
+	virtual void stop();
+
 };
 
 #endif /* PERIODICTASK_H_ */
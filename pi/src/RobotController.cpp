@@ -1,5 +1,9 @@
 #include "RobotController.h"
 #include <string>
+#include <iostream>
+#include <iomanip>
+#include <time.h>
+#include "time_util.h"
 
 using namespace std;
 
@@ -7,10 +11,15 @@ RobotController::RobotController(CommandQueue * queue, string threadName) :
 RunnableClass(threadName){
 	this->referencequeue = queue;
 	this->leftFrontMotor = new MotorController(PCADEVICE_ADDR, LFMFCHANNEL, LFMRCHANNEL, threadName, MOTOR_CTRL_TASK_PERIOD);
+	this->leftFrontMotor->setWCETBudget(MOTOR_CTRL_TASK_WCET_BUDGET);
 	this->leftRearMotor = new MotorController(PCADEVICE_ADDR, LRMFCHANNEL, LRMRCHANNEL, threadName, MOTOR_CTRL_TASK_PERIOD);
+	this->leftRearMotor->setWCETBudget(MOTOR_CTRL_TASK_WCET_BUDGET);
 	this->rightFrontMotor = new MotorController(PCADEVICE_ADDR, RFMFCHANNEL, RFMRCHANNEL, threadName, MOTOR_CTRL_TASK_PERIOD);
+	this->rightFrontMotor->setWCETBudget(MOTOR_CTRL_TASK_WCET_BUDGET);
 	this->rightRearMotor = new MotorController(PCADEVICE_ADDR, RRMFCHANNEL, RRMRCHANNEL, threadName, MOTOR_CTRL_TASK_PERIOD);
+	this->rightRearMotor->setWCETBudget(MOTOR_CTRL_TASK_WCET_BUDGET);
 	processSpeedControlCommand(50);
+	eventLoop.addBatchQueue(referencequeue, [this](const CommandEnvelope *commands, uint32_t count) { processCommands(commands, count); });
 }
 
 RobotController::RobotController(CommandQueue* queue, CommandQueue* hornQueue, std::string threadName) :
@@ -18,34 +27,135 @@ RunnableClass(threadName){
 	this->referencequeue = queue;
 	this->hornQueue = hornQueue;
 	this->leftFrontMotor = new MotorController(PCADEVICE_ADDR, LFMFCHANNEL, LFMRCHANNEL, threadName, MOTOR_CTRL_TASK_PERIOD);
+	this->leftFrontMotor->setWCETBudget(MOTOR_CTRL_TASK_WCET_BUDGET);
 	this->leftRearMotor = new MotorController(PCADEVICE_ADDR, LRMFCHANNEL, LRMRCHANNEL, threadName, MOTOR_CTRL_TASK_PERIOD);
+	this->leftRearMotor->setWCETBudget(MOTOR_CTRL_TASK_WCET_BUDGET);
 	this->rightFrontMotor = new MotorController(PCADEVICE_ADDR, RFMFCHANNEL, RFMRCHANNEL, threadName, MOTOR_CTRL_TASK_PERIOD);
+	this->rightFrontMotor->setWCETBudget(MOTOR_CTRL_TASK_WCET_BUDGET);
 	this->rightRearMotor = new MotorController(PCADEVICE_ADDR, RRMFCHANNEL, RRMRCHANNEL, threadName, MOTOR_CTRL_TASK_PERIOD);
+	this->rightRearMotor->setWCETBudget(MOTOR_CTRL_TASK_WCET_BUDGET);
 	processSpeedControlCommand(50);
+	eventLoop.addBatchQueue(referencequeue, [this](const CommandEnvelope *commands, uint32_t count) { processCommands(commands, count); });
+}
+
+void RobotController::addMotorsToExecutive(CyclicExecutive *executive){
+	// The motors are not started on their own, so give them their priority here.  The executive orders each frame by it.
+	this->leftFrontMotor->setPriority(MOTOR_CTRL_TASK_PRIORITY);
+	this->leftRearMotor->setPriority(MOTOR_CTRL_TASK_PRIORITY);
+	this->rightFrontMotor->setPriority(MOTOR_CTRL_TASK_PRIORITY);
+	this->rightRearMotor->setPriority(MOTOR_CTRL_TASK_PRIORITY);
+	executive->addTask(this->leftFrontMotor);
+	executive->addTask(this->leftRearMotor);
+	executive->addTask(this->rightFrontMotor);
+	executive->addTask(this->rightRearMotor);
+	this->motorsOnExecutive = true;
+}
+
+void RobotController::addMotorsToTimerService(TimerService *timerService, uint32_t phaseInUs){
+	timerService->addTask(this->leftFrontMotor, phaseInUs);
+	timerService->addTask(this->leftRearMotor, phaseInUs);
+	timerService->addTask(this->rightFrontMotor, phaseInUs);
+	timerService->addTask(this->rightRearMotor, phaseInUs);
+}
+
+void RobotController::startChildRunnables(){
+	if (this->motorsOnExecutive) {
+		// The executive releases the motors, so there are no threads to start.
+		return;
+	}
+	this->leftFrontMotor->start(MOTOR_CTRL_TASK_PRIORITY, MOTOR_CTRL_TASK_CORES, MOTOR_CTRL_TASK_STACK_SIZE);
+	this->leftRearMotor->start(MOTOR_CTRL_TASK_PRIORITY, MOTOR_CTRL_TASK_CORES, MOTOR_CTRL_TASK_STACK_SIZE);
+	this->rightFrontMotor->start(MOTOR_CTRL_TASK_PRIORITY, MOTOR_CTRL_TASK_CORES, MOTOR_CTRL_TASK_STACK_SIZE);
+	this->rightRearMotor->start(MOTOR_CTRL_TASK_PRIORITY, MOTOR_CTRL_TASK_CORES, MOTOR_CTRL_TASK_STACK_SIZE);
+}
+
+void RobotController::setAcknowledgementManager(NetworkTransmissionManager *transmissionManager){
+	this->acknowledgementManager = transmissionManager;
+}
+
+void RobotController::printLatencyInformation(){
+	std::cout << myOSThreadID << "\t" << std::setw(18) << myName << "\t Queueing   \t";
+	queueingDelayHistogram.printPercentiles();
+	std::cout << myOSThreadID << "\t" << std::setw(18) << myName << "\t Actuation  \t";
+	actuationDelayHistogram.printPercentiles();
+	std::cout << myOSThreadID << "\t" << std::setw(18) << myName << "\t Command    \t";
+	commandLatencyHistogram.printPercentiles();
+}
+
+void RobotController::resetThreadDiagnostics(){
+	commandLatencyHistogram.reset();
+	queueingDelayHistogram.reset();
+	actuationDelayHistogram.reset();
 }
 
 void RobotController::run(){
-	this->leftFrontMotor->start(MOTOR_CTRL_TASK_PRIORITY);
-	this->leftRearMotor->start(MOTOR_CTRL_TASK_PRIORITY);
-	this->rightFrontMotor->start(MOTOR_CTRL_TASK_PRIORITY);
-	this->rightRearMotor->start(MOTOR_CTRL_TASK_PRIORITY);
-	while(keepGoing){
-		if (this->referencequeue->hasItem()) {
-			int command = this->referencequeue->dequeue();
-			this->currentOperation = command & 0xf0000000;
-			int commandVal = command & 0xfff;
-
-			if (currentOperation == 0x20000000) {
-				processMotionControlCommand(commandVal);
-			} else if (currentOperation == 0x40000000) {
-				processSpeedControlCommand(commandVal);
-			} else if (currentOperation == 0x10000000) {
-				processSteeringControlCommand(commandVal);
+	// Block until commands arrive, rather than spinning on the queue.  stop() wakes the loop.
+	eventLoop.run();
+}
+
+void RobotController::processCommand(const CommandEnvelope &command){
+	this->currentOperation = command.opcode;
+	int commandVal = command.getValue();
+
+	if (currentOperation == 0x20000000) {
+		processMotionControlCommand(commandVal);
+	} else if (currentOperation == 0x40000000) {
+		processSpeedControlCommand(commandVal);
+	} else if (currentOperation == 0x10000000) {
+		processSteeringControlCommand(commandVal);
+	}
+}
+
+void RobotController::processCommands(const CommandEnvelope *commands, uint32_t count){
+	/**
+	 * 1.0 Walk the burst backwards, keeping the first command of each type seen, which is the last one enqueued.
+	 */
+	bool superseded[COMMAND_QUEUE_BATCH] = { false };
+	uint32_t seenTypes = 0;
+	for (uint32_t index = count; index > 0; index--) {
+		uint32_t typeBit = 1U << (commands[index - 1].opcode >> COMMAND_QUEUE_TYPE_SHIFT);
+		superseded[index - 1] = (seenTypes & typeBit) != 0;
+		seenTypes |= typeBit;
+	}
+
+	/**
+	 * 2.0 Process the commands that remain in their original order, timing each from when it entered the robot.
+	 */
+	int64_t dequeuedAt = monotonic_timestamp_us();
+	for (uint32_t index = 0; index < count; index++) {
+		if (!superseded[index]) {
+			int64_t receivedAt = (int64_t) (commands[index].originTimestamp / 1000);
+			processCommand(commands[index]);
+			int64_t appliedAt = monotonic_timestamp_us();
+			queueingDelayHistogram.recordValue(dequeuedAt - receivedAt);
+			actuationDelayHistogram.recordValue(appliedAt - dequeuedAt);
+			commandLatencyHistogram.recordValue(appliedAt - receivedAt);
+
+			/**
+			 * 2.1 Acknowledge a command from the network, so that the sender can measure the whole delay.
+			 */
+			if ((acknowledgementManager != NULL) && (commands[index].source == SOURCE_NETWORK)) {
+				acknowledgeCommand(commands[index], appliedAt);
 			}
 		}
 	}
 }
 
+void RobotController::acknowledgeCommand(const CommandEnvelope &command, int64_t appliedAt){
+	int64_t receivedAt = monotonic_to_synchronized_ms(command.originTimestamp);
+
+	networkMessageStruct ack = networkMessageStruct();
+	ack.messageID = (int32_t) command.sequenceNumber;
+	ack.timestampHigh = (int32_t) (receivedAt >> 32);
+	ack.timestampLow = (int32_t) receivedAt;
+	ack.messageType = ACK_MSG_TYPE;
+	ack.messageDestination = MOTOR_CONTROL_DESTINATION;
+	ack.message = (int32_t) (appliedAt - (int64_t) (command.originTimestamp / 1000));
+	ack.xorChecksum = ack.messageID ^ ack.timestampHigh ^ ack.timestampLow ^ ack.messageType ^ ack.message
+			^ ack.messageDestination;
+	acknowledgementManager->enqueueMessage(ack);
+}
+
 int RobotController::processMotionControlCommand(int value) {
 	switch (value) {
 	case 0x1:
@@ -161,6 +271,7 @@ void RobotController::processSteeringControlCommand(int value){
 
 void RobotController::stop(){
 	RunnableClass::stop();
+	eventLoop.stop();
 	this->leftFrontMotor->stop();
 	this->rightFrontMotor->stop();
 	this->leftRearMotor->stop();
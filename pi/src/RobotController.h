@@ -33,9 +33,16 @@
 #include "CommandQueue.h"
 #include "MotorController.h"
 #include "RunnableClass.h"
+#include "EventLoop.h"
+#include "LatencyHistogram.h"
+#include "NetworkTransmissionManager.h"
+#include "CyclicExecutive.h"
+#include "TimerService.h"
 #include "labcfg.h"
 #include "RobotCfg.h"
 #include "TaskRates.h"
+#include "TaskCores.h"
+#include "TaskStacks.h"
 #include "NetworkCommands.h"
 
 using namespace se3910RPi;
@@ -72,6 +79,11 @@ protected:
 	 */
 	MotorController* rightRearMotor;
 
+	/**
+	 * This variable will be true if the motor controllers are run by a cyclic executive rather than on their own threads.
+	 */
+	bool motorsOnExecutive = false;
+
 	/**
 	 * This is the current speed for the robot.  It can vary between 0 and 1000.  It represents the basic PWM value for the robot to the nearest .1%.
 	 */
@@ -90,6 +102,53 @@ protected:
 	 */
 	int currentOperation=0;
 
+	/**
+	 * This is the event loop which the thread of the controller blocks on.  It wakes as soon as a command is enqueued.
+	 */
+	EventLoop eventLoop;
+
+	/**
+	 * This is the distribution of the time from when a command entered the robot until the controller applied it, in microseconds.
+	 */
+	LatencyHistogram commandLatencyHistogram;
+
+	/**
+	 * This is the distribution of the time from when a command entered the robot until the controller dequeued it, in microseconds.
+	 */
+	LatencyHistogram queueingDelayHistogram;
+
+	/**
+	 * This is the distribution of the time from when the controller dequeued a command until it had applied it, in microseconds.
+	 */
+	LatencyHistogram actuationDelayHistogram;
+
+	/**
+	 * This is the transmission manager which acknowledges commands from the network once they are applied, or NULL if they are
+	 * not acknowledged.
+	 */
+	NetworkTransmissionManager* acknowledgementManager = NULL;
+
+	/**
+	 * This method will send the acknowledgement of a command from the network.
+	 * @param command This is the command that was applied.
+	 * @param appliedAt This is when the command was applied on CLOCK_MONOTONIC, in microseconds.
+	 */
+	void acknowledgeCommand(const CommandEnvelope &command, int64_t appliedAt);
+
+	/**
+	 * This method will process one command from the command queue.
+	 * @param command This is the command that was dequeued.
+	 */
+	void processCommand(const CommandEnvelope &command);
+
+	/**
+	 * This method will process a burst of commands from the command queue.  Only the last command of each type in the burst is
+	 * processed, since it overrides the earlier ones, so the motors are only updated once for each type.
+	 * @param commands This is the array of commands, in the order they were dequeued.
+	 * @param count This is the number of commands in the array.  It is at most COMMAND_QUEUE_BATCH.
+	 */
+	void processCommands(const CommandEnvelope *commands, uint32_t count);
+
 	/**
 	 * This method will process a command that is related to motion control.
 	 * @param value This is the command that was received.
@@ -103,7 +162,7 @@ protected:
 	 * parameter passed in.
 	 * @param value This is the command that was received.  It is expected to be a value between 0 and 1000 (inclusive).
 	 */
-	void processSpeedControlCommand(int value);
+	virtual void processSpeedControlCommand(int value);
 
 	/**
 	 * This method will process a command that is related to steering control.
@@ -142,10 +201,50 @@ public:
 	virtual ~RobotController();
 
 	/**
-	 * This is the run method for the class.  It contains the code that is to run periodically on the given thread.
+	 * This method will hand the four motor controllers to a cyclic executive, so that they are not started on their own threads.
+	 * It must be called before the robot controller is started.
+	 * @param executive This is the executive which is to run the motor controllers.
+	 */
+	void addMotorsToExecutive(CyclicExecutive *executive);
+
+	/**
+	 * This method will have the four motor controllers released by a timer service rather than sleeping on their own.  It must be
+	 * called before the robot controller is started.
+	 * @param timerService This is the timer service which is to release the motor controllers.
+	 * @param phaseInUs This is the phase offset of the motor controllers, in microseconds.
+	 */
+	void addMotorsToTimerService(TimerService *timerService, uint32_t phaseInUs);
+
+	/**
+	 * This method will have each command from the network acknowledged once it has been applied, with an ACK_MSG_TYPE message
+	 * which carries when the command was received and how long it took to apply.  A command which is superseded by a newer one
+	 * of the same type before it is applied is not acknowledged.
+	 * @param transmissionManager This is the transmission manager which sends the acknowledgements.
+	 */
+	void setAcknowledgementManager(NetworkTransmissionManager *transmissionManager);
+
+	/**
+	 * This method will start the threads for the four motor controllers, unless they are run by a cyclic executive.  It is
+	 * called by start before the thread of the controller is created.
+	 */
+	virtual void startChildRunnables();
+
+	/**
+	 * This is the run method for the class.  It blocks on the command queue and processes each command as it arrives.
 	 */
 	void run();
 
+	/**
+	 * This method will print the distributions of the time from when a command entered the robot until the controller dequeued
+	 * it, from then until the controller applied it, and the two together.
+	 */
+	virtual void printLatencyInformation();
+
+	/**
+	 * This method will reset the command latency distributions.
+	 */
+	virtual void resetThreadDiagnostics();
+
 	/**
 	 * this method will stop the thread and its execution, as well as the robot.
 	 */
@@ -8,6 +8,7 @@
 #include "RobotStatusManager.h"
 #include "NetworkMessage.h"
 #include "NetworkCommands.h"
+#include "time_util.h"
 
 namespace se3910RPi {
 
@@ -34,9 +35,12 @@ namespace se3910RPi {
 		dsi->resetDistanceRanges();
 
 		/**
-		 * 2.0 Now populate an instance of the network message structure for current distance.  The destination device is 1.  The message is the current distance ored with the appropriate message parameter.
+		 * 2.0 Now populate an instance of the network message structure for current distance.  The destination device is 1.  The message is the current distance ored with the appropriate message parameter.  The timestamp is the synchronized time of the readings, and it is shared by all four reports.
 		 */
-		networkMessageStruct nms;
+		networkMessageStruct nms = networkMessageStruct();
+		int64_t now = synchronized_timestamp();
+		nms.timestampHigh = (int32_t) (now >> 32);
+		nms.timestampLow = (int32_t) now;
 		nms.messageDestination=1;
 		nms.message = DISTANCE_MEASUREMENT_REPORT | DISTANCE_MEASUREMENT_REPORT_CURRENTREADINGBITMAP | currentDistance;
 		nms.xorChecksum = nms.message ^ nms.messageDestination;
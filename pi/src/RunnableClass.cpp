@@ -28,19 +28,87 @@
  */
 
 #include "RunnableClass.h"
+#include "TaskStacks.h"
+#include "Trace.h"
 #include <thread>
 #include <string>
 #include <iostream>
 #include <iomanip>
+#include <fstream>
+#include <sstream>
 #include <sys/types.h>
 #include <unistd.h>
 #include <sys/syscall.h>
+#include <pthread.h>
+#include <sched.h>
+#include <limits.h>
+#include <errno.h>
+#include <string.h>
+#include <alloca.h>
+#include <malloc.h>
+#include <sys/mman.h>
+
+#ifndef SCHED_DEADLINE
+#define SCHED_DEADLINE (6)
+#endif
 
 /*
  * This is a file scopes variable which holds a list of the threads that are running.
  */
 std::list<RunnableClass*> RunnableClass::runningThreads;
 
+/*
+ * This variable is true once the real time memory mode has been enabled.
+ */
+bool RunnableClass::realTimeMemoryMode = false;
+
+/**
+ * This method will read the core that a thread last ran on.  This is field 39 of /proc/self/task/<tid>/stat.
+ * @param tid This is the thread id of the thread.
+ * @return The return will be the core number, or -1 if it can not be read.
+ */
+static int readCurrentCPU(pid_t tid) {
+	std::ifstream statFile("/proc/self/task/" + std::to_string(tid) + "/stat");
+	std::string line;
+	if (!std::getline(statFile, line)) {
+		return -1;
+	}
+
+	// The thread name (field 2) may contain spaces, so start counting after its closing parenthesis, which is field 3.
+	size_t nameEnd = line.rfind(')');
+	if (nameEnd == std::string::npos) {
+		return -1;
+	}
+	std::istringstream fields(line.substr(nameEnd + 1));
+	std::string field;
+	for (int index = 3; index <= 39; index++) {
+		if (!(fields >> field)) {
+			return -1;
+		}
+	}
+	return std::stoi(field);
+}
+
+/**
+ * This method will read the number of times the kernel has migrated a thread from one core to another.  This is
+ * se.nr_migrations in /proc/self/task/<tid>/sched, which is only present if the kernel has scheduler debugging enabled.
+ * @param tid This is the thread id of the thread.
+ * @return The return will be the migration count, or -1 if it can not be read.
+ */
+static long readMigrationCount(pid_t tid) {
+	std::ifstream schedFile("/proc/self/task/" + std::to_string(tid) + "/sched");
+	std::string line;
+	while (std::getline(schedFile, line)) {
+		if (line.compare(0, 16, "se.nr_migrations") == 0) {
+			size_t separator = line.find(':');
+			if (separator != std::string::npos) {
+				return std::stol(line.substr(separator + 1));
+			}
+		}
+	}
+	return -1;
+}
+
 /**
  * This is the default constructor for the class.
  * @param threadName This is the name of the thread in a human readable format.
@@ -73,7 +141,7 @@ void RunnableClass::printThreads() {
 	std::cout
 			<< "===============================================================================================\nThread Diagnostic Information:\n";
 	// Print the header out
-	std::cout << "Thread\tTask              \tPrio.\tperiod(us)\tLast Execution(us)\tWCET(us)\tLast Wall Time(us)\tWCWT(us)\tCPU Usage\n";
+	std::cout << "Thread\tTask              \tPrio.\tperiod(us)\tLast Execution(us)\tWCET(us)\tJitter(us)\tWC Jitter(us)\tLast Wall Time(us)\tWCWT(us)\tOverruns\tSkipped\tThrottled\tCPU Usage\n";
 	double totalCPUUsage = 0.0;
 	for (std::list<RunnableClass*>::iterator it = runningThreads.begin();
 			it != runningThreads.end(); it++) {
@@ -82,6 +150,20 @@ void RunnableClass::printThreads() {
 		totalCPUUsage += rc->getCPUUsageInfo();
 	}
 	std::cout<< "Total CPU Usage: "<< std::fixed << std::setprecision(3) << totalCPUUsage << "\n";
+	std::cout<< "-----------------------------------------------------------------------------------------------\nCPU Placement and Stack Usage:\n";
+	std::cout << "Thread\tTask              \tAffinity\tCurrent CPU\tMigrations\tStack(KB)\tStack HWM(KB)\n";
+	for (std::list<RunnableClass*>::iterator it = runningThreads.begin();
+			it != runningThreads.end(); it++) {
+		RunnableClass *rc = *it;
+		rc->printResourceInformation();
+	}
+	std::cout<< "-----------------------------------------------------------------------------------------------\nLatency Percentiles (us):\n";
+	std::cout << "Thread\tTask              \tMeasurement \t     Count\t      p50\t      p90\t      p99\t    p99.9\t      Max\n";
+	for (std::list<RunnableClass*>::iterator it = runningThreads.begin();
+			it != runningThreads.end(); it++) {
+		RunnableClass *rc = *it;
+		rc->printLatencyInformation();
+	}
 	std::cout<< "===============================================================================================\n";
 
 }
@@ -124,44 +206,186 @@ void RunnableClass::printInformation() {
 			<< std::setw(5) << getPriority() << "\n ";
 }
 
+/**
+ * This method will enable the real time memory mode.  All current and future pages of the process are locked into memory,
+ * the heap is never returned to the operating system, and each thread started afterwards gets a sized, pre-faulted stack.
+ * It must be called before any thread is started.
+ * @return The return will be true if the memory could be locked.  False otherwise.
+ */
+bool RunnableClass::enableRealTimeMemoryMode() {
+	// Keep freed heap memory in the process and never satisfy malloc with a fresh mmap, as either would page fault later.
+	mallopt(M_TRIM_THRESHOLD, -1);
+	mallopt(M_MMAP_MAX, 0);
+
+	// Sized and pre-faulted stacks are still worthwhile if the memory can not be locked, so the mode is enabled either way.
+	realTimeMemoryMode = true;
+
+	if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+		printf("Failed to lock memory: %s\n", strerror(errno));
+		return false;
+	}
+	return true;
+}
+
+/**
+ * This method will print out the cores the given thread may run on, the core it last ran on, the number of
+ * times the kernel has migrated it between cores and how much of its stack it has used.
+ */
+void RunnableClass::printResourceInformation() {
+	std::cout << myOSThreadID << "\t" << std::setw(18) << myName << "\t ";
+	std::ostringstream affinity;
+	if (coreMask == 0) {
+		affinity << "all";
+	} else {
+		affinity << "0x" << std::hex << coreMask;
+	}
+	std::cout << std::setw(8) << affinity.str();
+
+	if (myOSThreadID == 0) {
+		// The thread has not started, so there is nothing to read from the kernel.
+		std::cout << "\t " << std::setw(11) << "-" << "\t " << std::setw(10) << "-" << "\t " << std::setw(9)
+				<< "-" << "\t " << std::setw(13) << "-" << "\n";
+		return;
+	}
+
+	int cpu = readCurrentCPU(myOSThreadID);
+	long migrations = readMigrationCount(myOSThreadID);
+	std::cout << "\t " << std::setw(11);
+	if (cpu >= 0) {
+		std::cout << cpu;
+	} else {
+		std::cout << "n/a";
+	}
+	std::cout << "\t " << std::setw(10);
+	if (migrations >= 0) {
+		std::cout << migrations;
+	} else {
+		std::cout << "n/a";
+	}
+
+	long highWaterMark = getStackHighWaterMark();
+	std::cout << "\t " << std::setw(9);
+	if (stackSize > 0) {
+		std::cout << stackSize / 1024;
+	} else {
+		std::cout << "default";
+	}
+	std::cout << "\t " << std::setw(13);
+	if (highWaterMark >= 0) {
+		std::cout << highWaterMark / 1024;
+	} else {
+		std::cout << "n/a";
+	}
+	std::cout << "\n";
+}
+
+/**
+ * This method will touch every page of the stack of the calling thread so that it is mapped before the thread does any
+ * real time work, filling it with a known pattern so that the high water mark can be found later.
+ */
+void RunnableClass::prefaultStack() {
+	pthread_attr_t attributes;
+	void *stackBottom;
+	size_t size;
+
+	// 1.0 Find the bounds of the stack of this thread.
+	if (pthread_getattr_np(pthread_self(), &attributes) != 0) {
+		return;
+	}
+	pthread_attr_getstack(&attributes, &stackBottom, &size);
+	pthread_attr_destroy(&attributes);
+
+	// 2.0 Everything between the bottom of the stack and this frame is unused.  Leave a margin for the frame of memset.
+	unsigned char marker;
+	unsigned char *bottom = static_cast<unsigned char*>(stackBottom);
+	if (&marker - bottom <= STACK_PAINT_MARGIN) {
+		return;
+	}
+	size_t paintLength = (&marker - bottom) - STACK_PAINT_MARGIN;
+
+	// 3.0 Claim the unused part of the stack and write the pattern over it, which faults in every page.
+	unsigned char *paint = static_cast<unsigned char*>(alloca(paintLength));
+	memset(paint, STACK_PAINT_PATTERN, paintLength);
+
+	// Nothing reads the painted block in this function, so stop the compiler from discarding the memset.
+	asm volatile("" : : "r"(paint) : "memory");
+
+	paintedStackBottom = paint;
+	stackTop = bottom + size;
+}
+
+/**
+ * This method will determine how much of the stack of the thread has been used since it was painted.
+ * @return The return will be the number of bytes of the stack that have been written, or -1 if the stack was not painted.
+ */
+long RunnableClass::getStackHighWaterMark() {
+	if (paintedStackBottom == NULL) {
+		return -1;
+	}
+
+	// The stack grows down, so the lowest byte that no longer holds the pattern is the deepest the thread has reached.
+	unsigned char *current = paintedStackBottom;
+	while (current < stackTop && *current == STACK_PAINT_PATTERN) {
+		current++;
+	}
+	return stackTop - current;
+}
+
+/**
+ * This method will print out the latency distribution for the given thread.  Threads which do not keep latency
+ * histograms print nothing.
+ */
+void RunnableClass::printLatencyInformation() {
+	// A simple runnable class does not keep latency histograms.
+}
+
 /*
  * This is the default destructor for the class.  It must properly clean up the instantiated thread.
  */
 RunnableClass::~RunnableClass() {
 	/**
-	 * If the thread is not NULL, delete it.
+	 * If the thread was never joined, detach it so that its resources are released when it ends.
 	 */
-	if (myThread != NULL) {
-		delete myThread;
+	if (threadCreated) {
+		pthread_detach(myThread);
 	}
 }
 
+/**
+ * This is the entry point of the thread created by start.  It will call invokeRunMethod on the runnable class.
+ * @param runnable This is the runnable class whose thread is starting.
+ * @return The return is always NULL.
+ */
+void *RunnableClass::threadEntryPoint(void *runnable) {
+	static_cast<RunnableClass*>(runnable)->invokeRunMethod();
+	return NULL;
+}
+
 /**
  * This private method initializes the runnable class.  It is actually the method invoked when the thread starts.
  */
 void RunnableClass::invokeRunMethod() {
-	// Setup the operating thread to be a real time thread.
-	struct sched_param p;
-
 	runStarted = true;
 	runCompleted = false;
 
-	if (priority > 0) {
+	// Setup the operating thread to be a real time thread.
+	configureScheduler();
 
-		if (priority > sched_get_priority_max(SCHED_FIFO)) {
-			p.__sched_priority = sched_get_priority_max(SCHED_FIFO);
-		} else {
-			p.__sched_priority = priority;
-		}
+	// Restrict the thread to its cores before it does any work, so that it never runs anywhere else.
+	applyCPUAffinity();
 
-		if (sched_setscheduler(0, SCHED_FIFO, &p) != 0) {
-			printf("Failed to set the scheduler\n");
-		}
+	// Map the whole stack now rather than on the first deep call inside the real time loop.
+	if (realTimeMemoryMode) {
+		prefaultStack();
 	}
 
 	// Obtain the thread id by making a system call.
 	myOSThreadID = syscall(SYS_gettid);
 
+	// Name the thread after the runnable, so that it is labeled in top and in traces.  Linux allows 15 characters.
+	pthread_setname_np(pthread_self(), myName.substr(0, 15).c_str());
+	Trace::registerThread();
+
 	// Now invoke the run method,
 	this->run();
 
@@ -170,6 +394,26 @@ void RunnableClass::invokeRunMethod() {
 	runStarted = false;
 }
 
+/**
+ * This method will set the scheduling policy of the calling thread.  By default, the thread is run under SCHED_FIFO at its priority.
+ */
+void RunnableClass::configureScheduler() {
+	struct sched_param p;
+
+	if (priority > 0) {
+
+		if (priority > sched_get_priority_max(SCHED_FIFO)) {
+			p.__sched_priority = sched_get_priority_max(SCHED_FIFO);
+		} else {
+			p.__sched_priority = priority;
+		}
+
+		if (sched_setscheduler(0, SCHED_FIFO, &p) != 0) {
+			printf("Failed to set the scheduler\n");
+		}
+	}
+}
+
 /**
  * This virtual method is the start method.  It must be implemented in child classes.  The purpose of this method is to instantiate a new thread and invoke the run method.
  * This method will cause the task to start with the default priority.
@@ -177,7 +421,29 @@ void RunnableClass::invokeRunMethod() {
 void RunnableClass::start() {
 	keepGoing = true;
 	startChildRunnables();
-	myThread = new std::thread(&RunnableClass::invokeRunMethod, this);
+
+	pthread_attr_t attributes;
+	pthread_attr_init(&attributes);
+
+	// Size the stack of the thread.  In the real time memory mode every stack is locked, so the 8 MB default is never used.
+	if (stackSize == 0 && realTimeMemoryMode) {
+		stackSize = DEFAULT_TASK_STACK_SIZE;
+	}
+	if (stackSize > 0) {
+		if (stackSize < (size_t) PTHREAD_STACK_MIN) {
+			stackSize = PTHREAD_STACK_MIN;
+		}
+		if (pthread_attr_setstacksize(&attributes, stackSize) != 0) {
+			printf("Failed to set the stack size\n");
+		}
+	}
+
+	if (pthread_create(&myThread, &attributes, &RunnableClass::threadEntryPoint, this) == 0) {
+		threadCreated = true;
+	} else {
+		printf("Failed to create the thread\n");
+	}
+	pthread_attr_destroy(&attributes);
 }
 
 /**
@@ -189,6 +455,49 @@ void RunnableClass::start(int priority) {
 	this->start();
 }
 
+/**
+ * This virtual method is the start method.  The purpose of this method is to instantiate a new thread and invoke the run method.
+ * @param priority This is the priority for the task.  It must be between 0 and 99, with 99 being the highest priority.
+ * @param coreMask This is the set of cores the task may run on, with bit n set for core n.  0 allows all cores.
+ */
+void RunnableClass::start(int priority, uint32_t coreMask) {
+	this->coreMask = coreMask;
+	this->start(priority);
+}
+
+/**
+ * This virtual method is the start method.  The purpose of this method is to instantiate a new thread and invoke the run method.
+ * @param priority This is the priority for the task.  It must be between 0 and 99, with 99 being the highest priority.
+ * @param coreMask This is the set of cores the task may run on, with bit n set for core n.  0 allows all cores.
+ * @param stackSize This is the stack size for the thread of the task in bytes.  0 uses the default size.
+ */
+void RunnableClass::start(int priority, uint32_t coreMask, size_t stackSize) {
+	this->stackSize = stackSize;
+	this->start(priority, coreMask);
+}
+
+/**
+ * This method will restrict the calling thread to the cores in coreMask.
+ */
+void RunnableClass::applyCPUAffinity() {
+	if (coreMask != 0 && sched_getscheduler(0) == SCHED_DEADLINE) {
+		// The kernel only admits deadline tasks whose affinity covers the whole root domain, so the mask can not be applied.
+		printf("The CPU affinity of %s is not applied, as it runs under SCHED_DEADLINE\n", myName.c_str());
+	} else if (coreMask != 0) {
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		for (int core = 0; core < 32; core++) {
+			if (coreMask & (1u << core)) {
+				CPU_SET(core, &cpus);
+			}
+		}
+
+		if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0) {
+			printf("Failed to set the CPU affinity\n");
+		}
+	}
+}
+
 /**
  * This method will start up any runnable objects which are contained within a class that implements the RUnnable interface.
  * If there are no other objects that are runnable, there is no need to override this method.  However, if a child class
@@ -233,11 +542,12 @@ bool RunnableClass::isShutdown() {
  * this method must be overridden to wait for the child method to shutdown.
  */
 void RunnableClass::waitForShutdown() {
-	if (myThread != NULL) {
+	if (threadCreated) {
 		/**
 		 * Join the thread and wait for shutdown.
 		 */
-		myThread->join();
+		pthread_join(myThread, NULL);
+		threadCreated = false;
 	}
 }
 
@@ -258,3 +568,27 @@ void RunnableClass::setPriority(int priority) {
 int RunnableClass::getPriority() {
 	return this->priority;
 }
+
+/**
+ * This method will set the processor cores the given task may run on.  It must be called before the task starts.
+ * @param coreMask This is the set of cores the task may run on, with bit n set for core n.  0 allows all cores.
+ */
+void RunnableClass::setCPUAffinity(uint32_t coreMask) {
+	this->coreMask = coreMask;
+}
+
+/**
+ * This method will obtain the set of processor cores this runnable class may run on.
+ * @return The return will be the core mask, with bit n set for core n.  0 indicates all cores.
+ */
+uint32_t RunnableClass::getCPUAffinity() {
+	return this->coreMask;
+}
+
+/**
+ * This method will set the stack size of the thread for the given task.  It must be called before the task starts.
+ * @param stackSize This is the stack size for the thread of the task in bytes.  0 uses the default size.
+ */
+void RunnableClass::setStackSize(size_t stackSize) {
+	this->stackSize = stackSize;
+}
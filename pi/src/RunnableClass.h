@@ -33,12 +33,33 @@
 #include <thread>
 #include <string>
 #include <list>
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
 #include <sys/types.h>
 
+/**
+ * This is the byte pattern written over the unused part of a thread stack when it is pre-faulted.  Bytes which no longer
+ * hold it have been used by the thread.
+ */
+#define STACK_PAINT_PATTERN (0xA5)
+
+/**
+ * This is the number of bytes just above the bottom of a stack which are left unpainted, so that the painting itself never
+ * runs into the guard page.
+ */
+#define STACK_PAINT_MARGIN (4096)
+
 /**
  * This is the runnable class, which mimics the runnable interface from Java.  It is a virtual class which should not directly be instantiated.
  */
 class RunnableClass {
+	/**
+	 * The schedulability analyzer and the elastic manager walk the list of running threads to build their models of the task set.
+	 */
+	friend class SchedulabilityAnalyzer;
+	friend class ElasticManager;
+
 protected:
 	/**
 	 * This is a list of all of the running threads which have been started by this set of libraries.
@@ -46,9 +67,14 @@ protected:
 	static std::list<RunnableClass*> runningThreads;
 
 	/**
-	 * This is the instance of the thread that is to be executed by this class.  AT instantiation it is NULL.  It will be instantiated when the start method of the class is invoked.
+	 * This is the instance of the thread that is to be executed by this class.  It is only valid once threadCreated is true, which happens when the start method of the class is invoked.
+	 */
+	pthread_t myThread;
+
+	/**
+	 * This variable will determine whether or not myThread has been created and not yet joined.
 	 */
-	std::thread *myThread = NULL;
+	bool threadCreated = false;
 
 	/**
 	 * This is the thread id (tid) for this task.
@@ -81,12 +107,72 @@ protected:
 	 */
 	bool runStarted = false;
 
+	/**
+	 * This is the set of processor cores the thread may run on, with bit n set for core n.  A value of 0 indicates no
+	 * change in the affinity and to use the default setup.  It is applied when the thread starts.
+	 */
+	uint32_t coreMask = 0;
+
+	/**
+	 * This is the stack size of the thread in bytes.  A value of 0 indicates the default size, which is DEFAULT_TASK_STACK_SIZE
+	 * in the real time memory mode and the C library default otherwise.  It must be set before the class starts.
+	 */
+	size_t stackSize = 0;
+
+	/**
+	 * These are the lowest address of the part of the stack that was painted when the thread started, and the address just
+	 * above the top of the stack.  They are NULL if the stack was not painted.
+	 */
+	unsigned char *paintedStackBottom = NULL;
+	unsigned char *stackTop = NULL;
+
+	/**
+	 * This method will print out the cores the given thread may run on, the core it last ran on, the number of
+	 * times the kernel has migrated it between cores and how much of its stack it has used.
+	 */
+	void printResourceInformation();
+
+	/**
+	 * This method will set the scheduling policy of the calling thread.  It is called on the new thread before the run method.
+	 * By default, the thread is run under SCHED_FIFO at its priority.  Derived classes may override it to use another policy.
+	 */
+	virtual void configureScheduler();
+
 private:
+	/**
+	 * This variable is true once the real time memory mode has been enabled.
+	 */
+	static bool realTimeMemoryMode;
+
+	/**
+	 * This is the entry point of the thread created by start.  It will call invokeRunMethod on the runnable class.
+	 * @param runnable This is the runnable class whose thread is starting.
+	 * @return The return is always NULL.
+	 */
+	static void *threadEntryPoint(void *runnable);
+
 	/**
 	 * This private method initializes the runnable class.  It is actually the method invoked when the thread starts, and it will ultimately call the Run method.
 	 */
 	virtual void invokeRunMethod() final;
 
+	/**
+	 * This method will restrict the calling thread to the cores in coreMask.
+	 */
+	void applyCPUAffinity();
+
+	/**
+	 * This method will touch every page of the stack of the calling thread so that it is mapped before the thread does any
+	 * real time work, filling it with a known pattern so that the high water mark can be found later.
+	 */
+	void prefaultStack();
+
+	/**
+	 * This method will determine how much of the stack of the thread has been used since it was painted.
+	 * @return The return will be the number of bytes of the stack that have been written, or -1 if the stack was not painted.
+	 */
+	long getStackHighWaterMark();
+
 public:
 	/**
 	 * This method will print out to the console each of the running threads and their thread ID's.
@@ -99,6 +185,14 @@ public:
 	 */
 	static void resetAllThreadInformation();
 
+	/**
+	 * This method will enable the real time memory mode.  All current and future pages of the process are locked into memory,
+	 * the heap is never returned to the operating system, and each thread started afterwards gets a sized, pre-faulted stack.
+	 * It must be called before any thread is started.
+	 * @return The return will be true if the memory could be locked.  False otherwise.
+	 */
+	static bool enableRealTimeMemoryMode();
+
 	/**
 	 * This method will reset thread diagnostics back to their default values.
 	 */
@@ -109,6 +203,12 @@ public:
 	 */
 	virtual void printInformation();
 
+	/**
+	 * This method will print out the latency distribution for the given thread.  Threads which do not keep latency
+	 * histograms print nothing.
+	 */
+	virtual void printLatencyInformation();
+
 	/**
 	 * This method will return the CPU usage for the given task.  The usage will be as a percentage value.
 	 */
@@ -143,6 +243,38 @@ public:
 	 */
 	virtual void start(int priority) final;
 
+	/**
+	 * This virtual method is the start method.  The purpose of this method is to instantiate a new thread and invoke the run method.
+	 * @param priority This is the priority for the task.  It must be between 0 and 99, with 99 being the highest priority.
+	 * @param coreMask This is the set of cores the task may run on, with bit n set for core n.  0 allows all cores.
+	 */
+	virtual void start(int priority, uint32_t coreMask) final;
+
+	/**
+	 * This virtual method is the start method.  The purpose of this method is to instantiate a new thread and invoke the run method.
+	 * @param priority This is the priority for the task.  It must be between 0 and 99, with 99 being the highest priority.
+	 * @param coreMask This is the set of cores the task may run on, with bit n set for core n.  0 allows all cores.
+	 * @param stackSize This is the stack size for the thread of the task in bytes.  0 uses the default size.
+	 */
+	virtual void start(int priority, uint32_t coreMask, size_t stackSize) final;
+
+	/**
+	 * This method will set the stack size of the thread for the given task.  It must be called before the task starts.
+	 * @param stackSize This is the stack size for the thread of the task in bytes.  0 uses the default size.
+	 */
+	virtual void setStackSize(size_t stackSize) final;
+
+	/**
+	 * This method will set the processor cores the given task may run on.  It must be called before the task starts.
+	 * @param coreMask This is the set of cores the task may run on, with bit n set for core n.  0 allows all cores.
+	 */
+	virtual void setCPUAffinity(uint32_t coreMask) final;
+
+	/**
+	 * This method will obtain the set of processor cores this runnable class may run on.
+	 * @return The return will be the core mask, with bit n set for core n.  0 indicates all cores.
+	 */
+	virtual uint32_t getCPUAffinity() final;
 
 	/**
 	 * This method will set the priority for the given task, using the real time FIFO scheduler as well as setting the priority.
@@ -0,0 +1,217 @@
+/**
+ * @file SchedulabilityAnalyzer.cpp
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ *      This file implements the schedulability analyzer, which runs the Liu and Layland utilization bound and response time
+ *      analysis over the periodic tasks of the system.
+ */
+
+#include "SchedulabilityAnalyzer.h"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <cmath>
+
+/**
+ * This method will determine if one task can delay another.  That is the case if it has at least the same priority and
+ * the two may run on a common core.
+ * @param other This is the task that may cause the delay.
+ * @param task This is the task that may be delayed.
+ * @return true if other can delay task.
+ */
+bool SchedulabilityAnalyzer::canDelay(const TaskModel &other, const TaskModel &task) {
+	if (other.task == task.task || other.priority < task.priority) {
+		return false;
+	}
+	// A mask of 0 means the task may run on any core, so it shares a core with every other task.
+	return other.coreMask == 0 || task.coreMask == 0 || (other.coreMask & task.coreMask) != 0;
+}
+
+/**
+ * This method will compute the Liu and Layland utilization bound for a number of tasks, n(2^(1/n) - 1).
+ * @param taskCount This is the number of tasks.
+ * @return The bound will be returned.
+ */
+double SchedulabilityAnalyzer::liuLaylandBound(size_t taskCount) {
+	double n = (double) taskCount;
+	return n * (pow(2.0, 1.0 / n) - 1.0);
+}
+
+/**
+ * This method will run the Liu and Layland test and response time analysis for one task.
+ * @param task This is the task that is to be analyzed.  Its results are filled in.
+ * @param taskSet This is the set of all tasks that are being analyzed.
+ */
+void SchedulabilityAnalyzer::analyzeTask(TaskModel &task, const std::vector<TaskModel> &taskSet) {
+	/**
+	 * 1.0 Find the utilization of the task and every task that can delay it.  If it is within the Liu and Layland bound, the task
+	 * is guaranteed to meet its deadline.
+	 */
+	task.utilization = (double) task.executionTime / (double) task.period;
+	task.interferingTasks = 1;
+	for (std::vector<TaskModel>::const_iterator it = taskSet.begin(); it != taskSet.end(); it++) {
+		if (canDelay(*it, task)) {
+			task.utilization += (double) it->executionTime / (double) it->period;
+			task.interferingTasks++;
+		}
+	}
+
+	/**
+	 * 2.0 Iterate the response time equation R = C + sum(ceil(R / Tj) * Cj) over the tasks that can delay this one, starting from
+	 * the sum of all of their execution times.  The iteration stops when it reaches a fixed point or passes the deadline.
+	 */
+	uint64_t responseTime = task.executionTime;
+	for (std::vector<TaskModel>::const_iterator it = taskSet.begin(); it != taskSet.end(); it++) {
+		if (canDelay(*it, task)) {
+			responseTime += it->executionTime;
+		}
+	}
+
+	while (responseTime <= task.period) {
+		uint64_t nextResponseTime = task.executionTime;
+		for (std::vector<TaskModel>::const_iterator it = taskSet.begin(); it != taskSet.end(); it++) {
+			if (canDelay(*it, task)) {
+				uint64_t releases = (responseTime + it->period - 1) / it->period;
+				nextResponseTime += releases * it->executionTime;
+			}
+		}
+
+		if (nextResponseTime == responseTime) {
+			break;
+		}
+		responseTime = nextResponseTime;
+	}
+
+	task.responseTime = responseTime;
+	task.schedulable = (responseTime <= task.period);
+}
+
+/**
+ * This method will analyze the schedulability of all of the periodic tasks which have been created.
+ * @param printReport If this is true, the results for each task are printed to the console.  Otherwise, only a warning
+ * is printed, and only if a task is not schedulable.
+ * @return true if every task meets its deadline in the worst case.  False otherwise.
+ */
+bool SchedulabilityAnalyzer::analyze(bool printReport) {
+	std::vector<TaskModel> taskSet;
+	double deadlineUtilization = 0.0;
+	size_t deadlineTaskCount = 0;
+
+	/**
+	 * 1.0 Build the model of each periodic task.  The larger of the measured worst case and the budget is used, so a task that
+	 * has exceeded its budget is analyzed with what it actually took.
+	 */
+	for (std::list<RunnableClass*>::iterator it = RunnableClass::runningThreads.begin();
+			it != RunnableClass::runningThreads.end(); it++) {
+		PeriodicTask *pt = dynamic_cast<PeriodicTask*>(*it);
+		if (pt != NULL) {
+			TaskModel model;
+			model.task = pt;
+			model.priority = pt->getPriority();
+			model.coreMask = pt->getCPUAffinity();
+			model.period = pt->getTaskPeriod();
+			long measuredTime = pt->getWorstCaseExecutionTime();
+			long budget = pt->getWCETBudget();
+			model.measured = measuredTime > budget;
+			model.executionTime = (uint64_t) (model.measured ? measuredTime : budget);
+			if (pt->getDeadlineRuntime() > 0) {
+				/**
+				 * 1.1 A task running under SCHED_DEADLINE is scheduled by deadline rather than priority, so it is part of the EDF test.
+				 */
+				deadlineUtilization += (double) model.executionTime / (double) model.period;
+				deadlineTaskCount++;
+			} else {
+				taskSet.push_back(model);
+			}
+		}
+	}
+
+	/**
+	 * 2.0 Analyze each task against the others.
+	 */
+	bool schedulable = true;
+	for (std::vector<TaskModel>::iterator it = taskSet.begin(); it != taskSet.end(); it++) {
+		analyzeTask(*it, taskSet);
+		schedulable = schedulable && it->schedulable;
+	}
+
+	/**
+	 * 2.1 With deadlines equal to periods, EDF meets every deadline if the total utilization is at most 1.
+	 */
+	if (deadlineUtilization > 1.0) {
+		schedulable = false;
+	}
+
+	/**
+	 * 3.0 Report the results.
+	 */
+	if (printReport) {
+		std::cout
+				<< "===============================================================================================\nSchedulability Analysis:\n";
+		std::cout << "Task              \tPrio.\t   Cores\tperiod(us)\t   C(us)\t  Source\tTasks\tUtilization\tLL Bound\t  LL\tWCRT(us)\tSlack(us)\n";
+		for (std::vector<TaskModel>::iterator it = taskSet.begin(); it != taskSet.end(); it++) {
+			std::ostringstream cores;
+			if (it->coreMask == 0) {
+				cores << "all";
+			} else {
+				cores << "0x" << std::hex << it->coreMask;
+			}
+			double bound = liuLaylandBound(it->interferingTasks);
+
+			std::cout << std::setw(18) << it->task->myName << "\t" << std::setw(5) << it->priority << "\t"
+					<< std::setw(8) << cores.str() << "\t" << std::setw(10) << it->period << "\t" << std::setw(8)
+					<< it->executionTime << "\t" << std::setw(8) << (it->measured ? "measured" : "budget") << "\t"
+					<< std::setw(5) << it->interferingTasks << "\t" << std::fixed << std::setprecision(3)
+					<< std::setw(11) << it->utilization << "\t" << std::setw(8) << bound << "\t" << std::setw(4)
+					<< (it->utilization <= bound ? "pass" : "-") << "\t";
+			if (it->schedulable) {
+				std::cout << std::setw(8) << it->responseTime << "\t" << std::setw(9)
+						<< (it->period - it->responseTime) << "\n";
+			} else {
+				std::cout << std::setw(8) << ">" << it->period << "\t" << std::setw(9) << "MISS" << "\n";
+			}
+		}
+		if (deadlineTaskCount > 0) {
+			std::cout << "SCHED_DEADLINE tasks: " << deadlineTaskCount << "\tEDF utilization: " << std::fixed << std::setprecision(3)
+					<< deadlineUtilization << "\t" << (deadlineUtilization <= 1.0 ? "pass" : "MISS") << "\n";
+		}
+	}
+
+	if (schedulable) {
+		if (printReport) {
+			std::cout << "The task set is schedulable.\n";
+		}
+	} else {
+		std::cout << "WARNING: The task set is not schedulable.  At least one task can miss its deadline in the worst case.\n";
+		if (!printReport) {
+			for (std::vector<TaskModel>::iterator it = taskSet.begin(); it != taskSet.end(); it++) {
+				if (!it->schedulable) {
+					std::cout << "WARNING: " << it->task->myName << " can take longer than its period of " << it->period << " us.\n";
+				}
+			}
+		}
+	}
+	if (printReport) {
+		std::cout << "===============================================================================================\n";
+	}
+	return schedulable;
+}
@@ -0,0 +1,139 @@
+/**
+ * @file SchedulabilityAnalyzer.h
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ *      This file defines the schedulability analyzer.  It checks the periodic tasks that are running against fixed priority
+ *      preemptive scheduling, with each deadline equal to the period.  Two tests are run for every task.  The first is the
+ *      Liu and Layland utilization bound, which is sufficient but not necessary.  The second is exact response time analysis,
+ *      which gives the worst case response time and slack of the task.
+ *
+ *      A task is only delayed by the tasks that may run on one of its cores, as given by its CPU affinity.  Tasks of equal
+ *      priority are assumed to delay each other, which covers FIFO ordering.  Tasks run by a cyclic executive are analyzed
+ *      at their own priorities, which ignores the blocking caused by running each task to completion within its frame.
+ *      The execution time of a task is the larger of its measured worst case execution time and its budget from
+ *      TaskRates.h, so the analysis is meaningful at startup, before anything has been measured.  Threads which are not
+ *      periodic are not analyzed.
+ *
+ *      Tasks running under SCHED_DEADLINE are left out of the fixed priority analysis.  Instead, with deadlines equal to their
+ *      periods, they pass the EDF test if their total utilization is at most 1.
+ */
+
+#ifndef SCHEDULABILITYANALYZER_H_
+#define SCHEDULABILITYANALYZER_H_
+
+#include "RunnableClass.h"
+#include "PeriodicTask.h"
+#include <vector>
+#include <stdint.h>
+
+class SchedulabilityAnalyzer {
+private:
+	/**
+	 * This structure holds the parameters of one task as they are used by the analysis, along with its results.
+	 */
+	struct TaskModel {
+		/**
+		 * This is the task that is being modeled.
+		 */
+		PeriodicTask *task;
+
+		/**
+		 * This is the priority of the task.
+		 */
+		int priority;
+
+		/**
+		 * These are the cores the task may run on.  0 indicates all cores.
+		 */
+		uint32_t coreMask;
+
+		/**
+		 * This is the period, and therefore the deadline, of the task in microseconds.
+		 */
+		uint64_t period;
+
+		/**
+		 * This is the execution time used for the task in microseconds.
+		 */
+		uint64_t executionTime;
+
+		/**
+		 * This is true if the execution time came from a measurement rather than the budget.
+		 */
+		bool measured;
+
+		/**
+		 * This is the utilization of the task together with every task that can delay it.
+		 */
+		double utilization;
+
+		/**
+		 * This is the number of tasks which are included in the utilization, including the task itself.
+		 */
+		size_t interferingTasks;
+
+		/**
+		 * This is the worst case response time of the task in microseconds.  If the task is not schedulable, it is the first
+		 * value found to be beyond the deadline.
+		 */
+		uint64_t responseTime;
+
+		/**
+		 * This is true if the worst case response time is within the deadline.
+		 */
+		bool schedulable;
+	};
+
+	/**
+	 * This method will determine if one task can delay another.  That is the case if it has at least the same priority and
+	 * the two may run on a common core.
+	 * @param other This is the task that may cause the delay.
+	 * @param task This is the task that may be delayed.
+	 * @return true if other can delay task.
+	 */
+	static bool canDelay(const TaskModel &other, const TaskModel &task);
+
+	/**
+	 * This method will compute the Liu and Layland utilization bound for a number of tasks, n(2^(1/n) - 1).
+	 * @param taskCount This is the number of tasks.
+	 * @return The bound will be returned.
+	 */
+	static double liuLaylandBound(size_t taskCount);
+
+	/**
+	 * This method will run the Liu and Layland test and response time analysis for one task.
+	 * @param task This is the task that is to be analyzed.  Its results are filled in.
+	 * @param taskSet This is the set of all tasks that are being analyzed.
+	 */
+	static void analyzeTask(TaskModel &task, const std::vector<TaskModel> &taskSet);
+
+public:
+	/**
+	 * This method will analyze the schedulability of all of the periodic tasks which have been created.
+	 * @param printReport If this is true, the results for each task are printed to the console.  Otherwise, only a warning
+	 * is printed, and only if a task is not schedulable.
+	 * @return true if every task meets its deadline in the worst case.  False otherwise.
+	 */
+	static bool analyze(bool printReport);
+};
+
+#endif /* SCHEDULABILITYANALYZER_H_ */
@@ -0,0 +1,91 @@
+/**
+ * @file SchedulingCfg.h
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ * This file selects how the tasks of the robot are scheduled.
+ */
+
+#ifndef SCHEDULINGCFG_H_
+#define SCHEDULINGCFG_H_
+
+/**
+ * If this is set to 1, the short periodic tasks (the motor controllers, collision sensor, line sensor, horn and status manager)
+ * are run from a single cyclic executive thread instead of one thread each.  If it is 0, every task runs on its own thread.
+ */
+#define USE_CYCLIC_EXECUTIVE (0)
+
+/**
+ * If this is set to 1, all memory of the process is locked at startup and every thread gets a sized, pre-faulted stack from
+ * TaskStacks.h, so that no real time loop takes a page fault.  This requires the program to run as root.
+ */
+#define USE_REAL_TIME_MEMORY_MODE (1)
+
+/**
+ * If this is set to 1, periodic tasks run under SCHED_DEADLINE (earliest deadline first with a CPU budget) instead of SCHED_FIFO.
+ * Deadline tasks always run ahead of SCHED_FIFO threads, so the network threads, the robot controller and the cyclic executive
+ * then run in the time the periodic tasks leave over.  The kernel only admits deadline tasks whose affinity covers every core, so
+ * the core assignments in TaskCores.h are not applied to them.
+ */
+#define USE_SCHED_DEADLINE (0)
+
+/**
+ * This is the factor by which the execution time of a task is multiplied to give its SCHED_DEADLINE runtime.  The margin keeps a
+ * task which runs slightly over its worst case so far from being throttled.
+ */
+#define SCHED_DEADLINE_RUNTIME_MARGIN (1.25)
+
+/**
+ * This is the fraction of its period that is given as runtime to a deadline task which has neither a measured execution time nor
+ * a budget.
+ */
+#define SCHED_DEADLINE_DEFAULT_UTILIZATION (0.1)
+
+/**
+ * If this is set to 1, the periodic tasks which run on their own threads are released by the timer service, from one timerfd,
+ * at the phase offsets given in TaskRates.h.  If it is 0, each task sleeps on its own until its next release.  The timer service
+ * runs in either case, as it also times the pulses of the horn.
+ */
+#define USE_TIMER_SERVICE (1)
+
+/**
+ * If this is set to 1, an elastic manager stretches the periods of the camera, the image stream and the status manager when the
+ * cores they run on are overloaded, and shrinks them back when the load drops.  Their limits are set in TaskRates.h.
+ */
+#define USE_ELASTIC_SCHEDULING (1)
+
+/**
+ * This is the utilization, per core, that the elastic manager keeps the cores of the elastic tasks within.
+ */
+#define ELASTIC_UTILIZATION_BOUND (0.8)
+
+/**
+ * This is the largest utilization that any one elastic task is allowed, so that a task whose execution time has grown past its
+ * period is stretched even if the cores are otherwise idle.
+ */
+#define ELASTIC_MAX_TASK_UTILIZATION (0.9)
+
+/**
+ * This is the fraction by which a new period must differ from the current one before the elastic manager changes it.  It keeps
+ * periods from changing on every adjustment due to noise in the measured execution times.
+ */
+#define ELASTIC_PERIOD_HYSTERESIS (0.05)
+
+#endif /* SCHEDULINGCFG_H_ */
@@ -0,0 +1,97 @@
+/*
+ * TaskCores.h
+ *
+ * @section LICENSE
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ * This file defines which processor cores each task of the system may run on.  It is the companion to TaskRates.h.
+ * Each value is a bit mask, with bit n set if the task may run on core n.  A mask of ALL_CORES leaves the affinity
+ * of the thread untouched, so it may run on any core the kernel chooses.
+ *
+ * The Raspberry Pi has 4 cores.  The control tasks are placed on core 3.  For the best results, core 3 should be
+ * removed from the general purpose scheduler by adding "isolcpus=3 nohz_full=3 rcu_nocbs=3" to /boot/cmdline.txt,
+ * so that only the threads pinned here run on it.  The vision pipeline uses cores 1 and 2, and the network and
+ * housekeeping tasks share core 0 with the rest of Linux.
+ */
+
+#ifndef TASKCORES_H_
+#define TASKCORES_H_
+
+/**
+ * These are the core sets that the tasks are placed into.
+ */
+#define ALL_CORES (0x0)
+#define HOUSEKEEPING_CORES (0x1)
+#define VISION_CORES (0x6)
+#define CONTROL_CORES (0x8)
+
+/**
+ * This is the core assignment for the horn controller.
+ */
+#define HORN_TASK_CORES (CONTROL_CORES)
+
+/**
+ * This is the core assignment for the motor controllers.  All 4 motors on the robot run on the same cores.
+ */
+#define MOTOR_CTRL_TASK_CORES (CONTROL_CORES)
+
+/**
+ * This is the core assignment for the collision sensor.
+ */
+#define COLLISION_SENSOR_TASK_CORES (CONTROL_CORES)
+
+/**
+ * This is the core assignment for the line tracker.
+ */
+#define LINE_TRACKER_SENSOR_TASK_CORES (CONTROL_CORES)
+
+/**
+ * This is the core assignment for the distance sensor.  The GPIO callback threads it creates inherit this affinity.
+ */
+#define DISTANCE_SENSOR_TASK_CORES (CONTROL_CORES)
+
+/**
+ * These are the core assignments for the image stream and the camera.
+ */
+#define IMAGE_STREAM_TASK_CORES (VISION_CORES)
+#define CAMERA_TASK_CORES (VISION_CORES)
+
+#define ROBOT_STATUS_MANAGER_TASK_CORES (HOUSEKEEPING_CORES)
+
+/**
+ * This is the core assignment of the cyclic executive, if it is used.  It runs the control tasks.
+ */
+#define CYCLIC_EXECUTIVE_TASK_CORES (CONTROL_CORES)
+
+/**
+ * This is the core assignment of the timer service.  It wakes tasks on every core, so it is not restricted.
+ */
+#define TIMER_SERVICE_TASK_CORES (ALL_CORES)
+
+/**
+ * This is the core assignment of the elastic manager.
+ */
+#define ELASTIC_MANAGER_TASK_CORES (HOUSEKEEPING_CORES)
+
+/**
+ * Core assignments for the non periodic tasks.
+ */
+#define ROBOT_CONTROLLER_CORES (CONTROL_CORES)
+#define NETWORK_RECEPTION_TASK_CORES (HOUSEKEEPING_CORES)
+#define NETWORK_TRANSMIT_TASK_CORES (HOUSEKEEPING_CORES)
+
+#endif /* TASKCORES_H_ */
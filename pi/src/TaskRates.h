@@ -18,7 +18,17 @@
  * the grant of any rights to this Software.
  *
  * @section DESCRIPTION
- * This file defines the task rates for all periodic tasks within the system.
+ * This file defines the task rates for all periodic tasks within the system.  Each periodic task also has a WCET budget, in
+ * microseconds.  It is the designer's estimate of the worst case CPU time of one execution, and it is used by the
+ * schedulability analysis until a larger execution time has been measured.
+ *
+ * The tasks which can run more slowly under overload also have a maximum period and an elasticity.  When the elastic manager
+ * has to stretch periods, it takes utilization from each elastic task in proportion to its elasticity, and never stretches a
+ * task beyond its maximum period.  Tasks without these settings are never stretched.
+ *
+ * When the timer service releases the tasks, each task is released at its phase offset from a common start time, plus a whole
+ * number of periods.  The offsets spread out the releases of the control tasks, so that tasks with related periods do not all
+ * become ready at the same instant.
  */
 
 #ifndef TASKRATES_H_
@@ -31,45 +41,86 @@
  */
 #define HORN_TASK_PERIOD (100000)
 #define HORN_TASK_PRIORITY (10)
+#define HORN_TASK_WCET_BUDGET (200)
+#define HORN_TASK_PHASE (7000)
 
 /**
  * This macro defines the task rate for the motor controllers.  All 4 motors on the robot run at the same rate.
  */
 #define MOTOR_CTRL_TASK_PERIOD (24000)
 #define MOTOR_CTRL_TASK_PRIORITY (25)
+#define MOTOR_CTRL_TASK_WCET_BUDGET (500)
+#define MOTOR_CTRL_TASK_PHASE (1000)
 
 /**
  * This macro defines the task rate for the collision sensor.
  */
 #define COLLISION_SENSOR_TASK_PERIOD (10000)
 #define COLLISION_SENSOR_TASK_PRIORITY (35)
+#define COLLISION_SENSOR_TASK_WCET_BUDGET (200)
+#define COLLISION_SENSOR_TASK_PHASE (0)
 
 /**
  * This defined the priority for the line tracker.
  */
 #define LINE_TRACKER_SENSOR_TASK_PERIOD (50000)
 #define LINE_TRACKER_SENSOR_TASK_PRIORITY (15)
+#define LINE_TRACKER_SENSOR_TASK_WCET_BUDGET (200)
+#define LINE_TRACKER_SENSOR_TASK_PHASE (5000)
 
 /**
  * This variable defines the task rate for the distance sensor.  It senses the distance to objects.
  */
 #define DISTANCE_SENSOR_TASK_PERIOD (20000)
 #define DISTANCE_SENSOR_TASK_PRIORITY (30)
+#define DISTANCE_SENSOR_TASK_WCET_BUDGET (500)
+#define DISTANCE_SENSOR_TASK_PHASE (3000)
 
 /**
  * These variables control the Image stream.
  */
 #define IMAGE_STREAM_TASK_PERIOD ((700000/fps))
 #define IMAGE_STREAM_TASK_PRIORITY (20)
+#define IMAGE_STREAM_TASK_WCET_BUDGET (15000)
+#define IMAGE_STREAM_TASK_PHASE (0)
+#define IMAGE_STREAM_TASK_MAX_PERIOD ((IMAGE_STREAM_TASK_PERIOD)*4)
+#define IMAGE_STREAM_TASK_ELASTICITY (1.0)
 
 /**
  * These variables set up the camera task rate.
  */
 #define CAMERA_TASK_PERIOD (700000/FPS)
 #define CAMERA_TASK_PRIORITY (20)
+#define CAMERA_TASK_WCET_BUDGET (12000)
+#define CAMERA_TASK_PHASE (0)
+#define CAMERA_TASK_MAX_PERIOD ((CAMERA_TASK_PERIOD)*4)
+#define CAMERA_TASK_ELASTICITY (1.0)
 
 #define ROBOT_STATUS_MANAGER_TASK_PERIOD (150000)
 #define ROBOT_STATUS_MANAGER_TASK_PRIORITY (5)
+#define ROBOT_STATUS_MANAGER_TASK_WCET_BUDGET (1000)
+#define ROBOT_STATUS_MANAGER_TASK_PHASE (9000)
+#define ROBOT_STATUS_MANAGER_TASK_MAX_PERIOD (600000)
+#define ROBOT_STATUS_MANAGER_TASK_ELASTICITY (0.5)
+
+/**
+ * This is the task rate of the elastic manager, if it is used.  It only needs to follow changes in load, not individual releases.
+ */
+#define ELASTIC_MANAGER_TASK_PERIOD (500000)
+#define ELASTIC_MANAGER_TASK_PRIORITY (4)
+#define ELASTIC_MANAGER_TASK_WCET_BUDGET (200)
+#define ELASTIC_MANAGER_TASK_PHASE (0)
+
+/**
+ * This is the priority of the cyclic executive, if it is used.  It runs the collision sensor, so it must run at that priority.
+ */
+#define CYCLIC_EXECUTIVE_TASK_PRIORITY (COLLISION_SENSOR_TASK_PRIORITY)
+
+/**
+ * This is the priority of the timer service.  It only releases the other tasks and runs short timer functions, so it runs above
+ * all of them.
+ */
+#define TIMER_SERVICE_TASK_PRIORITY (50)
 
 /**
  * Non periodic tasks and their priorities.
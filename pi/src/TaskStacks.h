@@ -0,0 +1,95 @@
+/*
+ * TaskStacks.h
+ *
+ * @section LICENSE
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ * This file defines the stack size, in bytes, of the thread of each task within the system.  It is the companion to
+ * TaskRates.h.  Without these, every thread gets the 8 MB default of the C library, which must all be locked into
+ * memory when the real time memory mode is enabled.  The stack high water mark shown by printThreads() should be
+ * checked after a change to a task, and the size here raised if the mark comes close to it.
+ */
+
+#ifndef TASKSTACKS_H_
+#define TASKSTACKS_H_
+
+/**
+ * This is the stack size used in the real time memory mode for a thread that is started without a size of its own.
+ */
+#define DEFAULT_TASK_STACK_SIZE (256*1024)
+
+/**
+ * This is the stack size for the threads that deliver GPIO callbacks.
+ */
+#define GPIO_CALLBACK_STACK_SIZE (64*1024)
+
+/**
+ * This is the stack size for the horn controller.
+ */
+#define HORN_TASK_STACK_SIZE (64*1024)
+
+/**
+ * This is the stack size for the motor controllers.  All 4 motors on the robot use the same size.
+ */
+#define MOTOR_CTRL_TASK_STACK_SIZE (64*1024)
+
+/**
+ * This is the stack size for the collision sensor.
+ */
+#define COLLISION_SENSOR_TASK_STACK_SIZE (64*1024)
+
+/**
+ * This is the stack size for the line tracker.
+ */
+#define LINE_TRACKER_SENSOR_TASK_STACK_SIZE (64*1024)
+
+/**
+ * This is the stack size for the distance sensor.
+ */
+#define DISTANCE_SENSOR_TASK_STACK_SIZE (64*1024)
+
+/**
+ * These are the stack sizes for the image stream and the camera.  OpenCV works on the heap, but its calls nest deeply.
+ */
+#define IMAGE_STREAM_TASK_STACK_SIZE (1024*1024)
+#define CAMERA_TASK_STACK_SIZE (1024*1024)
+
+#define ROBOT_STATUS_MANAGER_TASK_STACK_SIZE (128*1024)
+
+/**
+ * This is the stack size of the cyclic executive, if it is used.  It runs the task methods of all of its tasks.
+ */
+#define CYCLIC_EXECUTIVE_TASK_STACK_SIZE (128*1024)
+
+/**
+ * This is the stack size of the timer service.
+ */
+#define TIMER_SERVICE_TASK_STACK_SIZE (64*1024)
+
+/**
+ * This is the stack size of the elastic manager.
+ */
+#define ELASTIC_MANAGER_TASK_STACK_SIZE (64*1024)
+
+/**
+ * Stack sizes for the non periodic tasks.
+ */
+#define ROBOT_CONTROLLER_STACK_SIZE (64*1024)
+#define NETWORK_RECEPTION_TASK_STACK_SIZE (128*1024)
+#define NETWORK_TRANSMIT_TASK_STACK_SIZE (128*1024)
+
+#endif /* TASKSTACKS_H_ */
@@ -0,0 +1,360 @@
+/**
+ * @file TimerService.cpp
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ *      This file implements the timer service, which releases the periodic tasks and runs the timers from a single timerfd.
+ */
+
+#include "TimerService.h"
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/timerfd.h>
+
+/**
+ * This method will order due releases so that the highest priority task is released first.
+ * @param first This is the first release.
+ * @param second This is the second release.
+ * @return true if the first release is to be made before the second.
+ */
+static bool higherPriorityFirst(const std::pair<int, size_t> &first, const std::pair<int, size_t> &second) {
+	return first.first > second.first;
+}
+
+/**
+ * This is the default constructor for the class.
+ * @param threadName This is the name of the thread in a human readable format.
+ */
+TimerService::TimerService(std::string threadName) :
+		RunnableClass(threadName), timerMutex(threadName + " timers") {
+	timerFD = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+	if (timerFD < 0) {
+		printf("Failed to create the timer service: %s\n", strerror(errno));
+	}
+	std::vector<Timer> heapSpace;
+	heapSpace.reserve(TIMER_SERVICE_RESERVED_TIMERS);
+	timers = std::priority_queue<Timer, std::vector<Timer>, LaterExpiration>(LaterExpiration(), std::move(heapSpace));
+	dueReleases.reserve(TIMER_SERVICE_RESERVED_TIMERS);
+	dueCallbacks.reserve(TIMER_SERVICE_RESERVED_TIMERS);
+}
+
+/**
+ * This is the destructor for the class.
+ */
+TimerService::~TimerService() {
+	close(timerFD);
+}
+
+/**
+ * This method will obtain the current time on CLOCK_MONOTONIC.
+ * @return The time will be returned in nanoseconds.
+ */
+uint64_t TimerService::now() {
+	struct timespec currentTime;
+	clock_gettime(CLOCK_MONOTONIC, &currentTime);
+	return (uint64_t) currentTime.tv_sec * 1000000000ULL + (uint64_t) currentTime.tv_nsec;
+}
+
+/**
+ * This method will arm the timerfd for the earliest pending expiration.  The timer mutex must be held.
+ */
+void TimerService::armTimer() {
+	struct itimerspec setting;
+	memset(&setting, 0, sizeof(setting));
+
+	if (!keepGoing) {
+		/**
+		 * 1.0 The service is stopping, so expire at once to wake the thread.  Any time in the past does this.
+		 */
+		setting.it_value.tv_nsec = 1;
+	} else if (!timers.empty()) {
+		/**
+		 * 2.0 Otherwise, expire at the earliest pending time.  If that time has passed, the timer expires at once.
+		 */
+		uint64_t expiration = timers.top().expiration;
+		setting.it_value.tv_sec = expiration / 1000000000ULL;
+		setting.it_value.tv_nsec = expiration % 1000000000ULL;
+	}
+	// An all zero setting disarms the timer when nothing is pending.
+	timerfd_settime(timerFD, TFD_TIMER_ABSTIME, &setting, NULL);
+}
+
+/**
+ * This method will add a timer to the heap and rearm the timerfd if it is now the earliest.  The timer mutex must be held.
+ * @param timer This is the timer that is to be added.
+ */
+void TimerService::schedule(const Timer &timer) {
+	timers.push(timer);
+	if (timers.top().id == timer.id) {
+		armTimer();
+	}
+}
+
+/**
+ * This method will allocate the id of a new timer.  The timer mutex must be held.
+ * @return The id will be returned.  It is never 0.
+ */
+TimerService::TimerID TimerService::allocateTimerID() {
+	TimerID id = nextTimerID++;
+	if (id == 0) {
+		// The id has wrapped around.  0 is never used.
+		id = nextTimerID++;
+	}
+	return id;
+}
+
+/**
+ * This method will schedule the periodic releases of a task.  The timer mutex must be held and the service must have started.
+ * @param task This is the task that is to be released.
+ * @param phaseInUs This is the offset of the releases of the task from the start time, in microseconds.
+ */
+void TimerService::scheduleTask(PeriodicTask *task, uint32_t phaseInUs) {
+	Timer timer;
+	uint64_t period = (uint64_t) task->getTaskPeriod() * 1000;
+	uint64_t currentTime = now();
+
+	/**
+	 * 1.0 The first release is the first period boundary of the task, offset by its phase, which has not yet passed.
+	 */
+	timer.expiration = startTime + (uint64_t) phaseInUs * 1000;
+	if (timer.expiration < currentTime) {
+		timer.expiration += ((currentTime - timer.expiration) / period + 1) * period;
+	}
+	timer.period = 0;
+	timer.id = allocateTimerID();
+	timer.task = task;
+	activeTimers.insert(timer.id);
+	schedule(timer);
+}
+
+/**
+ * This method will add a periodic task to the service.  From then on, the task is released by the service on its period
+ * boundaries instead of sleeping on its own.  It must be called before the task is started, and the task must not also be run
+ * by a cyclic executive.
+ * @param task This is the task that is to be released.
+ * @param phaseInUs This is the offset of the releases of the task from the start time of the service, in microseconds.
+ */
+void TimerService::addTask(PeriodicTask *task, uint32_t phaseInUs) {
+	std::lock_guard<PIMutex> lock(timerMutex);
+	task->setReleaseMode(PeriodicTask::TIMER_SERVICE_RELEASE);
+	if (startTime == 0) {
+		unscheduledTasks.push_back(std::make_pair(task, phaseInUs));
+	} else {
+		scheduleTask(task, phaseInUs);
+	}
+}
+
+/**
+ * This method will add a timer which calls a function.  The function is called on the thread of the service.
+ * @param delayInUs This is the time from now until the first expiration, in microseconds.
+ * @param periodInUs This is the period of the timer in microseconds, or 0 for a one-shot timer.
+ * @param callback This is the function that is called each time the timer expires.
+ * @return The id of the timer will be returned.
+ */
+TimerService::TimerID TimerService::addTimer(uint32_t delayInUs, uint32_t periodInUs, TimerCallback callback) {
+	Timer timer;
+	timer.expiration = now() + (uint64_t) delayInUs * 1000;
+	timer.period = (uint64_t) periodInUs * 1000;
+	timer.task = NULL;
+	timer.callback = callback;
+
+	std::lock_guard<PIMutex> lock(timerMutex);
+	timer.id = allocateTimerID();
+	activeTimers.insert(timer.id);
+	schedule(timer);
+	return timer.id;
+}
+
+/**
+ * This method will add a one-shot timer which calls a function.  The function is called on the thread of the service.
+ * @param delayInUs This is the time from now until the expiration, in microseconds.
+ * @param callback This is the function that is called when the timer expires.
+ * @return The id of the timer will be returned.
+ */
+TimerService::TimerID TimerService::addOneShot(uint32_t delayInUs, TimerCallback callback) {
+	return addTimer(delayInUs, 0, callback);
+}
+
+/**
+ * This method will cancel a timer.  A timer which is already being handled may still run once.
+ * @param id This is the id of the timer that is to be cancelled.
+ * @return true if the timer was pending.  False if it had already expired or been cancelled.
+ */
+bool TimerService::cancelTimer(TimerID id) {
+	std::lock_guard<PIMutex> lock(timerMutex);
+	// The timer stays in the heap, and is dropped when it reaches the top.
+	return activeTimers.erase(id) > 0;
+}
+
+/**
+ * This method will remove every expiration which is due from the heap, and reschedule those which are periodic.
+ * @param currentTime This is the current time on CLOCK_MONOTONIC, in nanoseconds.
+ */
+void TimerService::collectDueTimers(uint64_t currentTime) {
+	uint32_t expirationCount = 0;
+
+	while (!timers.empty() && timers.top().expiration <= currentTime) {
+		Timer timer = timers.top();
+		timers.pop();
+
+		/**
+		 * 1.0 Drop the timer if it was cancelled.
+		 */
+		if (activeTimers.count(timer.id) == 0) {
+			continue;
+		}
+		wakeupLatencyHistogram.recordValue((int64_t) ((currentTime - timer.expiration) / 1000));
+		expirationCount++;
+
+		if (timer.task != NULL) {
+			/**
+			 * 2.0 Release the task.  If the service was held up for more than a period, several releases are due at once, and the task
+			 * decides what to do with them.  The period is read on every release, so that a change of period takes effect.
+			 */
+			uint64_t period = (uint64_t) timer.task->getTaskPeriod() * 1000;
+			uint32_t releaseCount = (uint32_t) ((currentTime - timer.expiration) / period + 1);
+			DueRelease release;
+			release.task = timer.task;
+			release.releaseTime = timer.expiration + (releaseCount - 1) * period;
+			release.releaseCount = releaseCount;
+			dueReleases.push_back(release);
+
+			timer.expiration = release.releaseTime + period;
+			timers.push(timer);
+		} else {
+			/**
+			 * 3.0 Call the function.  A periodic timer which fell behind skips the expirations it missed.
+			 */
+			dueCallbacks.push_back(timer.callback);
+			if (timer.period > 0) {
+				timer.expiration += ((currentTime - timer.expiration) / timer.period + 1) * timer.period;
+				timers.push(timer);
+			} else {
+				activeTimers.erase(timer.id);
+			}
+		}
+	}
+
+	if (expirationCount > 1) {
+		batchedWakeupCount++;
+	}
+}
+
+/**
+ * This is the run method for the class.  It waits for each expiration and releases the tasks and calls the functions which are due.
+ */
+void TimerService::run() {
+	std::vector<std::pair<int, size_t> > releaseOrder;
+	releaseOrder.reserve(TIMER_SERVICE_RESERVED_TIMERS);
+
+	/**
+	 * 1.0 Fix the start time and schedule the tasks which were added before the service started.
+	 */
+	{
+		std::lock_guard<PIMutex> lock(timerMutex);
+		startTime = now() + (uint64_t) TIMER_SERVICE_START_DELAY * 1000;
+		for (size_t index = 0; index < unscheduledTasks.size(); index++) {
+			scheduleTask(unscheduledTasks[index].first, unscheduledTasks[index].second);
+		}
+		unscheduledTasks.clear();
+		armTimer();
+	}
+
+	while (keepGoing) {
+		/**
+		 * 2.0 Block until the earliest expiration.
+		 */
+		uint64_t expirations;
+		if (read(timerFD, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+			if (errno != EINTR) {
+				printf("The timer service failed: %s\n", strerror(errno));
+				return;
+			}
+			continue;
+		}
+		if (!keepGoing) {
+			break;
+		}
+
+		/**
+		 * 3.0 Take everything which is due off the heap, and arm the timer for what is left.
+		 */
+		{
+			std::lock_guard<PIMutex> lock(timerMutex);
+			collectDueTimers(now());
+			armTimer();
+		}
+
+		/**
+		 * 4.0 Release the tasks which are due, highest priority first, and then call the functions.  This is done without the lock,
+		 * so that the functions can add and cancel timers.
+		 */
+		releaseOrder.clear();
+		for (size_t index = 0; index < dueReleases.size(); index++) {
+			releaseOrder.push_back(std::make_pair(dueReleases[index].task->getPriority(), index));
+		}
+		std::stable_sort(releaseOrder.begin(), releaseOrder.end(), higherPriorityFirst);
+		for (size_t index = 0; index < releaseOrder.size(); index++) {
+			DueRelease &release = dueReleases[releaseOrder[index].second];
+			struct timespec releaseTime;
+			releaseTime.tv_sec = release.releaseTime / 1000000000ULL;
+			releaseTime.tv_nsec = release.releaseTime % 1000000000ULL;
+			release.task->release(releaseTime, release.releaseCount);
+		}
+		for (size_t index = 0; index < dueCallbacks.size(); index++) {
+			dueCallbacks[index]();
+		}
+		dueReleases.clear();
+		dueCallbacks.clear();
+	}
+}
+
+/**
+ * This method will stop the service.  It wakes the thread of the service so that it exits promptly.
+ */
+void TimerService::stop() {
+	std::lock_guard<PIMutex> lock(timerMutex);
+	RunnableClass::stop();
+	armTimer();
+}
+
+/**
+ * This method will print the distribution of the wakeup latency of the service.
+ */
+void TimerService::printLatencyInformation() {
+	std::cout << myOSThreadID << "\t" << std::setw(18) << myName << "\t Wakeup     \t";
+	wakeupLatencyHistogram.printPercentiles();
+	std::cout << myOSThreadID << "\t" << std::setw(18) << myName << "\t Batched wakeups: " << batchedWakeupCount << "\n";
+}
+
+/**
+ * This method will reset the wakeup latency of the service.
+ */
+void TimerService::resetThreadDiagnostics() {
+	wakeupLatencyHistogram.reset();
+	batchedWakeupCount = 0;
+}
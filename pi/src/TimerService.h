@@ -0,0 +1,298 @@
+/**
+ * @file TimerService.h
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ *      This file defines the timer service.  The timer service is the single source of wakeups for the periodic tasks and the
+ *      timers of the system.  It keeps every pending expiration in a heap ordered by time, and blocks its thread on one
+ *      timerfd which is always armed for the earliest of them.  Each wakeup handles every expiration which is due, so releases
+ *      which fall at the same instant are handled together, in order of priority.
+ *
+ *      Periodic tasks which are added to the service are released on their period boundaries, measured from a common start
+ *      time plus a phase offset for each task.  Offsetting the phases of tasks with related periods keeps their releases from
+ *      piling up on the same instant.  The service also runs periodic and one-shot timers, which call a function on the thread
+ *      of the service.  Those functions must be short, since they delay every other expiration.
+ *
+ *      The delay from each expiration to the wakeup of the service is recorded, so the release latency of the whole system
+ *      is measured in one place.
+ */
+
+#ifndef TIMERSERVICE_H_
+#define TIMERSERVICE_H_
+
+#include "RunnableClass.h"
+#include "PeriodicTask.h"
+#include "LatencyHistogram.h"
+#include "PIMutex.h"
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <set>
+#include <vector>
+#include <stdint.h>
+
+/**
+ * This is the number of timers the service reserves space for, so that handling expirations does not allocate memory.
+ */
+#define TIMER_SERVICE_RESERVED_TIMERS (64)
+
+/**
+ * This is the delay, in microseconds, from the start of the service to the first release of the periodic tasks.  It gives the
+ * threads of the tasks time to start and block waiting for their first release.
+ */
+#define TIMER_SERVICE_START_DELAY (10000)
+
+class TimerService: public RunnableClass {
+public:
+	/**
+	 * This is the type of the function which is called when a timer expires.
+	 */
+	typedef std::function<void()> TimerCallback;
+
+	/**
+	 * This is the type of the id which identifies a timer.  0 is never a valid id.
+	 */
+	typedef uint32_t TimerID;
+
+private:
+	/**
+	 * This structure holds one pending expiration.
+	 */
+	struct Timer {
+		/**
+		 * This is the time of the expiration on CLOCK_MONOTONIC, in nanoseconds.
+		 */
+		uint64_t expiration;
+
+		/**
+		 * This is the period of the timer in nanoseconds, or 0 if it is a one-shot timer.
+		 */
+		uint64_t period;
+
+		/**
+		 * This is the id of the timer.
+		 */
+		TimerID id;
+
+		/**
+		 * This is the task which is released by the timer, or NULL if the timer calls a function.
+		 */
+		PeriodicTask *task;
+
+		/**
+		 * This is the function which is called by the timer, if it does not release a task.
+		 */
+		TimerCallback callback;
+	};
+
+	/**
+	 * This structure orders the heap so that the earliest expiration is on top.
+	 */
+	struct LaterExpiration {
+		/**
+		 * This method will compare two timers.
+		 * @param first This is the first timer.
+		 * @param second This is the second timer.
+		 * @return true if the first timer expires after the second.
+		 */
+		bool operator()(const Timer &first, const Timer &second) const {
+			return first.expiration > second.expiration;
+		}
+	};
+
+	/**
+	 * This structure describes one release of a task which is due.
+	 */
+	struct DueRelease {
+		/**
+		 * This is the task which is to be released.
+		 */
+		PeriodicTask *task;
+
+		/**
+		 * This is the time of the most recent release which is due, on CLOCK_MONOTONIC, in nanoseconds.
+		 */
+		uint64_t releaseTime;
+
+		/**
+		 * This is the number of releases of the task which became due in this wakeup.
+		 */
+		uint32_t releaseCount;
+	};
+
+	/**
+	 * This is the heap of pending expirations.
+	 */
+	std::priority_queue<Timer, std::vector<Timer>, LaterExpiration> timers;
+
+	/**
+	 * These are the ids of the timers which have not been cancelled.  A timer whose id is not here is dropped when it reaches the
+	 * top of the heap.
+	 */
+	std::set<TimerID> activeTimers;
+
+	/**
+	 * These are the tasks which were added before the service started, with their phase offsets in microseconds.  They are
+	 * scheduled from the start time when the service starts.
+	 */
+	std::vector<std::pair<PeriodicTask*, uint32_t> > unscheduledTasks;
+
+	/**
+	 * This mutex protects the heap and the set of active timers.
+	 */
+	PIMutex timerMutex;
+
+	/**
+	 * This is the timerfd which the service blocks on.
+	 */
+	int timerFD;
+
+	/**
+	 * This is the time, on CLOCK_MONOTONIC in nanoseconds, from which the releases of every task are measured.  It is 0 until
+	 * the service starts.
+	 */
+	uint64_t startTime = 0;
+
+	/**
+	 * This is the id of the next timer which is added.
+	 */
+	TimerID nextTimerID = 1;
+
+	/**
+	 * These are the task releases and the functions which are due in the current wakeup.  They are kept between wakeups so that
+	 * their space is reused.
+	 */
+	std::vector<DueRelease> dueReleases;
+	std::vector<TimerCallback> dueCallbacks;
+
+	/**
+	 * This is the distribution of the delay from each expiration to the wakeup of the service, in microseconds.
+	 */
+	LatencyHistogram wakeupLatencyHistogram;
+
+	/**
+	 * This is the number of wakeups which handled more than one expiration.
+	 */
+	uint32_t batchedWakeupCount = 0;
+
+	/**
+	 * This method will obtain the current time on CLOCK_MONOTONIC.
+	 * @return The time will be returned in nanoseconds.
+	 */
+	static uint64_t now();
+
+	/**
+	 * This method will add a timer to the heap and rearm the timerfd if it is now the earliest.  The timer mutex must be held.
+	 * @param timer This is the timer that is to be added.
+	 */
+	void schedule(const Timer &timer);
+
+	/**
+	 * This method will arm the timerfd for the earliest pending expiration.  The timer mutex must be held.
+	 */
+	void armTimer();
+
+	/**
+	 * This method will schedule the periodic releases of a task.  The timer mutex must be held and the service must have started.
+	 * @param task This is the task that is to be released.
+	 * @param phaseInUs This is the offset of the releases of the task from the start time, in microseconds.
+	 */
+	void scheduleTask(PeriodicTask *task, uint32_t phaseInUs);
+
+	/**
+	 * This method will allocate the id of a new timer.  The timer mutex must be held.
+	 * @return The id will be returned.  It is never 0.
+	 */
+	TimerID allocateTimerID();
+
+	/**
+	 * This method will remove every expiration which is due from the heap, and reschedule those which are periodic.
+	 * @param currentTime This is the current time on CLOCK_MONOTONIC, in nanoseconds.
+	 */
+	void collectDueTimers(uint64_t currentTime);
+
+public:
+	/**
+	 * This is the default constructor for the class.
+	 * @param threadName This is the name of the thread in a human readable format.
+	 */
+	TimerService(std::string threadName);
+
+	/**
+	 * This is the destructor for the class.
+	 */
+	virtual ~TimerService();
+
+	/**
+	 * This method will add a periodic task to the service.  From then on, the task is released by the service on its period
+	 * boundaries instead of sleeping on its own.  It must be called before the task is started, and the task must not also be run
+	 * by a cyclic executive.
+	 * @param task This is the task that is to be released.
+	 * @param phaseInUs This is the offset of the releases of the task from the start time of the service, in microseconds.
+	 */
+	void addTask(PeriodicTask *task, uint32_t phaseInUs);
+
+	/**
+	 * This method will add a timer which calls a function.  The function is called on the thread of the service.
+	 * @param delayInUs This is the time from now until the first expiration, in microseconds.
+	 * @param periodInUs This is the period of the timer in microseconds, or 0 for a one-shot timer.
+	 * @param callback This is the function that is called each time the timer expires.
+	 * @return The id of the timer will be returned.
+	 */
+	TimerID addTimer(uint32_t delayInUs, uint32_t periodInUs, TimerCallback callback);
+
+	/**
+	 * This method will add a one-shot timer which calls a function.  The function is called on the thread of the service.
+	 * @param delayInUs This is the time from now until the expiration, in microseconds.
+	 * @param callback This is the function that is called when the timer expires.
+	 * @return The id of the timer will be returned.
+	 */
+	TimerID addOneShot(uint32_t delayInUs, TimerCallback callback);
+
+	/**
+	 * This method will cancel a timer.  A timer which is already being handled may still run once.
+	 * @param id This is the id of the timer that is to be cancelled.
+	 * @return true if the timer was pending.  False if it had already expired or been cancelled.
+	 */
+	bool cancelTimer(TimerID id);
+
+	/**
+	 * This is the run method for the class.  It waits for each expiration and releases the tasks and calls the functions which are due.
+	 */
+	void run();
+
+	/**
+	 * This method will stop the service.  It wakes the thread of the service so that it exits promptly.
+	 */
+	void stop();
+
+	/**
+	 * This method will print the distribution of the wakeup latency of the service.
+	 */
+	void printLatencyInformation();
+
+	/**
+	 * This method will reset the wakeup latency of the service.
+	 */
+	void resetThreadDiagnostics();
+};
+
+#endif /* TIMERSERVICE_H_ */
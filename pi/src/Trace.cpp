@@ -0,0 +1,281 @@
+/**
+ * @file Trace.cpp
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ *      This file implements the tracer, which records events into a ring buffer per thread and exports them as Chrome trace JSON.
+ */
+
+#include "Trace.h"
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+
+thread_local Trace::ThreadBuffer *Trace::threadBuffer = NULL;
+std::vector<Trace::ThreadBuffer*> Trace::buffers;
+std::mutex Trace::buffersMutex;
+std::atomic<uint64_t> Trace::startTimestamp(0);
+std::atomic<bool> Trace::enabled(false);
+
+/**
+ * This method will obtain the current time on CLOCK_MONOTONIC.
+ * @return The time will be returned in nanoseconds.
+ */
+static uint64_t monotonicNow() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec;
+}
+
+/**
+ * This method will create the buffer of the calling thread and add it to the list of buffers.
+ * @return The buffer of the calling thread will be returned.
+ */
+Trace::ThreadBuffer *Trace::createThreadBuffer() {
+	ThreadBuffer *buffer = allocateThreadBuffer();
+	buffer->threadID = syscall(SYS_gettid);
+	if (pthread_getname_np(pthread_self(), buffer->threadName, sizeof(buffer->threadName)) != 0) {
+		snprintf(buffer->threadName, sizeof(buffer->threadName), "%d", (int) buffer->threadID);
+	}
+	threadBuffer = buffer;
+	return buffer;
+}
+
+/**
+ * This method will allocate a buffer, fault it in and add it to the list of buffers, without giving it to any thread.
+ * @return The buffer will be returned.
+ */
+Trace::ThreadBuffer *Trace::allocateThreadBuffer() {
+	ThreadBuffer *buffer = new ThreadBuffer;
+
+	// Write the whole buffer now, so that it is faulted in before any event is recorded.
+	memset(buffer->records, 0, sizeof(buffer->records));
+	buffer->writeIndex.store(0);
+	buffer->threadID = 0;
+	buffer->threadName[0] = '\0';
+
+	std::lock_guard<std::mutex> lock(buffersMutex);
+	buffers.push_back(buffer);
+	return buffer;
+}
+
+/**
+ * This method will record an event in the buffer of the calling thread.  It should be called through the macros.
+ * @param type This is the TraceEventType of the event.
+ * @param name This is the name of the event.
+ * @param value This is an integer which is stored with the event.
+ * @param flowID This is the flow id of the event, or 0 if it is not part of a flow.
+ */
+void Trace::record(TraceEventType type, const char *name, int32_t value, uint64_t flowID) {
+	ThreadBuffer *buffer = threadBuffer;
+	if (buffer == NULL) {
+		buffer = createThreadBuffer();
+	}
+
+	/**
+	 * 1.0 Fill in the next slot, overwriting the oldest event if the buffer is full.
+	 */
+	uint64_t index = buffer->writeIndex.load(std::memory_order_relaxed);
+	TraceRecord &event = buffer->records[index & (TRACE_BUFFER_EVENTS - 1)];
+	event.timestamp = monotonicNow();
+	event.name = name;
+	event.flowID = flowID;
+	event.value = value;
+	event.type = type;
+
+	/**
+	 * 2.0 Publish the event.  The release store makes the event visible to an export which sees the new index.
+	 */
+	buffer->writeIndex.store(index + 1, std::memory_order_release);
+}
+
+/**
+ * This method will create the buffer of the calling thread ahead of time, so that the first traced event does not allocate
+ * and fault in memory.  It is called by every runnable class as its thread starts.
+ */
+void Trace::registerThread() {
+	if (threadBuffer == NULL) {
+		createThreadBuffer();
+	}
+}
+
+/**
+ * This method will create a buffer ahead of time for a thread which has not started yet, and which is not a runnable class.
+ * The thread takes it with adoptThreadBuffer.
+ * @param threadName This is the name the buffer is exported with.
+ * @return The buffer will be returned.
+ */
+Trace::ThreadBuffer *Trace::reserveThreadBuffer(const char *threadName) {
+	ThreadBuffer *buffer = allocateThreadBuffer();
+	snprintf(buffer->threadName, sizeof(buffer->threadName), "%s", threadName);
+	return buffer;
+}
+
+/**
+ * This method will make a buffer from reserveThreadBuffer the buffer of the calling thread, unless the thread already has one.
+ * It does not allocate, so it can be called from an interrupt handler.
+ * @param buffer This is the buffer, or NULL to do nothing.
+ */
+void Trace::adoptThreadBuffer(ThreadBuffer *buffer) {
+	if (threadBuffer == NULL && buffer != NULL) {
+		buffer->threadID = syscall(SYS_gettid);
+		threadBuffer = buffer;
+	}
+}
+
+/**
+ * This method will enable or disable tracing.  Enabling tracing starts a new trace, so that events from before are not exported.
+ * @param enable If this is true, tracing is enabled.  Otherwise, it is disabled.
+ */
+void Trace::setEnabled(bool enable) {
+	if (enable) {
+		startTimestamp.store(monotonicNow());
+	}
+	enabled.store(enable);
+}
+
+/**
+ * This method will write a string to a file as a JSON string, with quotes and escapes.
+ * @param file This is the file that is being written.
+ * @param text This is the text that is to be written.
+ */
+void Trace::writeJSONString(FILE *file, const char *text) {
+	fputc('"', file);
+	for (const char *c = text; *c != '\0'; c++) {
+		if (*c == '"' || *c == '\\') {
+			fprintf(file, "\\%c", *c);
+		} else if ((unsigned char) *c < 0x20) {
+			fprintf(file, "\\u%04x", (unsigned int) (unsigned char) *c);
+		} else {
+			fputc(*c, file);
+		}
+	}
+	fputc('"', file);
+}
+
+/**
+ * This method will write every traced event to a file in the Chrome trace JSON format.  It may be called while tracing.
+ * @param fileName This is the name of the file that is to be written.
+ * @return true if the file was written.  False otherwise.
+ */
+bool Trace::exportChromeJSON(const std::string &fileName) {
+	FILE *file = fopen(fileName.c_str(), "w");
+	if (file == NULL) {
+		perror("Unable to open the trace file");
+		return false;
+	}
+
+	int pid = (int) getpid();
+	uint64_t traceStart = startTimestamp.load();
+	size_t eventCount = 0;
+	bool first = true;
+	std::vector<TraceRecord> events;
+
+	fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+
+	std::lock_guard<std::mutex> lock(buffersMutex);
+	for (std::vector<ThreadBuffer*>::iterator it = buffers.begin(); it != buffers.end(); it++) {
+		ThreadBuffer *buffer = *it;
+
+		/**
+		 * 1.0 Copy the events out of the buffer.  The thread may keep recording, so after the copy, drop every event whose slot
+		 * may have been overwritten while it was being copied, including the one which may be half written.
+		 */
+		uint64_t endIndex = buffer->writeIndex.load(std::memory_order_acquire);
+		uint64_t startIndex = (endIndex > TRACE_BUFFER_EVENTS) ? endIndex - TRACE_BUFFER_EVENTS : 0;
+		events.clear();
+		for (uint64_t index = startIndex; index < endIndex; index++) {
+			events.push_back(buffer->records[index & (TRACE_BUFFER_EVENTS - 1)]);
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+		uint64_t laterIndex = buffer->writeIndex.load(std::memory_order_relaxed);
+		size_t firstValid = 0;
+		if (laterIndex >= TRACE_BUFFER_EVENTS && laterIndex - TRACE_BUFFER_EVENTS + 1 > startIndex) {
+			firstValid = laterIndex - TRACE_BUFFER_EVENTS + 1 - startIndex;
+		}
+
+		/**
+		 * 2.0 Name the thread, so that its track is labeled in the viewer.
+		 */
+		fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":", first ? "" : ",", pid,
+				(int) buffer->threadID);
+		writeJSONString(file, buffer->threadName);
+		fprintf(file, "}}");
+		first = false;
+
+		/**
+		 * 3.0 Write each event.  Spans become begin and end events, and everything else becomes an instant slice.  The two ends
+		 * of a queue hand-off are linked with flow events, which bind to the slice written just before them.
+		 */
+		for (size_t index = firstValid; index < events.size(); index++) {
+			const TraceRecord &event = events[index];
+			if (event.timestamp < traceStart) {
+				continue;
+			}
+			double ts = (double) event.timestamp / 1000.0;
+
+			if (event.type == TRACE_END) {
+				fprintf(file, ",\n{\"ph\":\"E\",\"ts\":%.3f,\"pid\":%d,\"tid\":%d}", ts, pid, (int) buffer->threadID);
+				eventCount++;
+				continue;
+			}
+
+			const char *category;
+			switch (event.type) {
+			case TRACE_BEGIN:
+				category = "task";
+				break;
+			case TRACE_ENQUEUE:
+			case TRACE_DEQUEUE:
+				category = "queue";
+				break;
+			case TRACE_ISR:
+				category = "isr";
+				break;
+			default:
+				category = "network";
+				break;
+			}
+
+			fprintf(file, ",\n{\"name\":");
+			writeJSONString(file, event.name);
+			fprintf(file, ",\"cat\":\"%s\",\"ph\":%s,\"ts\":%.3f,\"pid\":%d,\"tid\":%d,\"args\":{\"value\":%d}}",
+					category, (event.type == TRACE_BEGIN) ? "\"B\"" : "\"X\",\"dur\":0", ts, pid, (int) buffer->threadID,
+					(int) event.value);
+			eventCount++;
+
+			if (event.flowID != 0) {
+				fprintf(file,
+						",\n{\"name\":\"command\",\"cat\":\"queue\",\"ph\":\"%s\",\"bp\":\"e\",\"id\":\"0x%llx\",\"ts\":%.3f,\"pid\":%d,\"tid\":%d}",
+						(event.type == TRACE_ENQUEUE) ? "s" : "f", (unsigned long long) event.flowID, ts, pid,
+						(int) buffer->threadID);
+			}
+		}
+	}
+
+	fprintf(file, "\n]}\n");
+	fclose(file);
+	printf("Wrote %u trace events from %u threads to %s\n", (unsigned int) eventCount, (unsigned int) buffers.size(),
+			fileName.c_str());
+	return true;
+}
@@ -0,0 +1,269 @@
+/**
+ * @file Trace.h
+ * @author  Walter Schilling (schilling@msoe.edu)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ *
+ * This code is developed as part of the MSOE SE3910 Real Time Systems course,
+ * but can be freely used by others.
+ *
+ * SE3910 Real Time Systems is a required course for students studying the
+ * discipline of software engineering.
+ *
+ * This Software is provided under the License on an "AS IS" basis and
+ * without warranties of any kind concerning the Software, including
+ * without limitation merchantability, fitness for a particular purpose,
+ * absence of defects or errors, accuracy, and non-infringement of
+ * intellectual property rights other than copyright. This disclaimer
+ * of warranty is an essential part of the License and a condition for
+ * the grant of any rights to this Software.
+ *
+ * @section DESCRIPTION
+ *      This file defines the tracer.  Each thread records fixed size events (task releases, queue hand-offs, interrupts and
+ *      network traffic) into a ring buffer of its own, stamped with CLOCK_MONOTONIC.  Only the owning thread writes to a buffer,
+ *      so recording takes no lock and never blocks.  When a buffer is full, the oldest events are overwritten, so the buffers
+ *      always hold the most recent part of the run.
+ *
+ *      The events of every thread can be written out as a Chrome trace JSON file, which can be opened in Perfetto
+ *      (ui.perfetto.dev) or chrome://tracing.  Each command is drawn as an arrow from the thread that enqueued it to the thread
+ *      that dequeued it.
+ *
+ *      Events are recorded with the TRACE_EVENT and TRACE_FLOW_EVENT macros.  While tracing is disabled, each costs a single load
+ *      and a branch which is predicted not taken.
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+/**
+ * This is the number of events held by the buffer of each thread.  It must be a power of 2.
+ */
+#define TRACE_BUFFER_EVENTS (8192)
+
+/**
+ * This is the name of the file that the trace is exported to from the console.
+ */
+#define TRACE_EXPORT_FILE_NAME "trace.json"
+
+/**
+ * This macro will record an event on the calling thread if tracing is enabled.  The arguments are not evaluated otherwise.
+ * @param type This is the TraceEventType of the event.
+ * @param name This is the name of the event.  It must stay valid for the rest of the run, such as a string literal.
+ * @param value This is an integer which is stored with the event.
+ */
+#define TRACE_EVENT(type, name, value) \
+	do { \
+		if (__builtin_expect(Trace::enabled.load(std::memory_order_relaxed), 0)) { \
+			Trace::record((type), (name), (value), 0); \
+		} \
+	} while (0)
+
+/**
+ * This macro will record an event which is one end of a flow, such as a command passing between threads.
+ * @param type This is the TraceEventType of the event.
+ * @param name This is the name of the event.  It must stay valid for the rest of the run, such as a string literal.
+ * @param value This is an integer which is stored with the event.
+ * @param flowID This is the id which links the two ends of the flow.  It must be unique within the run and not 0.
+ */
+#define TRACE_FLOW_EVENT(type, name, value, flowID) \
+	do { \
+		if (__builtin_expect(Trace::enabled.load(std::memory_order_relaxed), 0)) { \
+			Trace::record((type), (name), (value), (flowID)); \
+		} \
+	} while (0)
+
+/**
+ * This enumeration gives the kinds of events which can be traced.
+ */
+enum TraceEventType {
+	/**
+	 * This is the start of a span of work on the thread, such as the release of a periodic task.
+	 */
+	TRACE_BEGIN,
+	/**
+	 * This is the end of the span most recently begun on the thread.
+	 */
+	TRACE_END,
+	/**
+	 * This is a command being placed onto a queue.
+	 */
+	TRACE_ENQUEUE,
+	/**
+	 * This is a command being taken from a queue.
+	 */
+	TRACE_DEQUEUE,
+	/**
+	 * This is an interrupt being handled.
+	 */
+	TRACE_ISR,
+	/**
+	 * This is data being sent over the network.
+	 */
+	TRACE_SEND,
+	/**
+	 * This is data being received from the network.
+	 */
+	TRACE_RECEIVE
+};
+
+class Trace {
+private:
+	/**
+	 * This structure holds one traced event.
+	 */
+	struct TraceRecord {
+		/**
+		 * This is the time of the event on CLOCK_MONOTONIC, in nanoseconds.
+		 */
+		uint64_t timestamp;
+
+		/**
+		 * This is the name of the event.
+		 */
+		const char *name;
+
+		/**
+		 * This is the flow id of the event, or 0 if it is not part of a flow.
+		 */
+		uint64_t flowID;
+
+		/**
+		 * This is the value which was recorded with the event.
+		 */
+		int32_t value;
+
+		/**
+		 * This is the TraceEventType of the event.
+		 */
+		uint32_t type;
+	};
+
+public:
+	/**
+	 * This structure is the ring buffer of one thread.  Only the owning thread writes to it.  It is public only so that a buffer can
+	 * be created ahead of time for a thread which the robot does not create, such as the interrupt thread of a GPIO pin.
+	 */
+	struct ThreadBuffer {
+		/**
+		 * This is the Linux thread id of the owning thread.
+		 */
+		pid_t threadID;
+
+		/**
+		 * This is the name of the owning thread.
+		 */
+		char threadName[16];
+
+		/**
+		 * This is the total number of events written to the buffer.  The next event is written at this index modulo the size.
+		 */
+		std::atomic<uint64_t> writeIndex;
+
+		/**
+		 * These are the events of the thread.
+		 */
+		TraceRecord records[TRACE_BUFFER_EVENTS];
+	};
+
+private:
+
+	/**
+	 * This is the buffer of the calling thread, or NULL if the thread has not recorded anything yet.
+	 */
+	static thread_local ThreadBuffer *threadBuffer;
+
+	/**
+	 * This is every buffer which has been created.  Buffers are kept after their thread ends, so that they can still be exported.
+	 */
+	static std::vector<ThreadBuffer*> buffers;
+
+	/**
+	 * This mutex protects the list of buffers.
+	 */
+	static std::mutex buffersMutex;
+
+	/**
+	 * This is the time at which tracing was last enabled, in nanoseconds.  Older events are not exported.
+	 */
+	static std::atomic<uint64_t> startTimestamp;
+
+	/**
+	 * This method will create the buffer of the calling thread and add it to the list of buffers.
+	 * @return The buffer of the calling thread will be returned.
+	 */
+	static ThreadBuffer *createThreadBuffer();
+
+	/**
+	 * This method will allocate a buffer, fault it in and add it to the list of buffers, without giving it to any thread.
+	 * @return The buffer will be returned.
+	 */
+	static ThreadBuffer *allocateThreadBuffer();
+
+	/**
+	 * This method will write a string to a file as a JSON string, with quotes and escapes.
+	 * @param file This is the file that is being written.
+	 * @param text This is the text that is to be written.
+	 */
+	static void writeJSONString(FILE *file, const char *text);
+
+public:
+	/**
+	 * This flag is true while tracing is enabled.  It is public so that the macros can test it inline.
+	 */
+	static std::atomic<bool> enabled;
+
+	/**
+	 * This method will record an event in the buffer of the calling thread.  It should be called through the macros.
+	 * @param type This is the TraceEventType of the event.
+	 * @param name This is the name of the event.
+	 * @param value This is an integer which is stored with the event.
+	 * @param flowID This is the flow id of the event, or 0 if it is not part of a flow.
+	 */
+	static void record(TraceEventType type, const char *name, int32_t value, uint64_t flowID);
+
+	/**
+	 * This method will create the buffer of the calling thread ahead of time, so that the first traced event does not allocate
+	 * and fault in memory.  It is called by every runnable class as its thread starts.
+	 */
+	static void registerThread();
+
+	/**
+	 * This method will create a buffer ahead of time for a thread which has not started yet, and which is not a runnable class.
+	 * The thread takes it with adoptThreadBuffer.
+	 * @param threadName This is the name the buffer is exported with.
+	 * @return The buffer will be returned.
+	 */
+	static ThreadBuffer *reserveThreadBuffer(const char *threadName);
+
+	/**
+	 * This method will make a buffer from reserveThreadBuffer the buffer of the calling thread, unless the thread already has one.
+	 * It does not allocate, so it can be called from an interrupt handler.
+	 * @param buffer This is the buffer, or NULL to do nothing.
+	 */
+	static void adoptThreadBuffer(ThreadBuffer *buffer);
+
+	/**
+	 * This method will enable or disable tracing.  Enabling tracing starts a new trace, so that events from before are not exported.
+	 * @param enable If this is true, tracing is enabled.  Otherwise, it is disabled.
+	 */
+	static void setEnabled(bool enable);
+
+	/**
+	 * This method will write every traced event to a file in the Chrome trace JSON format.  It may be called while tracing.
+	 * @param fileName This is the name of the file that is to be written.
+	 * @return true if the file was written.  False otherwise.
+	 */
+	static bool exportChromeJSON(const std::string &fileName);
+};
+
+#endif /* TRACE_H_ */
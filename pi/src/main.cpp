@@ -35,6 +35,16 @@ using namespace std;
 #include "RobotStatusManager.h"
 #include "CollisionSensingRobotController.h"
 #include "GenericThreadInfo.h"
+#include "CyclicExecutive.h"
+#include "SchedulingCfg.h"
+#include "TaskCores.h"
+#include "PIMutex.h"
+#include "TaskStacks.h"
+#include "SchedulabilityAnalyzer.h"
+#include "Trace.h"
+#include "ElasticManager.h"
+#include "TimerService.h"
+#include "ClockSynchronizer.h"
 #include "labcfg.h"
 using namespace std;
 
@@ -54,6 +64,11 @@ int main(int argc, char *argv[]) {
 		exit(0);
 	}
 
+#if USE_REAL_TIME_MEMORY_MODE
+	// Lock memory before any thread is created, so that every stack and heap page is mapped and stays resident.
+	RunnableClass::enableRealTimeMemoryMode();
+#endif
+
 	GenericThreadInfo mainThread("main", syscall(SYS_gettid));
 
 	cout << "Main thread id is : " << mainThread.getThreadID() << "\n";
@@ -67,15 +82,30 @@ int main(int argc, char *argv[]) {
 	fps = atoi(argv[7]);
 
 	CommandQueue *myQueue[NUMBER_OF_QUEUES];
+	const char *queueNames[NUMBER_OF_QUEUES] = { "Motor Queue", "Horn Queue", "Line Sensor Queue" };
 	for (int index = 0; index < NUMBER_OF_QUEUES; index++)
 	{
-		myQueue[index] = new CommandQueue();
+		myQueue[index] = new CommandQueue(queueNames[index]);
 	}
 
+	// Only the newest speed, direction and steering command matters to the motors, so a newer one replaces any still pending.
+	myQueue[0]->enableCoalescing(SPEEDDIRECTIONBITMAP);
+	myQueue[0]->enableCoalescing(MOTORDIRECTIONBITMAP);
+	myQueue[0]->enableCoalescing(STEERINGOFFSETBITMAP);
+
+	/**
+	 * Declare the timer service.  It times the pulses of the horn and, if it is enabled, releases the periodic tasks.
+	 */
+	TimerService timerService("Timer Service");
+
 	/**
 	 * Declare the network manager, which will receive commands from the network.
 	 */
+#if USE_UDP_CONTROL
+	NetworkManager nm(9090, myQueue, "NetworkManager", UDP_CONTROL_PORT);
+#else
 	NetworkManager nm(9090, myQueue, "NetworkManager");
+#endif
 	NetworkTransmissionManager ntm(&nm, "NW Trans Manager");
 
 	/**
@@ -97,10 +127,13 @@ int main(int argc, char *argv[]) {
 	RobotController mc(myQueue[0], myQueue[1], "RobotController");
 #endif
 
+	// Acknowledge each command from the network once the motors have it, so that the operator station can measure the whole delay.
+	mc.setAcknowledgementManager(&ntm);
+
 	/**
 	 * Declare an instance of a Horn Controller.
 	 */
-	Horn h(myQueue[1], BUZZER_GPIO_PIN, "Horn Controller", HORN_TASK_PERIOD);
+	Horn h(myQueue[1], BUZZER_GPIO_PIN, &timerService, "Horn Controller", HORN_TASK_PERIOD);
 
 
 #if LAB_IMPLEMENATION_STEP >= 10
@@ -123,23 +156,115 @@ int main(int argc, char *argv[]) {
 			CENTER_LINE_SENSOR_GPIO_PIN, RIGHT_LINE_SENSOR_GPIO_PIN,
 			"Stop Line Sensor Task", LINE_TRACKER_SENSOR_TASK_PERIOD);
 
+	/**
+	 * Give each periodic task its execution time budget for the schedulability analysis.  The motor controllers are given
+	 * theirs by the robot controller.
+	 */
+	ds.setWCETBudget(DISTANCE_SENSOR_TASK_WCET_BUDGET);
+	cs.setWCETBudget(COLLISION_SENSOR_TASK_WCET_BUDGET);
+	h.setWCETBudget(HORN_TASK_WCET_BUDGET);
+	ls.setWCETBudget(LINE_TRACKER_SENSOR_TASK_WCET_BUDGET);
+#if LAB_IMPLEMENATION_STEP >= 10
+	rsm.setWCETBudget(ROBOT_STATUS_MANAGER_TASK_WCET_BUDGET);
+#endif
+#if LAB_IMPLEMENATION_STEP >= 11
+	myCamera.setWCETBudget(CAMERA_TASK_WCET_BUDGET);
+	is.setWCETBudget(IMAGE_STREAM_TASK_WCET_BUDGET);
+#endif
+
+#if USE_ELASTIC_SCHEDULING
+	/**
+	 * Let the tasks which can run more slowly give up time under overload.  The sensors and controllers are hard tasks and are
+	 * never added.
+	 */
+	ElasticManager elasticManager("Elastic Manager", ELASTIC_MANAGER_TASK_PERIOD, ELASTIC_UTILIZATION_BOUND);
+	elasticManager.setWCETBudget(ELASTIC_MANAGER_TASK_WCET_BUDGET);
+#if LAB_IMPLEMENATION_STEP >= 11
+	elasticManager.addTask(&myCamera, CAMERA_TASK_MAX_PERIOD, CAMERA_TASK_ELASTICITY);
+	elasticManager.addTask(&is, IMAGE_STREAM_TASK_MAX_PERIOD, IMAGE_STREAM_TASK_ELASTICITY);
+#endif
+#if (LAB_IMPLEMENATION_STEP >= 10) && !USE_CYCLIC_EXECUTIVE
+	// The frames of the cyclic executive are fixed, so the status manager is only elastic on its own thread.
+	elasticManager.addTask(&rsm, ROBOT_STATUS_MANAGER_TASK_MAX_PERIOD, ROBOT_STATUS_MANAGER_TASK_ELASTICITY);
+#endif
+#endif
+
+#if USE_CYCLIC_EXECUTIVE
+	/**
+	 * Run the short periodic tasks from a single thread.  The distance sensor blocks waiting for its echo, and the camera
+	 * pipeline runs for a large part of its period, so those keep their own threads.
+	 */
+	CyclicExecutive executive("Cyclic Executive");
+	mc.addMotorsToExecutive(&executive);
+	cs.setPriority(COLLISION_SENSOR_TASK_PRIORITY);
+	executive.addTask(&cs);
+	ls.setPriority(LINE_TRACKER_SENSOR_TASK_PRIORITY);
+	executive.addTask(&ls);
+	h.setPriority(HORN_TASK_PRIORITY);
+	executive.addTask(&h);
+#if LAB_IMPLEMENATION_STEP >= 10
+	rsm.setPriority(ROBOT_STATUS_MANAGER_TASK_PRIORITY);
+	executive.addTask(&rsm);
+#endif
+#endif
+
+#if USE_TIMER_SERVICE
+	/**
+	 * Release the tasks which run on their own threads from the timer service, at their phase offsets.
+	 */
+#if !USE_CYCLIC_EXECUTIVE
+	mc.addMotorsToTimerService(&timerService, MOTOR_CTRL_TASK_PHASE);
+	timerService.addTask(&cs, COLLISION_SENSOR_TASK_PHASE);
+	timerService.addTask(&ls, LINE_TRACKER_SENSOR_TASK_PHASE);
+	timerService.addTask(&h, HORN_TASK_PHASE);
+#if LAB_IMPLEMENATION_STEP >= 10
+	timerService.addTask(&rsm, ROBOT_STATUS_MANAGER_TASK_PHASE);
+#endif
+#endif
+	timerService.addTask(&ds, DISTANCE_SENSOR_TASK_PHASE);
+#if LAB_IMPLEMENATION_STEP >= 11
+	timerService.addTask(&myCamera, CAMERA_TASK_PHASE);
+	timerService.addTask(&is, IMAGE_STREAM_TASK_PHASE);
+#endif
+#if USE_ELASTIC_SCHEDULING
+	timerService.addTask(&elasticManager, ELASTIC_MANAGER_TASK_PHASE);
+#endif
+#endif
+
 	// Start each of the two threads up.
-	nm.start(NETWORK_RECEPTION_TASK_PRIORITY);
-	ntm.start(NETWORK_TRANSMIT_TASK_PRIORITY);
+	nm.start(NETWORK_RECEPTION_TASK_PRIORITY, NETWORK_RECEPTION_TASK_CORES, NETWORK_RECEPTION_TASK_STACK_SIZE);
+	ntm.start(NETWORK_TRANSMIT_TASK_PRIORITY, NETWORK_TRANSMIT_TASK_CORES, NETWORK_TRANSMIT_TASK_STACK_SIZE);
+#if USE_CYCLIC_EXECUTIVE
+	mc.start(MOTOR_CTRL_TASK_PRIORITY-1, ROBOT_CONTROLLER_CORES, ROBOT_CONTROLLER_STACK_SIZE);
+	ds.start(DISTANCE_SENSOR_TASK_PRIORITY, DISTANCE_SENSOR_TASK_CORES, DISTANCE_SENSOR_TASK_STACK_SIZE);
+	executive.start(CYCLIC_EXECUTIVE_TASK_PRIORITY, CYCLIC_EXECUTIVE_TASK_CORES, CYCLIC_EXECUTIVE_TASK_STACK_SIZE);
+#else
 #if LAB_IMPLEMENATION_STEP >= 10
-	rsm.start(ROBOT_STATUS_MANAGER_TASK_PRIORITY);
+	rsm.start(ROBOT_STATUS_MANAGER_TASK_PRIORITY, ROBOT_STATUS_MANAGER_TASK_CORES, ROBOT_STATUS_MANAGER_TASK_STACK_SIZE);
 #endif
 
-	mc.start(MOTOR_CTRL_TASK_PRIORITY-1);
-	h.start(HORN_TASK_PRIORITY);
-	ds.start(DISTANCE_SENSOR_TASK_PRIORITY);
-	cs.start(COLLISION_SENSOR_TASK_PRIORITY);
-	ls.start(LINE_TRACKER_SENSOR_TASK_PRIORITY);
+	mc.start(MOTOR_CTRL_TASK_PRIORITY-1, ROBOT_CONTROLLER_CORES, ROBOT_CONTROLLER_STACK_SIZE);
+	h.start(HORN_TASK_PRIORITY, HORN_TASK_CORES, HORN_TASK_STACK_SIZE);
+	ds.start(DISTANCE_SENSOR_TASK_PRIORITY, DISTANCE_SENSOR_TASK_CORES, DISTANCE_SENSOR_TASK_STACK_SIZE);
+	cs.start(COLLISION_SENSOR_TASK_PRIORITY, COLLISION_SENSOR_TASK_CORES, COLLISION_SENSOR_TASK_STACK_SIZE);
+	ls.start(LINE_TRACKER_SENSOR_TASK_PRIORITY, LINE_TRACKER_SENSOR_TASK_CORES, LINE_TRACKER_SENSOR_TASK_STACK_SIZE);
+#endif
 
 #if LAB_IMPLEMENATION_STEP >= 11
-	myCamera.start(CAMERA_TASK_PRIORITY);
-	is.start(IMAGE_STREAM_TASK_PRIORITY);
+	myCamera.start(CAMERA_TASK_PRIORITY, CAMERA_TASK_CORES, CAMERA_TASK_STACK_SIZE);
+	is.start(IMAGE_STREAM_TASK_PRIORITY, IMAGE_STREAM_TASK_CORES, IMAGE_STREAM_TASK_STACK_SIZE);
 #endif
+
+#if USE_ELASTIC_SCHEDULING
+	elasticManager.start(ELASTIC_MANAGER_TASK_PRIORITY, ELASTIC_MANAGER_TASK_CORES, ELASTIC_MANAGER_TASK_STACK_SIZE);
+#endif
+
+	// Start the timer service last, so that every task it releases is already waiting for its first release.
+	timerService.start(TIMER_SERVICE_TASK_PRIORITY, TIMER_SERVICE_TASK_CORES, TIMER_SERVICE_TASK_STACK_SIZE);
+
+	// Check that the task set as configured in TaskRates.h can meet all of its deadlines.
+	SchedulabilityAnalyzer::analyze(true);
+
 	string msg;
 	cin >> msg;
 
@@ -148,6 +273,32 @@ int main(int argc, char *argv[]) {
 			RunnableClass::printThreads();
 		} else if (msg.compare("R") == 0) {
 			RunnableClass::resetAllThreadInformation();
+			PIMutex::resetLockStatistics();
+			CommandQueue::resetAllQueueStatistics();
+		} else if (msg.compare("Q") == 0) {
+			// Show how long commands wait on each queue, and how deep the queues get.
+			CommandQueue::printAllQueueStatistics();
+		} else if (msg.compare("L") == 0) {
+			// Show the hold and wait times of the shared locks.
+			PIMutex::printLockStatistics();
+		} else if (msg.compare("S") == 0) {
+			SchedulabilityAnalyzer::analyze(true);
+		} else if (msg.compare("C") == 0) {
+			// Show how the clock of the robot is synchronised with the station.
+			ClockSynchronizer::printStatus();
+		}
+#if USE_ELASTIC_SCHEDULING
+		else if (msg.compare("E") == 0) {
+			elasticManager.printElasticTasks();
+		}
+#endif
+		else if (msg.compare("T") == 0) {
+			// Start a new trace, or stop the one that is running.
+			Trace::setEnabled(!Trace::enabled.load());
+			cout << "Tracing " << (Trace::enabled.load() ? "started" : "stopped") << "\n";
+		} else if (msg.compare("TX") == 0) {
+			// Write the trace out for Perfetto.
+			Trace::exportChromeJSON(TRACE_EXPORT_FILE_NAME);
 		}
 		else if (msg.compare("M")==0)
 		{
@@ -156,6 +307,14 @@ int main(int argc, char *argv[]) {
 		}
 		cin >> msg;
 	}
+
+	// Close the queues, so that no thread stays blocked on one while the threads are stopped.
+	for (int index = 0; index < NUMBER_OF_QUEUES; index++) {
+		myQueue[index]->close();
+	}
+#if USE_ELASTIC_SCHEDULING
+	elasticManager.stop();
+#endif
 #if LAB_IMPLEMENATION_STEP >= 11
 	is.stop();
 	myCamera.stop();
@@ -167,11 +326,18 @@ int main(int argc, char *argv[]) {
 	mc.stop();
 #if LAB_IMPLEMENATION_STEP >=10
 	rsm.stop();
+#endif
+#if USE_CYCLIC_EXECUTIVE
+	executive.stop();
 #endif
 	ntm.stop();
 	nm.stop();
+	timerService.stop();
 
 	// Wait for the threads to die.
+#if USE_ELASTIC_SCHEDULING
+	elasticManager.waitForShutdown();
+#endif
 #if LAB_IMPLEMENATION_STEP >= 11
 	is.waitForShutdown();
 	myCamera.waitForShutdown();
@@ -183,9 +349,13 @@ int main(int argc, char *argv[]) {
 	mc.waitForShutdown();
 #if LAB_IMPLEMENATION_STEP >= 10
 	rsm.waitForShutdown();
+#endif
+#if USE_CYCLIC_EXECUTIVE
+	executive.waitForShutdown();
 #endif
 	ntm.waitForShutdown();
 	nm.waitForShutdown();
+	timerService.waitForShutdown();
 
 	for (int index = 0; index < NUMBER_OF_QUEUES; index++)
 	{
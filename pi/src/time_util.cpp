@@ -1,5 +1,6 @@
 #include <chrono>
 #include "time_util.h"
+#include "ClockSynchronizer.h"
 
 using namespace std::chrono;
 
@@ -21,3 +22,89 @@ double calculateDelta(struct timeval start, struct timeval end)
 
 	return endms - startms;
 }
+
+/**
+ * This method will convert a timespec into a count of microseconds.
+ * @param ts This is the timespec that is to be converted.
+ * @return The return will be the number of microseconds represented by the timespec.
+ */
+int64_t timespec_to_us(const struct timespec &ts)
+{
+	return ((int64_t) ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * This method will add the given number of microseconds to a timespec, keeping the nanosecond field normalized.
+ * @param ts This is the timespec that is to be advanced.  It is updated in place.
+ * @param us This is the number of microseconds to add.  It may be negative.
+ */
+void timespec_add_us(struct timespec &ts, int64_t us)
+{
+	int64_t nsec = ts.tv_nsec + (us % 1000000) * 1000;
+	ts.tv_sec += us / 1000000;
+
+	// Borrow or carry a second so that tv_nsec stays within [0, 1e9).
+	if (nsec < 0) {
+		nsec += 1000000000;
+		ts.tv_sec--;
+	} else if (nsec >= 1000000000) {
+		nsec -= 1000000000;
+		ts.tv_sec++;
+	}
+	ts.tv_nsec = nsec;
+}
+
+/**
+ * This method will calculate the difference between two timespecs.
+ * @param start This is the starting time.
+ * @param end This is the ending time.
+ * @return The return will be end - start, in microseconds.
+ */
+int64_t timespec_delta_us(const struct timespec &start, const struct timespec &end)
+{
+	return ((int64_t) (end.tv_sec - start.tv_sec)) * 1000000
+			+ (end.tv_nsec - start.tv_nsec) / 1000;
+}
+
+/**
+ * This method will obtain the current time from the monotonic clock.
+ * @return The return will be the number of microseconds on CLOCK_MONOTONIC.
+ */
+int64_t monotonic_timestamp_us()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return timespec_to_us(now);
+}
+
+/**
+ * This method will obtain the current time from the real time clock, without truncating it as current_timestamp does.
+ * @return The return will be the number of ms since the start of the Epoch.
+ */
+int64_t realtime_timestamp_ms()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_REALTIME, &now);
+	return ((int64_t) now.tv_sec) * 1000 + now.tv_nsec / 1000000;
+}
+
+/**
+ * This method will return the synchronized time, which is the monotonic clock of the robot plus its estimated offset from the
+ * clock of the operator station.  Timestamps taken with it are directly comparable with those the station puts on its messages.
+ * Until the clocks have been synchronized, it is the wall clock of the robot.
+ * @return The return will be the number of ms since the start of the Epoch on the clock of the station.
+ */
+int64_t synchronized_timestamp()
+{
+	return ClockSynchronizer::toSynchronizedTime(monotonic_timestamp_us()) / 1000;
+}
+
+/**
+ * This method will convert an instant on the monotonic clock to synchronized time.
+ * @param monotonicNs This is the instant on CLOCK_MONOTONIC, in nanoseconds.
+ * @return The return will be the number of ms since the start of the Epoch on the clock of the station at that instant.
+ */
+int64_t monotonic_to_synchronized_ms(uint64_t monotonicNs)
+{
+	return ClockSynchronizer::toSynchronizedTime((int64_t) (monotonicNs / 1000)) / 1000;
+}
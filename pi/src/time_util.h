@@ -2,7 +2,12 @@
  * This is a set of time utilities.  It is used for basic timestamping.
  * @return
  */
+#ifndef TIME_UTIL_H_
+#define TIME_UTIL_H_
+
 #include <sys/time.h>
+#include <time.h>
+#include <stdint.h>
 
 /**
  * This method will return a current timestamp.
@@ -17,3 +22,54 @@ int current_timestamp();
  * @return The return will be the delta time between these, in ms.
  */
 double calculateDelta(struct timeval start, struct timeval end);
+
+/**
+ * This method will convert a timespec into a count of microseconds.
+ * @param ts This is the timespec that is to be converted.
+ * @return The return will be the number of microseconds represented by the timespec.
+ */
+int64_t timespec_to_us(const struct timespec &ts);
+
+/**
+ * This method will add the given number of microseconds to a timespec, keeping the nanosecond field normalized.
+ * @param ts This is the timespec that is to be advanced.  It is updated in place.
+ * @param us This is the number of microseconds to add.  It may be negative.
+ */
+void timespec_add_us(struct timespec &ts, int64_t us);
+
+/**
+ * This method will calculate the difference between two timespecs.
+ * @param start This is the starting time.
+ * @param end This is the ending time.
+ * @return The return will be end - start, in microseconds.
+ */
+int64_t timespec_delta_us(const struct timespec &start, const struct timespec &end);
+
+/**
+ * This method will obtain the current time from the monotonic clock.
+ * @return The return will be the number of microseconds on CLOCK_MONOTONIC.
+ */
+int64_t monotonic_timestamp_us();
+
+/**
+ * This method will obtain the current time from the real time clock, without truncating it as current_timestamp does.
+ * @return The return will be the number of ms since the start of the Epoch.
+ */
+int64_t realtime_timestamp_ms();
+
+/**
+ * This method will return the synchronized time, which is the monotonic clock of the robot plus its estimated offset from the
+ * clock of the operator station.  Timestamps taken with it are directly comparable with those the station puts on its messages.
+ * Until the clocks have been synchronized, it is the wall clock of the robot.
+ * @return The return will be the number of ms since the start of the Epoch on the clock of the station.
+ */
+int64_t synchronized_timestamp();
+
+/**
+ * This method will convert an instant on the monotonic clock to synchronized time.
+ * @param monotonicNs This is the instant on CLOCK_MONOTONIC, in nanoseconds.
+ * @return The return will be the number of ms since the start of the Epoch on the clock of the station at that instant.
+ */
+int64_t monotonic_to_synchronized_ms(uint64_t monotonicNs);
+
+#endif /* TIME_UTIL_H_ */